@@ -5,6 +5,67 @@
 ********************************************************************************/
 #include "ann.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+/* Antalet rader som behandlas per block vid prediktion i batch. */
+constexpr std::size_t predict_tile = 64;
+
+/* Filsignatur samt aktuell version fr binrt lagrade modeller. */
+constexpr char model_magic[8] = { 'A', 'N', 'N', 'M', 'O', 'D', 'E', 'L' };
+constexpr std::uint32_t model_version = 1;
+constexpr std::uint32_t model_byte_order = 0x01020304;
+constexpr std::uint32_t model_layers = 2;
+
+/********************************************************************************
+* barrier: Enkel teranvndbar barrir, dr samtliga trdar vntar i wait tills
+*          angivet antal trdar har anlnt, varefter samtliga slpps vidare.
+********************************************************************************/
+class barrier
+{
+public:
+   explicit barrier(const std::size_t num_threads)
+      : num_threads(num_threads) { }
+
+   void wait(void)
+   {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      const auto generation = this->generation;
+
+      if (++this->arrived == this->num_threads)
+      {
+         this->arrived = 0;
+         ++this->generation;
+         this->condition.notify_all();
+      }
+      else
+      {
+         this->condition.wait(lock, [&] { return generation != this->generation; });
+      }
+
+      return;
+   }
+
+private:
+   std::mutex mutex;
+   std::condition_variable condition;
+   const std::size_t num_threads;
+   std::size_t arrived = 0;
+   std::size_t generation = 0;
+};
+}
+
 /********************************************************************************
 * ann: Initierar nytt neuralt ntverk med angivet antal noder i ingngslagret,
 *      det dolda lagret samt utgngslagret.
@@ -12,43 +73,96 @@
 *      - num_inputs : Antalet noder i ingngslagret.
 *      - num_hidden : Antalet noder i det dolda lagret.
 *      - num_outputs: Antalet noder i utgngslagret.
+*      - seed       : Startvrde fr ntverkets slumptalsgenerator
+*                     (default = rng::default_seed).
 ********************************************************************************/
-ann::ann(const std::size_t num_inputs,
-         const std::size_t num_hidden,
-         const std::size_t num_outputs)
+template <typename T>
+ann<T>::ann(const std::size_t num_inputs,
+            const std::size_t num_hidden,
+            const std::size_t num_outputs,
+            const std::uint64_t seed)
+   : generator(seed), generation(next_generation())
 {
-   this->hidden_layer.resize(num_hidden, num_inputs);
-   this->output_layer.resize(num_outputs, num_hidden);
+   this->hidden_layer.resize(num_hidden, num_inputs, this->generator);
+   this->output_layer.resize(num_outputs, num_hidden, this->generator);
+   return;
+}
+
+/********************************************************************************
+* set_optimizer: Vljer optimerare fr samtliga lager i angivet neuralt
+*                ntverk, se dense_layer::set_optimizer. Optimerarens
+*                tillstnd allokeras och nollstlls, varefter det behlls
+*                mellan anrop av train, s att trningen kan fortstta dr
+*                den slutade.
+*
+*                - optimizer: Instllningar fr optimeraren.
+********************************************************************************/
+template <typename T>
+void ann<T>::set_optimizer(const optimizer_options<T>& optimizer)
+{
+   this->hidden_layer.set_optimizer(optimizer);
+   this->output_layer.set_optimizer(optimizer);
    return;
 }
 
 /********************************************************************************
 * set_training_data: Lser in trningsdata fr angivet neuralt ntverk via
 *                    passerade in- och utsignaler, tillsammans med att index
-*                    fr respektive trningsuppsttning lagras.
+*                    fr respektive trningsuppsttning lagras. Datan
+*                    kopieras till ett sammanhngande minnesblock.
 *
 *                    - train_in : Innehller indata fr trningsuppsttningar.
 *                    - train_out: Innehller utdata fr trningsuppsttningar.
 ********************************************************************************/
-void ann::set_training_data(const std::vector<std::vector<double>>& train_in,
-                            const std::vector<std::vector<double>>& train_out)
+template <typename T>
+void ann<T>::set_training_data(const std::vector<std::vector<T>>& train_in,
+                               const std::vector<std::vector<T>>& train_out)
 {
-   const auto num_sets = train_in.size() <= train_out.size() ? train_in.size() : train_out.size();
+   this->set_training_data(dataset<T>(train_in, train_out));
+   return;
+}
 
-   this->train_in.resize(num_sets);
-   this->train_out.resize(num_sets);
-   this->train_order.resize(num_sets);
+/********************************************************************************
+* set_training_data: Tilldelar angivet neuralt ntverk angiven trningsdata,
+*                    tillsammans med att index fr respektive
+*                    trningsuppsttning lagras. Passeras datan via std::move
+*                    vertas den utan kopiering, ven om den r minnesmappad.
+*
+*                    - train_data: Trningsdata fr ntverket.
+********************************************************************************/
+template <typename T>
+void ann<T>::set_training_data(dataset<T> train_data)
+{
+   this->train_data = std::move(train_data);
+   this->train_order.resize(this->train_data.num_sets());
 
-   for (std::size_t i = 0; i < num_sets; ++i)
+   for (std::size_t i = 0; i < this->train_order.size(); ++i)
    {
-      this->train_in[i] = train_in[i];
-      this->train_out[i] = train_out[i];
       this->train_order[i] = i;
    }
 
    return;
 }
 
+/********************************************************************************
+* load_training_data: Lser in trningsdata fr angivet neuralt ntverk frn
+*                     angiven binrfil, skriven via dataset::save. Filen
+*                     minnesmappas, s att trning sker direkt p filens
+*                     innehll utan kopiering. Returnerar true om
+*                     inlsningen lyckades, annars false, varvid befintlig
+*                     trningsdata behlls.
+*
+*                     - filename: Skvg till filen som skall lsas in.
+********************************************************************************/
+template <typename T>
+bool ann<T>::load_training_data(const std::string& filename)
+{
+   dataset<T> train_data;
+   if (!train_data.load(filename)) return false;
+   this->set_training_data(std::move(train_data));
+   return true;
+}
+
 /********************************************************************************
 * train: Trnar angivet neuralt ntverk med befintlig trningsdata under angivet
 *        antal epoker med angiven lrhastighet. I brjan av varje epok
@@ -57,25 +171,354 @@ void ann::set_training_data(const std::vector<std::vector<double>>& train_in,
 *        Under varje epok utstts det neurala ntverket fr samtliga befintliga 
 *        trningsuppsttningar och justeras utefter prediktionsresultatet.      
 *
+*        Vid en batchstorlek strre n 1 delas trningsuppsttningarna upp i
+*        minibatcher, dr gradienterna ackumuleras ver hela batchen och
+*        parametrarna justeras en gng per batch med medelvrdet av
+*        gradienterna. Berkningarna genomfrs d som matrisprodukter, vilket
+*        medfr att varje vikt lses en gng per batch i stllet fr en gng
+*        per trningsuppsttning.
+*
+*        Vid fler n en trd frdelas trningen ver angivet antal trdar
+*        enligt angivet lge, se train_parallel. Vid synkron trning berknar
+*        varje trd en minibatch per steg, vilket innebr att parametrarna
+*        justeras med medelvrdet av gradienterna fr batch_size gnger
+*        antalet trdar trningsuppsttningar.
+*
 *        - num_epochs   : Antalet epoker/omgngar som trning skall genomfras.
 *        - learning_rate: Lrhastigheten, som avgr hur stor andel av uppmtt
 *                         avvikelse som ntverkets parametrar justeras med.
+*        - batch_size   : Antalet trningsuppsttningar per minibatch
+*                         (default = 1, vilket innebr att parametrarna
+*                         justeras efter varje trningsuppsttning).
+*        - num_threads  : Antalet trdar som anvnds vid trning, dr 0
+*                         innebr en trd per processorkrna (default = 1).
+*        - mode         : Anger hur trningen frdelas mellan trdarna
+*                         (default = parallel_mode::synchronous).
+*
+*        Returnerar genomsnittlig kvadrerad avvikelse per utsignal under den
+*        sista epoken, vilken summeras vid backpropagation utan extra
+*        berkningar, eller 0 om ingen epok genomfrdes.
 ********************************************************************************/
-void ann::train(const std::size_t num_epochs,
-                const double learning_rate)
+template <typename T>
+double ann<T>::train(const std::size_t num_epochs,
+                     const T learning_rate,
+                     const std::size_t batch_size,
+                     const std::size_t num_threads,
+                     const parallel_mode mode)
 {
+   this->generation = next_generation();
+
+   if (num_threads != 1)
+   {
+      return this->train_parallel(num_epochs, learning_rate, batch_size, num_threads, mode);
+   }
+
+   double loss = 0;
+
+   if (batch_size > 1)
+   {
+      this->batch.resize(batch_size, this->hidden_layer.num_weights(), this->num_hidden(), this->num_outputs());
+   }
+
    for (std::size_t i = 0; i < num_epochs; ++i)
    {
+      ANN_PROFILE_RUN(this->profile.begin_epoch());
       this->shuffle();
+      loss = 0;
 
-      for (std::size_t j = 0; j < this->num_sets(); ++j)
+      if (batch_size > 1)
+      {
+         for (std::size_t j = 0; j < this->num_sets(); j += batch_size)
+         {
+            const auto num_samples = std::min(batch_size, this->num_sets() - j);
+            loss += this->optimize(j, num_samples, learning_rate);
+         }
+      }
+      else
       {
-         const auto k = this->train_order[j];
-         this->optimize(this->train_in[k], this->train_out[k], learning_rate);
+         for (std::size_t j = 0; j < this->num_sets(); ++j)
+         {
+            const auto k = this->train_order[j];
+            loss += this->optimize(this->train_data.input(k), this->train_data.output(k), learning_rate);
+         }
       }
+
+      ANN_PROFILE_RUN(this->profile.end_epoch());
    }
 
-   return;
+   return this->mean_loss(loss, this->num_sets());
+}
+
+/********************************************************************************
+* train: Trnar angivet neuralt ntverk enligt angivna instllningar, en
+*        epok i taget, tills maximalt antal epoker har genomfrts eller
+*        trningen avbryts i frtid. Om en valideringsandel har angivits
+*        randomiseras ordningsfljden en gng, varefter motsvarande andel
+*        uppsttningar hlls utanfr trningen och anvnds fr att mta
+*        valideringsfrlusten efter varje epok. Annars anvnds
+*        trningsfrlusten frn respektive epok, vilken erhlls utan extra
+*        berkningar. Trningen avbryts nr frlusten nr target_loss eller
+*        nr den inte har minskat med minst min_delta under patience epoker
+*        i fljd. Vid restore_best terstlls parametrarna drefter till den
+*        epok som gav lgst frlust. Lrhastigheten fr respektive epok ges
+*        av train_options::learning_rate_at. Samtliga trningsuppsttningar
+*        ingr ter i ordningsfljden efter trningen. Angiven optimerare
+*        vljs fr samtliga lager med nollstllt tillstnd innan trningen
+*        startar.
+*
+*        - options: Instllningar fr trningen.
+********************************************************************************/
+template <typename T>
+train_report ann<T>::train(const train_options<T>& options)
+{
+   const auto start = std::chrono::steady_clock::now();
+   const auto all_sets = this->train_order;
+   std::vector<std::size_t> validation;
+   std::vector<T> best;
+   train_report report;
+   std::size_t num_stale = 0;
+   this->set_optimizer(options.optimizer);
+
+   auto save = [&](void)
+   {
+      best.clear();
+
+      for (const auto* layer : { &this->hidden_layer, &this->output_layer })
+      {
+         best.insert(best.end(), layer->bias.begin(), layer->bias.end());
+         best.insert(best.end(), layer->weights.elements(), layer->weights.elements() + layer->weights.size());
+      }
+   };
+
+   auto restore = [&](void)
+   {
+      const auto* source = best.data();
+
+      for (auto* layer : { &this->hidden_layer, &this->output_layer })
+      {
+         std::copy(source, source + layer->bias.size(), layer->bias.begin());
+         source += layer->bias.size();
+         std::copy(source, source + layer->weights.size(), layer->weights.elements());
+         source += layer->weights.size();
+      }
+   };
+
+   if (options.validation_split > 0 && this->num_sets() > 1)
+   {
+      const auto count = std::min(std::max<std::size_t>(static_cast<std::size_t>(options.validation_split * this->num_sets()), 1),
+                                  this->num_sets() - 1);
+      this->shuffle();
+      validation.assign(this->train_order.end() - count, this->train_order.end());
+      this->train_order.resize(this->num_sets() - count);
+   }
+
+   report.best_loss = std::numeric_limits<double>::infinity();
+
+   for (std::size_t epoch = 0; epoch < options.num_epochs; ++epoch)
+   {
+      const auto learning_rate = options.learning_rate_at(epoch);
+      const auto loss = this->train(1, learning_rate, options.batch_size, options.num_threads, options.mode);
+      const auto monitored = validation.empty() ? loss : this->evaluate(validation);
+
+      report.train_loss.push_back(loss);
+      if (!validation.empty()) report.validation_loss.push_back(monitored);
+      report.learning_rate.push_back(learning_rate);
+      report.epochs = epoch + 1;
+
+      if (monitored < report.best_loss)
+      {
+         num_stale = monitored < report.best_loss - options.min_delta ? 0 : num_stale + 1;
+         report.best_loss = monitored;
+         report.best_epoch = epoch + 1;
+         if (options.restore_best) save();
+      }
+      else
+      {
+         num_stale++;
+      }
+
+      if (options.target_loss > 0 && monitored <= options.target_loss)
+      {
+         report.converged = true;
+         break;
+      }
+
+      if (options.patience > 0 && num_stale >= options.patience)
+      {
+         report.stopped_early = true;
+         break;
+      }
+   }
+
+   if (options.restore_best && !best.empty() && report.best_epoch != report.epochs)
+   {
+      restore();
+      this->generation = next_generation();
+   }
+
+   if (report.epochs == 0) report.best_loss = 0;
+   this->train_order = all_sets;
+   report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   return report;
+}
+
+/********************************************************************************
+* train: Trnar angivet neuralt ntverk under angivet antal epoker med
+*        trningsdata som strmmas frn fil via angiven strm, s att
+*        datamngden inte behver rymmas i arbetsminnet. Den frsta epoken
+*        startar frn strmmens aktuella position, normalt direkt efter att
+*        den har ppnats, och strmmen spolas sedan tillbaka infr varje
+*        efterfljande epok. Ntverket trnas p ett block i taget medan
+*        strmmens bakgrundstrd lser in nsta block.
+*        Ordningen p trningsuppsttningarna randomiseras inom varje block,
+*        vilket innebr att blockstorleken avgr hur stort fnster som
+*        blandas. Befintlig trningsdata i ntverket pverkas inte.
+*
+*        - stream       : ppen strm som trningsdata lses frn.
+*        - num_epochs   : Antalet epoker/omgngar som trning skall genomfras.
+*        - learning_rate: Lrhastigheten fr trningen.
+*        - batch_size   : Antalet trningsuppsttningar per minibatch
+*                         (default = 1).
+*        - num_threads  : Antalet trdar som anvnds vid trning, dr 0
+*                         innebr en trd per processorkrna (default = 1).
+*        - mode         : Anger hur trningen frdelas mellan trdarna
+*                         (default = parallel_mode::synchronous).
+*
+*        Returnerar genomsnittlig kvadrerad avvikelse per utsignal under den
+*        sista epoken, eller 0 om ingen epok genomfrdes.
+********************************************************************************/
+template <typename T>
+double ann<T>::train(data_stream<T>& stream,
+                     const std::size_t num_epochs,
+                     const T learning_rate,
+                     const std::size_t batch_size,
+                     const std::size_t num_threads,
+                     const parallel_mode mode)
+{
+   dataset<T> chunk;
+   std::vector<std::size_t> chunk_order;
+   double loss = 0;
+   std::size_t num_sets = 0;
+
+   std::swap(this->train_data, chunk);
+   std::swap(this->train_order, chunk_order);
+
+   for (std::size_t i = 0; i < num_epochs; ++i)
+   {
+      if (i > 0 && !stream.rewind()) break;
+      ANN_PROFILE_RUN(this->profile.begin_epoch());
+      loss = 0;
+      num_sets = 0;
+
+      while (stream.next(this->train_data))
+      {
+         this->train_order.resize(this->train_data.num_sets());
+
+         for (std::size_t j = 0; j < this->train_order.size(); ++j)
+         {
+            this->train_order[j] = j;
+         }
+
+         loss += this->train(1, learning_rate, batch_size, num_threads, mode) * this->num_sets();
+         num_sets += this->num_sets();
+      }
+
+      ANN_PROFILE_RUN(this->profile.end_epoch());
+   }
+
+   std::swap(this->train_data, chunk);
+   std::swap(this->train_order, chunk_order);
+   return num_sets > 0 ? loss / num_sets : 0;
+}
+
+/********************************************************************************
+* train: Trnar angivet neuralt ntverk under angivet antal epoker med gles
+*        indata, dr rad i i train_in utgr indata och train_out[i]
+*        motsvarande referensdata. Det dolda lagret lser och justerar
+*        endast vikterna fr de indata som r skilda frn noll, vilket
+*        medfr att kostnaden fr lagret r proportionell mot antalet lagrade
+*        vrden per rad i stllet fr antalet noder i ingngslagret. Vid en
+*        batchstorlek strre n 1 ackumuleras utgngslagrets gradienter som
+*        vid tt trning, medan det dolda lagrets vikter justeras glest via
+*        avvikelserna fr hela batchen, se dense_layer::optimize. Ordningen
+*        randomiseras i brjan av varje epok via ntverkets generator.
+*        Trningen sker i en trd och befintlig trningsdata pverkas inte.
+*        Returnerar genomsnittlig kvadrerad avvikelse per utsignal under den
+*        sista epoken.
+*
+*        - train_in     : Gles indata, en rad per trningsuppsttning.
+*        - train_out    : Referensdata fr respektive trningsuppsttning.
+*        - num_epochs   : Antalet epoker/omgngar som trning skall genomfras.
+*        - learning_rate: Lrhastigheten fr trningen.
+*        - batch_size   : Antalet trningsuppsttningar per minibatch
+*                         (default = 1).
+********************************************************************************/
+template <typename T>
+double ann<T>::train(const sparse_matrix<T>& train_in,
+                     const std::vector<std::vector<T>>& train_out,
+                     const std::size_t num_epochs,
+                     const T learning_rate,
+                     const std::size_t batch_size)
+{
+   const auto num_sets = std::min(train_in.num_rows(), train_out.size());
+   const auto max_batch = std::max<std::size_t>(batch_size, 1);
+   std::vector<std::size_t> order(num_sets);
+   std::vector<sparse_row<T>> rows(max_batch);
+   double loss = 0;
+   this->generation = next_generation();
+
+   for (std::size_t i = 0; i < num_sets; ++i)
+   {
+      order[i] = i;
+   }
+
+   if (max_batch > 1)
+   {
+      this->batch.resize(max_batch, 0, this->num_hidden(), this->num_outputs());
+   }
+
+   for (std::size_t i = 0; i < num_epochs; ++i)
+   {
+      ANN_PROFILE_RUN(this->profile.begin_epoch());
+      {
+         ANN_PROFILE_SCOPE(this->profile, profile_phase::shuffle);
+         this->generator.shuffle(order.data(), order.size());
+      }
+
+      loss = 0;
+
+      for (std::size_t j = 0; j < num_sets; j += max_batch)
+      {
+         const auto num_samples = std::min(max_batch, num_sets - j);
+
+         if (max_batch == 1)
+         {
+            const auto& reference = train_out[order[j]];
+            loss += this->optimize(train_in[order[j]], reference.data(), reference.size(), learning_rate);
+            continue;
+         }
+
+         {
+            ANN_PROFILE_SCOPE(this->profile, profile_phase::load);
+
+            for (std::size_t s = 0; s < num_samples; ++s)
+            {
+               const auto& reference = train_out[order[j + s]];
+               const auto num_references = std::min(reference.size(), this->batch.reference.cols);
+               rows[s] = train_in[order[j + s]];
+               std::copy(reference.begin(), reference.begin() + num_references, this->batch.reference[s]);
+               std::fill(this->batch.reference[s] + num_references,
+                         this->batch.reference[s] + this->batch.reference.cols, 0);
+            }
+         }
+
+         loss += this->optimize(rows.data(), num_samples, learning_rate);
+      }
+
+      ANN_PROFILE_RUN(this->profile.end_epoch());
+   }
+
+   return this->mean_loss(loss, num_sets);
 }
 
 /********************************************************************************
@@ -85,13 +528,343 @@ void ann::train(const std::size_t num_epochs,
 *          - input: Vektor innehllande den kombination av indata som
 *                   prediktion skall ske utefter.
 ********************************************************************************/
-std::vector<double>& ann::predict(const std::vector<double>& input)
+template <typename T>
+std::vector<T>& ann<T>::predict(const std::vector<T>& input)
 {
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::predict);
+   ANN_PROFILE_RUN(this->profile.add_predictions(1));
    this->hidden_layer.feedforward(input);
    this->output_layer.feedforward(this->hidden_layer.output);
    return this->output_layer.output;
 }
 
+/********************************************************************************
+* workspace: Returnerar en arbetsyta med buffertar anpassade fr angivet
+*            neuralt ntverk, avsedd att teranvndas vid prediktion via
+*            predict med egen arbetsyta.
+********************************************************************************/
+template <typename T>
+ann_workspace<T> ann<T>::workspace(void) const
+{
+   ann_workspace<T> workspace;
+   workspace.resize(this->num_hidden(), this->num_outputs());
+   return workspace;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk fr angiven 
+*          kombination av indata, dr utdata frn respektive lager lagras i
+*          angiven arbetsyta. Ntverket modifieras inte, vilket medfr att
+*          flera trdar kan anvnda samma ntverk samtidigt utan ls, s
+*          lnge var och en har en egen arbetsyta. Ingen minnesallokering
+*          sker s lnge arbetsytan har rtt storlek.
+*
+*          - input    : Vektor innehllande den kombination av indata som
+*                       prediktion skall ske utefter.
+*          - workspace: Arbetsyta dr utdata frn respektive lager lagras.
+********************************************************************************/
+template <typename T>
+const std::vector<T>& ann<T>::predict(const std::vector<T>& input,
+                                      ann_workspace<T>& workspace) const
+{
+   workspace.resize(this->num_hidden(), this->num_outputs());
+   this->predict(input.data(), input.size(), workspace.output.data(), workspace);
+   return workspace.output;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk fr angiven 
+*          kombination av indata och skriver predikterad utdata till angiven
+*          buffert. Arbetsytan anvnds endast fr utdata frn det dolda
+*          lagret. Ntverket modifieras inte, vilket medfr att flera trdar
+*          kan anvnda samma ntverk samtidigt, s lnge var och en har en
+*          egen arbetsyta.
+*
+*          - input     : Pekare till den kombination av indata som
+*                        prediktion skall ske utefter.
+*          - num_inputs: Antalet element i indatan.
+*          - output    : Pekare till buffert med plats fr ett element per
+*                        nod i utgngslagret.
+*          - workspace : Arbetsyta fr utdata frn det dolda lagret.
+********************************************************************************/
+template <typename T>
+void ann<T>::predict(const T* input,
+                     const std::size_t num_inputs,
+                     T* output,
+                     ann_workspace<T>& workspace) const
+{
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::predict);
+   ANN_PROFILE_RUN(this->profile.add_predictions(1));
+   workspace.resize(this->num_hidden(), this->num_outputs());
+   this->hidden_layer.feedforward(input, num_inputs, workspace.hidden.data());
+   this->output_layer.feedforward(workspace.hidden.data(), workspace.hidden.size(), output);
+   return;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk fr samtliga rader
+*          i en radvis lagrad indatamatris och skriver predikterad utdata
+*          radvis till angiven utdatamatris. Raderna behandlas i block om
+*          predict_tile rader, dr varje block multipliceras med respektive
+*          lagers vikter som en matrisprodukt, s att vikterna teranvnds
+*          fr samtliga rader i blocket medan de ligger kvar i cacheminnet.
+*          Vid fler n en trd frdelas raderna jmnt mellan trdarna. 
+*          Ntverket modifieras inte.
+*
+*          - input      : Pekare till indatamatrisen, som innehller
+*                         num_rows x num_inputs element.
+*          - num_rows   : Antalet rader i in- och utdatamatrisen.
+*          - num_inputs : Antalet element per rad i indatamatrisen.
+*          - output     : Pekare till utdatamatrisen, med plats fr
+*                         num_rows x num_outputs() element.
+*          - num_threads: Antalet trdar, dr 0 innebr en trd per
+*                         processorkrna (default = 1).
+********************************************************************************/
+template <typename T>
+void ann<T>::predict(const T* input,
+                     const std::size_t num_rows,
+                     const std::size_t num_inputs,
+                     T* output,
+                     const std::size_t num_threads) const
+{
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::predict);
+   ANN_PROFILE_RUN(this->profile.add_predictions(num_rows));
+   const auto hardware_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+   const auto num_tiles = (num_rows + predict_tile - 1) / predict_tile;
+   const auto thread_count = std::min(num_threads > 0 ? num_threads : hardware_threads, std::max<std::size_t>(num_tiles, 1));
+
+   auto run = [&](const std::size_t t)
+   {
+      matrix<T> hidden(predict_tile, this->num_hidden());
+      const auto begin = num_tiles * t / thread_count * predict_tile;
+      const auto end = std::min(num_tiles * (t + 1) / thread_count * predict_tile, num_rows);
+
+      for (std::size_t first = begin; first < end; first += predict_tile)
+      {
+         const auto num_samples = std::min(predict_tile, end - first);
+         this->hidden_layer.feedforward(input + first * num_inputs, num_samples, num_inputs, num_inputs,
+                                        hidden[0], hidden.stride);
+         this->output_layer.feedforward(hidden[0], num_samples, hidden.cols, hidden.stride,
+                                        output + first * this->num_outputs(), this->num_outputs());
+      }
+   };
+
+   std::vector<std::thread> threads;
+
+   for (std::size_t t = 1; t < thread_count; ++t)
+   {
+      threads.emplace_back(run, t);
+   }
+
+   run(0);
+
+   for (auto& i : threads)
+   {
+      i.join();
+   }
+
+   return;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk fr angiven gles
+*          indata, dr utdata frn respektive lager lagras i angiven
+*          arbetsyta. Ntverket modifieras inte.
+*
+*          - input    : Gles indata som prediktion skall ske utefter.
+*          - workspace: Arbetsyta dr utdata frn respektive lager lagras.
+********************************************************************************/
+template <typename T>
+const std::vector<T>& ann<T>::predict(const sparse_row<T>& input,
+                                      ann_workspace<T>& workspace) const
+{
+   workspace.resize(this->num_hidden(), this->num_outputs());
+   this->predict(input, workspace.output.data(), workspace);
+   return workspace.output;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk fr angiven gles
+*          indata och skriver predikterad utdata till angiven buffert. Det
+*          dolda lagret lser endast vikterna fr de indata som r skilda
+*          frn noll. Ntverket modifieras inte, vilket medfr att flera
+*          trdar kan anvnda samma ntverk samtidigt, s lnge var och en
+*          har en egen arbetsyta.
+*
+*          - input    : Gles indata som prediktion skall ske utefter.
+*          - output   : Pekare till buffert med plats fr ett element per
+*                       nod i utgngslagret.
+*          - workspace: Arbetsyta fr utdata frn det dolda lagret.
+********************************************************************************/
+template <typename T>
+void ann<T>::predict(const sparse_row<T>& input,
+                     T* output,
+                     ann_workspace<T>& workspace) const
+{
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::predict);
+   ANN_PROFILE_RUN(this->profile.add_predictions(1));
+   workspace.resize(this->num_hidden(), this->num_outputs());
+   this->hidden_layer.feedforward(input, workspace.hidden.data());
+   this->output_layer.feedforward(workspace.hidden.data(), workspace.hidden.size(), output);
+   return;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk fr samtliga rader
+*          i angiven gles matris och skriver predikterad utdata radvis till
+*          angiven utdatamatris. En arbetsyta allokeras en gng per anrop.
+*
+*          - input : Gles indata, en rad per prediktion.
+*          - output: Pekare till utdatamatrisen, med plats fr
+*                    input.num_rows() x num_outputs() element.
+********************************************************************************/
+template <typename T>
+void ann<T>::predict(const sparse_matrix<T>& input,
+                     T* output) const
+{
+   auto workspace = this->workspace();
+
+   for (std::size_t r = 0; r < input.num_rows(); ++r)
+   {
+      this->predict(input[r], output + r * this->num_outputs(), workspace);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* incremental: Returnerar ett tillstnd fr inkrementell prediktion anpassat
+*              fr angivet neuralt ntverk, dr samtliga indata r noll tills
+*              en fullstndig indata anges via predict eller frndringar
+*              anges via update.
+*
+*              - refresh_interval: Antalet frndrade indata mellan
+*                                  fullstndiga omrkningar av det dolda
+*                                  lagret, dr 0 innebr antalet indata
+*                                  (default = 0).
+********************************************************************************/
+template <typename T>
+ann_incremental<T> ann<T>::incremental(const std::size_t refresh_interval) const
+{
+   ann_incremental<T> state;
+   state.refresh_interval = refresh_interval;
+   state.resize(this->num_inputs(), this->num_hidden(), this->num_outputs());
+   this->refresh(state);
+   return state;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk fr angiven
+*          fullstndig indata, som sparas i angivet tillstnd tillsammans med
+*          det dolda lagrets summor fre aktivering. Efterfljande
+*          prediktioner dr endast ett ftal indata frndras kan drefter
+*          genomfras via update. Ntverket modifieras inte.
+*
+*          - input: Vektor innehllande den kombination av indata som
+*                   prediktion skall ske utefter.
+*          - state: Tillstnd fr inkrementell prediktion.
+********************************************************************************/
+template <typename T>
+const std::vector<T>& ann<T>::predict(const std::vector<T>& input,
+                                      ann_incremental<T>& state) const
+{
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::predict);
+   ANN_PROFILE_RUN(this->profile.add_predictions(1));
+   state.resize(this->num_inputs(), this->num_hidden(), this->num_outputs());
+   const auto num_inputs = std::min(input.size(), state.input.size());
+   std::copy(input.begin(), input.begin() + num_inputs, state.input.begin());
+   std::fill(state.input.begin() + num_inputs, state.input.end(), 0);
+   this->refresh(state);
+   this->output_layer.feedforward(state.hidden.data(), state.hidden.size(), state.output.data());
+   return state.output;
+}
+
+/********************************************************************************
+* update: Genomfr prediktion med angivet neuralt ntverk efter att angivna
+*         indata har frndrats sedan fregende prediktion med angivet
+*         tillstnd. Frndringarna passeras glest som par av index och nytt
+*         vrde, dr index utanfr ingngslagret ignoreras. Skillnaden mot
+*         sparad indata berknas per index, varefter det dolda lagrets summor
+*         fre aktivering uppdateras med endast dessa bidrag. Kostnaden fr
+*         det dolda lagret r drmed proportionell mot antalet frndrade
+*         indata i stllet fr antalet indata, medan utgngslagret berknas
+*         p vanligt stt. Nr antalet frndrade indata sedan senaste
+*         omrkning nr tillstndets refresh_interval rknas summorna i
+*         stllet om helt frn sparad indata, s att ackumulerade
+*         avrundningsfel begrnsas. Summorna rknas ven om helt nr
+*         ntverkets generation skiljer sig frn tillstndets, exempelvis
+*         efter trning eller byte till en modell med samma dimensioner.
+*         Om tillstndet inte r anpassat fr ntverkets dimensioner anpassas
+*         det frst och samtliga tidigare indata stts till noll. Ntverket
+*         modifieras inte.
+*
+*         - changes: Frndrade indata, dr value[k] anger nytt vrde fr
+*                    index[k].
+*         - state  : Tillstnd fr inkrementell prediktion.
+********************************************************************************/
+template <typename T>
+const std::vector<T>& ann<T>::update(const sparse_row<T>& changes,
+                                     ann_incremental<T>& state) const
+{
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::predict);
+   ANN_PROFILE_RUN(this->profile.add_predictions(1));
+
+   if (state.input.size() != this->num_inputs() || state.sum.size() != this->num_hidden() ||
+       state.output.size() != this->num_outputs())
+   {
+      state.resize(this->num_inputs(), this->num_hidden(), this->num_outputs());
+      std::fill(state.input.begin(), state.input.end(), 0);
+      state.generation = 0;
+   }
+
+   state.changed.clear();
+   state.delta.clear();
+
+   for (std::size_t k = 0; k < changes.size; ++k)
+   {
+      const auto index = changes.index[k];
+      if (index >= state.input.size() || changes.value[k] == state.input[index]) continue;
+      state.changed.push_back(index);
+      state.delta.push_back(changes.value[k] - state.input[index]);
+      state.input[index] = changes.value[k];
+   }
+
+   const auto interval = state.refresh_interval > 0 ? state.refresh_interval : state.input.size();
+   state.num_changes += state.changed.size();
+
+   if (state.num_changes >= interval || state.generation != this->generation)
+   {
+      this->refresh(state);
+   }
+   else
+   {
+      const sparse_row<T> delta(state.changed.data(), state.delta.data(), state.changed.size());
+      this->hidden_layer.update_preactivation(delta, state.sum.data());
+      this->hidden_layer.activate(state.sum.data(), state.hidden.data());
+   }
+
+   this->output_layer.feedforward(state.hidden.data(), state.hidden.size(), state.output.data());
+   return state.output;
+}
+
+/********************************************************************************
+* refresh: Rknar om det dolda lagrets summor fre aktivering samt utdata
+*          helt frn indatan i angivet tillstnd, nollstller antalet
+*          frndringar sedan senaste omrkning och sparar ntverkets
+*          generation i tillstndet.
+*
+*          - state: Tillstnd fr inkrementell prediktion.
+********************************************************************************/
+template <typename T>
+void ann<T>::refresh(ann_incremental<T>& state) const
+{
+   this->hidden_layer.preactivate(state.input.data(), state.input.size(), state.sum.data());
+   this->hidden_layer.activate(state.sum.data(), state.hidden.data());
+   state.num_changes = 0;
+   state.generation = this->generation;
+   return;
+}
+
 /********************************************************************************
 * predict: Genomfr prediktion med angivet neuralt ntverk via indata frn
 *          samtliga befintliga trningsuppsttninsuppsttningar och skriver
@@ -106,10 +879,26 @@ std::vector<double>& ann::predict(const std::vector<double>& input)
 *                       vrden mellan [-threshold, threshold]  avrundas till
 *                       noll (default = 0.001).
 ********************************************************************************/
-void ann::predict(std::ostream& ostream,
-                  const double threshold)
+template <typename T>
+void ann<T>::predict(std::ostream& ostream,
+                     const double threshold)
 {
-   this->predict(this->train_in);
+   const auto& data = this->train_data;
+   ostream << "--------------------------------------------------------------------------------\n";
+
+   for (std::size_t i = 0; i < data.num_sets(); ++i)
+   {
+      this->hidden_layer.feedforward(data.input(i), data.num_inputs(), this->hidden_layer.output.data());
+      this->output_layer.feedforward(this->hidden_layer.output);
+      ostream << "Input: ";
+      dense_layer<T>::print_parameters(data.input(i), data.num_inputs(), ostream, threshold);
+
+      ostream << "Output: ";
+      dense_layer<T>::print_parameters(this->output_layer.output, ostream, threshold);
+      if (i + 1 < data.num_sets()) ostream << "\n";
+   }
+
+   ostream << "--------------------------------------------------------------------------------\n\n";
    return;
 }
 
@@ -129,9 +918,10 @@ void ann::predict(std::ostream& ostream,
 *                       inom intervallet [-threshold, threshold] avrundas till
 *                       noll (default = 0.001).
 ********************************************************************************/
-void ann::predict(const std::vector<std::vector<double>>& input,
-                  std::ostream& ostream,
-                  const double threshold)
+template <typename T>
+void ann<T>::predict(const std::vector<std::vector<T>>& input,
+                     std::ostream& ostream,
+                     const double threshold)
 {
    const auto* end = &input[input.size() - 1];
    ostream << "--------------------------------------------------------------------------------\n";
@@ -140,10 +930,10 @@ void ann::predict(const std::vector<std::vector<double>>& input,
    {
       const auto& prediction = this->predict(i);
       ostream << "Input: ";
-      dense_layer::print_parameters(i, ostream, threshold);
+      dense_layer<T>::print_parameters(i, ostream, threshold);
 
       ostream << "Output: ";
-      dense_layer::print_parameters(prediction, ostream, threshold);
+      dense_layer<T>::print_parameters(prediction, ostream, threshold);
       if (&i < end) ostream << "\n";
    }
 
@@ -152,47 +942,682 @@ void ann::predict(const std::vector<std::vector<double>>& input,
 }
 
 /********************************************************************************
-* shuffle: Randomiserar den inbrdes ordningen p trningsuppsttningarna fr
-*          angivet neuralt ntverk, vilket genomfrs i syfte att minska risken 
-*          fr att eventuella icke avsedda mnster som i trningsdatan skall
-*          pverka trningen.
+* save: Sparar angivet neuralt ntverks topologi samt parametrar till angiven
+*       binrfil enligt formatet beskrivet fr model_header. Vikterna skrivs
+*       med samma utfyllnad som i minnet, s att filen kan minnesmappas och
+*       anvndas direkt via load. Returnerar true om skrivningen lyckades.
+*
+*       - filename: Skvg till filen som skall skrivas.
+********************************************************************************/
+template <typename T>
+bool ann<T>::save(const std::string& filename) const
+{
+   std::ofstream ofstream(filename, std::ios::binary | std::ios::trunc);
+   if (!ofstream) return false;
+
+   model_header header{};
+   std::memcpy(header.magic, model_magic, sizeof(model_magic));
+   header.version = model_version;
+   header.value_size = sizeof(T);
+   header.byte_order = model_byte_order;
+   header.num_layers = model_layers;
+   header.num_inputs = this->num_inputs();
+   header.num_hidden = this->num_hidden();
+   header.num_outputs = this->num_outputs();
+   ofstream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+   for (const auto* layer : { &this->hidden_layer, &this->output_layer })
+   {
+      std::vector<T> bias(matrix<T>::padded(layer->num_nodes()), 0);
+      std::copy(layer->bias.begin(), layer->bias.end(), bias.begin());
+      ofstream.write(reinterpret_cast<const char*>(bias.data()), bias.size() * sizeof(T));
+      ofstream.write(reinterpret_cast<const char*>(layer->weights.elements()), layer->weights.size() * sizeof(T));
+   }
+
+   return static_cast<bool>(ofstream);
+}
+
+/********************************************************************************
+* load: Lser in topologi samt parametrar fr angivet neuralt ntverk frn
+*       angiven binrfil, skriven via save. Filen minnesmappas privat och
+*       vikterna anvnds direkt frn det mappade minnet, s att inlsningen
+*       endast tar ngon millisekund oavsett modellens storlek och att flera
+*       processer som lser samma modell delar samma fysiska minnessidor.
+*       Vid fortsatt trning kopieras berrda sidor via copy-on-write, utan
+*       att filen pverkas. Returnerar true om inlsningen lyckades, annars
+*       false, varvid ntverket lmnas ofrndrat.
+*
+*       - filename: Skvg till filen som skall lsas in.
 ********************************************************************************/
-void ann::shuffle(void)
+template <typename T>
+bool ann<T>::load(const std::string& filename)
 {
-   for (std::size_t i = 0; i < this->num_sets(); ++i)
+   auto model = std::make_shared<mapped_file>();
+   model_header header{};
+
+   if (!model->open(filename, true) || model->size() < sizeof(header)) return false;
+   std::memcpy(&header, model->data(), sizeof(header));
+
+   if (std::memcmp(header.magic, model_magic, sizeof(model_magic)) != 0 ||
+       header.version != model_version || header.value_size != sizeof(T) ||
+       header.byte_order != model_byte_order || header.num_layers != model_layers)
+   {
+      return false;
+   }
+
+   const std::uint64_t dimensions[] = { header.num_inputs, header.num_hidden, header.num_outputs };
+   std::uint64_t size = sizeof(header);
+
+   for (std::size_t i = 1; i < 3; ++i)
+   {
+      if (dimensions[i] > model->size() || dimensions[i - 1] > model->size()) return false;
+      size += (matrix<T>::padded(dimensions[i]) + dimensions[i] * matrix<T>::padded(dimensions[i - 1])) * sizeof(T);
+   }
+
+   if (size > model->size()) return false;
+   auto* parameters = reinterpret_cast<T*>(model->data() + sizeof(header));
+
+   for (std::size_t i = 1; i < 3; ++i)
    {
-      const auto r = std::rand() % this->num_sets();
-      const auto temp = this->train_order[i];
-      this->train_order[i] = this->train_order[r];
-      this->train_order[r] = temp;
+      auto& layer = i == 1 ? this->hidden_layer : this->output_layer;
+      const auto* bias = parameters;
+      auto* weights = parameters + matrix<T>::padded(dimensions[i]);
+
+      layer.attach(bias, weights, dimensions[i], dimensions[i - 1]);
+      parameters = weights + dimensions[i] * matrix<T>::padded(dimensions[i - 1]);
    }
 
+   this->model = std::move(model);
+   this->generation = next_generation();
+   return true;
+}
+
+/********************************************************************************
+* next_generation: Returnerar en ny generation fr parametrarna i ett neuralt
+*                  ntverk, som r unik bland samtliga ntverk av typen T i
+*                  processen. Rknaren startar p 1, s att generation 0
+*                  aldrig tillhr ett ntverk.
+********************************************************************************/
+template <typename T>
+std::uint64_t ann<T>::next_generation(void)
+{
+   static std::atomic<std::uint64_t> counter{ 0 };
+   return ++counter;
+}
+
+/********************************************************************************
+* shuffle: Randomiserar den inbrdes ordningen p trningsuppsttningarna fr
+*          angivet neuralt ntverk, vilket genomfrs i syfte att minska risken 
+*          fr att eventuella icke avsedda mnster som i trningsdatan skall
+*          pverka trningen. Randomiseringen sker via ntverkets egen
+*          generator och endast i en trd, ven vid parallell trning, s att
+*          ordningsfljden endast beror av startvrdet.
+********************************************************************************/
+template <typename T>
+void ann<T>::shuffle(void)
+{
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::shuffle);
+   this->generator.shuffle(this->train_order.data(), this->train_order.size());
    return;
 }
 
 /********************************************************************************
 * optimize: Berknar aktuella avvikelser fr angivet neuralt ntver med angiven 
 *           trningsdata och justerar ntverkets parametrar drefter.
+*           Utgngslagrets vikter justeras i samma passage som avvikelserna
+*           sprids bakt till det dolda lagret, s att varje viktrad endast
+*           lses en gng per trningsuppsttning. Returnerar summan av de
+*           kvadrerade avvikelserna, berknade vid backpropagation.
 *
-*           input        : Kombination av indata frn trningsdata som
+*           input        : Pekare till indata frn trningsdatan som
 *                          prediktion skall genomfras utefter.
-*           reference    : Referensvrde frn trningsdatan, vilket utgr det
-*                          vrde som ntverket nskas prediktera.
+*           reference    : Pekare till referensvrden frn trningsdatan,
+*                          vilka utgr de vrden som ntverket nskas
+*                          prediktera.
 *           learning_rate: Lrhastigheten, som avgr hur mycket ntverkets
 *                          parametrar justeras vid fel.
 ********************************************************************************/
-void ann::optimize(const std::vector<double>& input,
-                   const std::vector<double>& reference,
-                   const double learning_rate)
+template <typename T>
+double ann<T>::optimize(const T* input,
+                        const T* reference,
+                        const T learning_rate)
+{
+   const auto num_inputs = this->train_data.num_inputs();
+   ANN_PROFILE_RUN(this->profile.add_samples(1));
+
+   {
+      ANN_PROFILE_SCOPE(this->profile, profile_phase::feedforward);
+      this->hidden_layer.feedforward(input, num_inputs, this->hidden_layer.output.data());
+      this->output_layer.feedforward(hidden_layer.output);
+   }
+
+   double loss = 0;
+
+   {
+      ANN_PROFILE_SCOPE(this->profile, profile_phase::backpropagate);
+      loss = this->output_layer.backpropagate(reference, this->train_data.num_outputs());
+      this->hidden_layer.backpropagate(this->output_layer, learning_rate);
+   }
+
+   ANN_PROFILE_RUN(this->profile.add_loss(loss, this->num_outputs()));
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::optimize);
+   this->hidden_layer.optimize(input, num_inputs, learning_rate);
+   return loss;
+}
+
+/********************************************************************************
+* optimize: Berknar aktuella avvikelser fr angivet neuralt ntverk fr en
+*           minibatch bestende av de trningsuppsttningar som terfinns p
+*           index [first, first + num_samples) i aktuell ordningsfljd och
+*           justerar ntverkets parametrar med medelvrdet av gradienterna.
+*           Returnerar summan av de kvadrerade avvikelserna fr batchen.
+*
+*           first        : Frsta index i ordningsfljden som ingr i batchen.
+*           num_samples  : Antalet trningsuppsttningar i batchen.
+*           learning_rate: Lrhastigheten, som avgr hur mycket ntverkets
+*                          parametrar justeras vid fel.
+********************************************************************************/
+template <typename T>
+double ann<T>::optimize(const std::size_t first,
+                        const std::size_t num_samples,
+                        const T learning_rate)
+{
+   this->load_batch(this->batch, first, num_samples);
+   const auto loss = this->compute_gradients(this->batch, num_samples);
+
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::optimize);
+   this->output_layer.optimize(this->batch.output, num_samples, learning_rate);
+   this->hidden_layer.optimize(this->batch.hidden, num_samples, learning_rate);
+   return loss;
+}
+
+/********************************************************************************
+* optimize: Berknar aktuella avvikelser fr angivet neuralt ntverk med
+*           angiven gles indata och justerar ntverkets parametrar drefter.
+*           Det dolda lagret lser och justerar endast vikterna fr de
+*           indata som r skilda frn noll. Returnerar summan av de
+*           kvadrerade avvikelserna.
+*
+*           input         : Gles indata som prediktion skall genomfras
+*                           utefter.
+*           reference     : Pekare till referensvrden fr indatan.
+*           num_references: Antalet referensvrden.
+*           learning_rate : Lrhastigheten, som avgr hur mycket ntverkets
+*                           parametrar justeras vid fel.
+********************************************************************************/
+template <typename T>
+double ann<T>::optimize(const sparse_row<T>& input,
+                        const T* reference,
+                        const std::size_t num_references,
+                        const T learning_rate)
+{
+   ANN_PROFILE_RUN(this->profile.add_samples(1));
+
+   {
+      ANN_PROFILE_SCOPE(this->profile, profile_phase::feedforward);
+      this->hidden_layer.feedforward(input, this->hidden_layer.output.data());
+      this->output_layer.feedforward(this->hidden_layer.output);
+   }
+
+   double loss = 0;
+
+   {
+      ANN_PROFILE_SCOPE(this->profile, profile_phase::backpropagate);
+      loss = this->output_layer.backpropagate(reference, num_references);
+      this->hidden_layer.backpropagate(this->output_layer, learning_rate);
+   }
+
+   ANN_PROFILE_RUN(this->profile.add_loss(loss, this->num_outputs()));
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::optimize);
+   this->hidden_layer.optimize(input, learning_rate);
+   return loss;
+}
+
+/********************************************************************************
+* optimize: Berknar aktuella avvikelser fr angivet neuralt ntverk fr en
+*           minibatch bestende av angivna glesa rader, vars referensdata
+*           har lsts in i ntverkets batch, och justerar parametrarna med
+*           medelvrdet av gradienterna. Utgngslagret justeras via
+*           ackumulerade gradienter, medan det dolda lagret justeras glest.
+*           Returnerar summan av de kvadrerade avvikelserna fr batchen.
+*
+*           input        : Pekare till glesa indata, en rad per
+*                          trningsuppsttning.
+*           num_samples  : Antalet trningsuppsttningar i batchen.
+*           learning_rate: Lrhastigheten, som avgr hur mycket ntverkets
+*                          parametrar justeras vid fel.
+********************************************************************************/
+template <typename T>
+double ann<T>::optimize(const sparse_row<T>* input,
+                        const std::size_t num_samples,
+                        const T learning_rate)
+{
+   auto& batch = this->batch;
+   double loss = 0;
+   ANN_PROFILE_RUN(this->profile.add_samples(num_samples));
+
+   {
+      ANN_PROFILE_SCOPE(this->profile, profile_phase::feedforward);
+      this->hidden_layer.feedforward(input, num_samples, batch.hidden);
+      this->output_layer.feedforward(batch.hidden.output, num_samples, batch.output);
+   }
+
+   {
+      ANN_PROFILE_SCOPE(this->profile, profile_phase::backpropagate);
+      loss = this->output_layer.backpropagate(batch.reference, num_samples, batch.output);
+      this->hidden_layer.backpropagate(this->output_layer, batch.output, num_samples, batch.hidden);
+      this->output_layer.accumulate(batch.hidden.output, num_samples, batch.output);
+   }
+
+   ANN_PROFILE_RUN(this->profile.add_loss(loss, num_samples * this->num_outputs()));
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::optimize);
+   this->output_layer.optimize(batch.output, num_samples, learning_rate);
+   this->hidden_layer.optimize(input, num_samples, batch.hidden, learning_rate);
+   return loss;
+}
+
+/********************************************************************************
+* load_batch: Kopierar in- och referensdata fr de trningsuppsttningar som
+*             terfinns p index [first, first + num_samples) i aktuell
+*             ordningsfljd till angiven batch. Rader kortare n batchens
+*             bredd fylls ut med nollor.
+*
+*             batch      : Den batch som data kopieras till.
+*             first      : Frsta index i ordningsfljden som ingr i batchen.
+*             num_samples: Antalet trningsuppsttningar i batchen.
+********************************************************************************/
+template <typename T>
+void ann<T>::load_batch(ann_batch<T>& batch,
+                        const std::size_t first,
+                        const std::size_t num_samples) const
+{
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::load);
+
+   for (std::size_t s = 0; s < num_samples; ++s)
+   {
+      const auto k = this->train_order[first + s];
+      const auto* input = this->train_data.input(k);
+      const auto* reference = this->train_data.output(k);
+      const auto num_inputs = std::min(this->train_data.num_inputs(), batch.input.cols);
+      const auto num_references = std::min(this->train_data.num_outputs(), batch.reference.cols);
+
+      std::copy(input, input + num_inputs, batch.input[s]);
+      std::fill(batch.input[s] + num_inputs, batch.input[s] + batch.input.cols, 0);
+      std::copy(reference, reference + num_references, batch.reference[s]);
+      std::fill(batch.reference[s] + num_references, batch.reference[s] + batch.reference.cols, 0);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* compute_gradients: Genomfr feedforward och backpropagation fr de frsta
+*                    num_samples trningsuppsttningarna i angiven batch och
+*                    ackumulerar gradienterna fr respektive lager i batchen.
+*                    Ntverkets parametrar lses men justeras inte, vilket
+*                    medfr att flera trdar kan berkna gradienter samtidigt
+*                    med var sin batch. Returnerar summan av de kvadrerade
+*                    avvikelserna fr batchen.
+*
+*                    batch      : Batch innehllande in- och referensdata, dr
+*                                 berknade gradienter lagras.
+*                    num_samples: Antalet trningsuppsttningar i batchen.
+********************************************************************************/
+template <typename T>
+double ann<T>::compute_gradients(ann_batch<T>& batch,
+                                 const std::size_t num_samples) const
+{
+   ANN_PROFILE_RUN(this->profile.add_samples(num_samples));
+
+   {
+      ANN_PROFILE_SCOPE(this->profile, profile_phase::feedforward);
+      this->hidden_layer.feedforward(batch.input, num_samples, batch.hidden);
+      this->output_layer.feedforward(batch.hidden.output, num_samples, batch.output);
+   }
+
+   ANN_PROFILE_SCOPE(this->profile, profile_phase::backpropagate);
+   const double loss = this->output_layer.backpropagate(batch.reference, num_samples, batch.output);
+   ANN_PROFILE_RUN(this->profile.add_loss(loss, num_samples * this->num_outputs()));
+   this->hidden_layer.backpropagate(this->output_layer, batch.output, num_samples, batch.hidden);
+
+   this->output_layer.accumulate(batch.hidden.output, num_samples, batch.output);
+   this->hidden_layer.accumulate(batch.input, num_samples, batch.hidden);
+   return loss;
+}
+
+/********************************************************************************
+* train_parallel: Trnar angivet neuralt ntverk under angivet antal epoker
+*                 frdelat ver angivet antal trdar, dr varje trd har egna
+*                 buffertar fr utdata, avvikelser och gradienter. Den frsta
+*                 trden randomiserar ordningsfljden i brjan av varje epok
+*                 medan vriga trdar vntar.
+*
+*                 Vid synkron trning berknar varje trd gradienterna fr en
+*                 egen minibatch om batch_size trningsuppsttningar per steg,
+*                 s att varje steg omfattar batch_size gnger antalet trdar
+*                 uppsttningar. Ett ofullstndigt sista steg delas jmnt mellan
+*                 trdarna. Nr samtliga trdar har berknat sina gradienter
+*                 summerar varje trd gradienterna fr sin andel av nodernas
+*                 rader i den sista trdens buffertar, som alltid innehller
+*                 minst en trningsuppsttning, och justerar motsvarande
+*                 parametrar en gng, s att bde summering och justering
+*                 frdelas ver trdarna och optimerare med moment ser hela
+*                 batchens gradient.
+*
+*                 Vid trning enligt Hogwild trnar varje trd p en egen del
+*                 av epokens trningsuppsttningar och justerar de delade
+*                 parametrarna direkt efter varje minibatch utan ls. Eftersom
+*                 optimerarnas moment och Adams biaskorrigering d skulle
+*                 skrivas av flera trdar utan synkronisering anvnds synkron
+*                 trning i stllet om ngot lager har en annan optimerare n
+*                 gradient descent.
+*
+*                 Varje trd summerar frlusten fr sina trningsuppsttningar
+*                 i en egen plats, vilka summeras nr trdarna har avslutats.
+*                 Returnerar genomsnittlig kvadrerad avvikelse per utsignal
+*                 under den sista epoken.
+*
+*                 - num_epochs   : Antalet epoker som trning skall genomfras.
+*                 - learning_rate: Lrhastigheten fr trningen.
+*                 - batch_size   : Antalet trningsuppsttningar per minibatch
+*                                  och trd.
+*                 - num_threads  : Antalet trdar, dr 0 innebr en trd per
+*                                  processorkrna.
+*                 - mode         : Anger hur trningen frdelas mellan trdarna.
+********************************************************************************/
+template <typename T>
+double ann<T>::train_parallel(const std::size_t num_epochs,
+                              const T learning_rate,
+                              const std::size_t batch_size,
+                              const std::size_t num_threads,
+                              const parallel_mode mode)
+{
+   const auto hardware_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+   const auto thread_count = num_threads > 0 ? num_threads : hardware_threads;
+   const auto max_batch = std::max<std::size_t>(batch_size, 1);
+   const bool synchronized = mode == parallel_mode::synchronous ||
+                             this->hidden_layer.optimizer.type != optimizer_type::sgd ||
+                             this->output_layer.optimizer.type != optimizer_type::sgd;
+   const auto step_size = synchronized ? max_batch * thread_count : max_batch;
+
+   std::vector<ann_batch<T>> workers(thread_count);
+   std::vector<std::size_t> worker_samples(thread_count, 0);
+   std::vector<double> worker_loss(thread_count, 0);
+   barrier sync(thread_count);
+
+   for (auto& i : workers)
+   {
+      i.resize(max_batch, this->hidden_layer.num_weights(), this->num_hidden(), this->num_outputs());
+   }
+
+   auto synchronous = [&](const std::size_t t)
+   {
+      for (std::size_t epoch = 0; epoch < num_epochs; ++epoch)
+      {
+         ANN_PROFILE_RUN(if (t == 0) this->profile.begin_epoch());
+         if (t == 0) this->shuffle();
+         worker_loss[t] = 0;
+         sync.wait();
+
+         for (std::size_t first = 0; first < this->num_sets(); first += step_size)
+         {
+            const auto num_samples = std::min(step_size, this->num_sets() - first);
+            const auto begin = first + num_samples * t / thread_count;
+            const auto end = first + num_samples * (t + 1) / thread_count;
+            worker_samples[t] = end - begin;
+
+            if (end > begin)
+            {
+               this->load_batch(workers[t], begin, end - begin);
+               worker_loss[t] += this->compute_gradients(workers[t], end - begin);
+            }
+
+            sync.wait();
+
+            {
+               ANN_PROFILE_SCOPE(this->profile, profile_phase::optimize);
+               auto& total = workers[thread_count - 1];
+
+               for (std::size_t w = 0; w + 1 < thread_count; ++w)
+               {
+                  if (worker_samples[w] == 0) continue;
+                  total.hidden.add(workers[w].hidden, t, thread_count);
+                  total.output.add(workers[w].output, t, thread_count);
+               }
+
+               this->hidden_layer.optimize(total.hidden, num_samples, learning_rate, t, thread_count);
+               this->output_layer.optimize(total.output, num_samples, learning_rate, t, thread_count);
+            }
+
+            sync.wait();
+         }
+
+         ANN_PROFILE_RUN(if (t == 0) this->profile.end_epoch());
+      }
+   };
+
+   auto hogwild = [&](const std::size_t t)
+   {
+      for (std::size_t epoch = 0; epoch < num_epochs; ++epoch)
+      {
+         ANN_PROFILE_RUN(if (t == 0) this->profile.begin_epoch());
+         if (t == 0) this->shuffle();
+         worker_loss[t] = 0;
+         sync.wait();
+
+         const auto begin = this->num_sets() * t / thread_count;
+         const auto end = this->num_sets() * (t + 1) / thread_count;
+
+         for (std::size_t first = begin; first < end; first += max_batch)
+         {
+            const auto num_samples = std::min(max_batch, end - first);
+            this->load_batch(workers[t], first, num_samples);
+            worker_loss[t] += this->compute_gradients(workers[t], num_samples);
+
+            ANN_PROFILE_SCOPE(this->profile, profile_phase::optimize);
+            this->output_layer.optimize(workers[t].output, num_samples, learning_rate);
+            this->hidden_layer.optimize(workers[t].hidden, num_samples, learning_rate);
+         }
+
+         sync.wait();
+         ANN_PROFILE_RUN(if (t == 0) this->profile.end_epoch());
+      }
+   };
+
+   std::vector<std::thread> threads;
+
+   for (std::size_t t = 1; t < thread_count; ++t)
+   {
+      if (synchronized) threads.emplace_back(synchronous, t);
+      else threads.emplace_back(hogwild, t);
+   }
+
+   if (synchronized) synchronous(0);
+   else hogwild(0);
+
+   for (auto& i : threads)
+   {
+      i.join();
+   }
+
+   return this->mean_loss(std::accumulate(worker_loss.begin(), worker_loss.end(), 0.0), this->num_sets());
+}
+
+/********************************************************************************
+* evaluate: Returnerar genomsnittlig kvadrerad avvikelse per utsignal fr
+*           angivna trningsuppsttningar utan att ntverket justeras.
+*           Anvnds fr att mta valideringsfrlusten vid trning.
+*
+*           sets: Index fr de trningsuppsttningar som utvrderas.
+********************************************************************************/
+template <typename T>
+double ann<T>::evaluate(const std::vector<std::size_t>& sets) const
 {
-   this->input_layer = &input;
-   this->hidden_layer.feedforward(*this->input_layer);
-   this->output_layer.feedforward(hidden_layer.output);
+   const auto& data = this->train_data;
+   const auto num_references = std::min(this->num_outputs(), data.num_outputs());
+   auto workspace = this->workspace();
+   double loss = 0;
 
-   this->output_layer.backpropagate(reference);
-   this->hidden_layer.backpropagate(output_layer);
+   for (const auto k : sets)
+   {
+      this->hidden_layer.feedforward(data.input(k), data.num_inputs(), workspace.hidden.data());
+      this->output_layer.feedforward(workspace.hidden.data(), workspace.hidden.size(), workspace.output.data());
 
-   this->output_layer.optimize(this->hidden_layer.output, learning_rate);
-   this->hidden_layer.optimize(*this->input_layer, learning_rate);
+      for (std::size_t i = 0; i < num_references; ++i)
+      {
+         const double deviation = data.output(k)[i] - workspace.output[i];
+         loss += deviation * deviation;
+      }
+   }
+
+   return this->mean_loss(loss, sets.size());
+}
+
+/********************************************************************************
+* mean_loss: Returnerar angiven summa av kvadrerade avvikelser dividerad med
+*            antalet utsignaler fr angivet antal trningsuppsttningar,
+*            eller 0 om antalet r noll.
+*
+*            loss    : Summan av kvadrerade avvikelser.
+*            num_sets: Antalet trningsuppsttningar som summan avser.
+********************************************************************************/
+template <typename T>
+double ann<T>::mean_loss(const double loss,
+                         const std::size_t num_sets) const
+{
+   const auto count = static_cast<double>(num_sets) * this->num_outputs();
+   return count > 0 ? loss / count : 0;
+}
+
+/********************************************************************************
+* learning_rate_at: Returnerar lrhastigheten fr angiven epok (rknat frn
+*                   0) enligt valt schema, dock lgst min_learning_rate.
+*
+*                   - epoch: Den epok vars lrhastighet skall returneras.
+********************************************************************************/
+template <typename T>
+T train_options<T>::learning_rate_at(const std::size_t epoch) const
+{
+   constexpr double pi = 3.14159265358979323846;
+   double learning_rate = this->learning_rate;
+
+   if (this->schedule == learning_schedule::step)
+   {
+      learning_rate *= std::pow(this->decay, static_cast<double>(epoch / std::max<std::size_t>(this->step_size, 1)));
+   }
+   else if (this->schedule == learning_schedule::exponential)
+   {
+      learning_rate *= std::pow(this->decay, static_cast<double>(epoch));
+   }
+   else if (this->schedule == learning_schedule::cosine && this->num_epochs > 0)
+   {
+      const auto progress = static_cast<double>(epoch) / this->num_epochs;
+      learning_rate = this->min_learning_rate + 0.5 * (learning_rate - this->min_learning_rate) * (1 + std::cos(pi * progress));
+   }
+
+   return std::max(static_cast<T>(learning_rate), this->min_learning_rate);
+}
+
+/********************************************************************************
+* print: Skriver ut en sammanfattning av angiven trning via angiven utstrm.
+*
+*        - ostream: Angiven utstrm (default = std::cout).
+********************************************************************************/
+void train_report::print(std::ostream& ostream) const
+{
+   ostream << "--------------------------------------------------------------------------------\n";
+   ostream << "Epochs: " << this->epochs;
+   if (this->converged) ostream << " (target loss reached)";
+   else if (this->stopped_early) ostream << " (stopped early)";
+   ostream << "\n";
+   if (!this->train_loss.empty()) ostream << "Train loss: " << this->train_loss.back() << "\n";
+   if (!this->validation_loss.empty()) ostream << "Validation loss: " << this->validation_loss.back() << "\n";
+   ostream << "Best loss: " << this->best_loss << " (epoch " << this->best_epoch << ")\n";
+   ostream << "Time: " << this->seconds << " s\n";
+   ostream << "--------------------------------------------------------------------------------\n\n";
    return;
 }
+
+/********************************************************************************
+* resize: Allokerar buffertar fr angiven batchstorlek i ett neuralt ntverk
+*         med angivet antal noder i respektive lager. Om buffertarna redan
+*         har angiven storlek genomfrs ingen omallokering.
+*
+*         - batch_size : Maximalt antal trningsuppsttningar per batch.
+*         - num_inputs : Antalet noder i ingngslagret.
+*         - num_hidden : Antalet noder i det dolda lagret.
+*         - num_outputs: Antalet noder i utgngslagret.
+********************************************************************************/
+template <typename T>
+void ann_batch<T>::resize(const std::size_t batch_size,
+                          const std::size_t num_inputs,
+                          const std::size_t num_hidden,
+                          const std::size_t num_outputs)
+{
+   if (this->input.rows != batch_size || this->input.cols != num_inputs)
+   {
+      this->input.resize(batch_size, num_inputs);
+   }
+
+   if (this->reference.rows != batch_size || this->reference.cols != num_outputs)
+   {
+      this->reference.resize(batch_size, num_outputs);
+   }
+
+   this->hidden.resize(batch_size, num_hidden, num_inputs);
+   this->output.resize(batch_size, num_outputs, num_hidden);
+   return;
+}
+
+/********************************************************************************
+* resize: Anpassar angiven arbetsyta till angivet antal noder i det dolda
+*         lagret samt utgngslagret. Om arbetsytan redan har angiven storlek
+*         genomfrs ingen omallokering.
+*
+*         - num_hidden : Antalet noder i det dolda lagret.
+*         - num_outputs: Antalet noder i utgngslagret.
+********************************************************************************/
+template <typename T>
+void ann_workspace<T>::resize(const std::size_t num_hidden,
+                              const std::size_t num_outputs)
+{
+   if (this->hidden.size() != num_hidden) this->hidden.resize(num_hidden, 0);
+   if (this->output.size() != num_outputs) this->output.resize(num_outputs, 0);
+   return;
+}
+
+/********************************************************************************
+* resize: Anpassar angivet tillstnd fr inkrementell prediktion till angivet
+*         antal noder i respektive lager, dr nya element stts till 0.
+*         Buffertarna fr frndringar reserveras fr samtliga indata, s att
+*         efterfljande anrop av ann::update sker utan minnesallokering.
+*
+*         - num_inputs : Antalet noder i ingngslagret.
+*         - num_hidden : Antalet noder i det dolda lagret.
+*         - num_outputs: Antalet noder i utgngslagret.
+********************************************************************************/
+template <typename T>
+void ann_incremental<T>::resize(const std::size_t num_inputs,
+                                const std::size_t num_hidden,
+                                const std::size_t num_outputs)
+{
+   this->input.resize(num_inputs, 0);
+   this->sum.resize(num_hidden, 0);
+   this->hidden.resize(num_hidden, 0);
+   this->output.resize(num_outputs, 0);
+   this->changed.reserve(num_inputs);
+   this->delta.reserve(num_inputs);
+   return;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template struct ann_batch<float>;
+template struct ann_batch<double>;
+template struct ann_workspace<float>;
+template struct ann_workspace<double>;
+template struct ann_incremental<float>;
+template struct ann_incremental<double>;
+template struct train_options<float>;
+template struct train_options<double>;
+template struct ann<float>;
+template struct ann<double>;
\ No newline at end of file
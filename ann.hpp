@@ -6,52 +6,359 @@
 #define ANN_HPP_
 
 /* Inkluderingsdirektiv: */
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "data_stream.hpp"
+#include "dataset.hpp"
 #include "dense_layer.hpp"
+#include "mapped_file.hpp"
+#include "profile.hpp"
+#include "rng.hpp"
+#include "sparse.hpp"
+
+/********************************************************************************
+* parallel_mode: Anger hur trning frdelas ver flera trdar.
+*
+*                - synchronous: Varje trd berknar gradienterna fr en
+*                               egen minibatch, varefter gradienterna
+*                               summeras och parametrarna justeras en gng
+*                               per steg. Resultatet motsvarar trning med
+*                               en trd och batchstorleken gnger antalet
+*                               trdar.
+*                - hogwild    : Varje trd trnar p sin del av epoken och
+*                               justerar de delade parametrarna direkt utan
+*                               ls, vilket ger minimal synkronisering p
+*                               bekostnad av att uppdateringar kan skrivas
+*                               ver av andra trdar. Gller endast gradient
+*                               descent, eftersom momentum, RMSProp och Adam
+*                               har ett tillstnd som inte kan delas utan
+*                               synkronisering. Med ngon av dessa
+*                               optimerare anvnds synkron trning i stllet.
+********************************************************************************/
+enum class parallel_mode { synchronous, hogwild };
+
+/********************************************************************************
+* learning_schedule: Anger hur lrhastigheten frndras mellan epoker vid
+*                    trning via train_options.
+*
+*                    - constant   : Lrhastigheten r densamma fr samtliga
+*                                   epoker.
+*                    - step       : Lrhastigheten multipliceras med decay
+*                                   efter var step_size:e epok.
+*                    - exponential: Lrhastigheten multipliceras med decay
+*                                   efter varje epok.
+*                    - cosine     : Lrhastigheten minskar lngs en halv
+*                                   cosinusperiod frn angiven lrhastighet
+*                                   till min_learning_rate under num_epochs
+*                                   epoker.
+********************************************************************************/
+enum class learning_schedule { constant, step, exponential, cosine };
+
+/********************************************************************************
+* train_options: Instllningar fr trning via ann::train(train_options),
+*                dr trningen kan avbrytas s snart frlusten nr angiven
+*                niv eller nr frlusten inte har frbttrats under angivet
+*                antal epoker. En andel av trningsdatan kan hllas utanfr
+*                trningen fr validering, varvid valideringsfrlusten avgr
+*                nr trningen avbryts. Annars anvnds trningsfrlusten.
+********************************************************************************/
+template <typename T = double>
+struct train_options
+{
+   /* Medlemmar: */
+   std::size_t num_epochs = 1;                               /* Maximalt antal epoker. */
+   T learning_rate = T(0.01);                                /* Lrhastighet fr frsta epoken. */
+   std::size_t batch_size = 1;                               /* Antalet trningsuppsttningar per minibatch. */
+   std::size_t num_threads = 1;                              /* Antalet trdar, 0 = en per processorkrna. */
+   parallel_mode mode = parallel_mode::synchronous;          /* Frdelning av trningen mellan trdarna. */
+   double validation_split = 0;                              /* Andel uppsttningar som anvnds fr validering. */
+   double target_loss = 0;                                   /* Frlust dr trningen avbryts, 0 = ingen. */
+   std::size_t patience = 0;                                 /* Epoker utan frbttring innan avbrott, 0 = aldrig. */
+   double min_delta = 0;                                     /* Minsta minskning som rknas som frbttring. */
+   bool restore_best = true;                                 /* Indikerar terstllning till bsta epokens parametrar. */
+   learning_schedule schedule = learning_schedule::constant; /* Frndring av lrhastigheten mellan epoker. */
+   double decay = 0.5;                                       /* Faktor fr learning_schedule::step och exponential. */
+   std::size_t step_size = 10;                               /* Antalet epoker per steg fr learning_schedule::step. */
+   T min_learning_rate = 0;                                  /* Lgsta tilltna lrhastighet. */
+   optimizer_options<T> optimizer;                           /* Optimerare fr samtliga lager. */
+
+   /* Medlemsfunktioner: */
+   T learning_rate_at(const std::size_t epoch) const;
+};
+
+/********************************************************************************
+* train_report: Resultat frn trning via ann::train(train_options), dr
+*               frlusten utgrs av genomsnittlig kvadrerad avvikelse per
+*               utsignal.
+********************************************************************************/
+struct train_report
+{
+   /* Medlemmar: */
+   std::vector<double> train_loss;      /* Trningsfrlust per epok. */
+   std::vector<double> validation_loss; /* Valideringsfrlust per epok, tom utan validering. */
+   std::vector<double> learning_rate;   /* Anvnd lrhastighet per epok. */
+   std::size_t epochs = 0;              /* Antalet genomfrda epoker. */
+   std::size_t best_epoch = 0;          /* Epok med lgst frlust (rknat frn 1). */
+   double best_loss = 0;                /* Lgsta uppmtta frlust. */
+   bool converged = false;              /* Indikerar att target_loss uppnddes. */
+   bool stopped_early = false;          /* Indikerar avbrott efter patience epoker utan frbttring. */
+   double seconds = 0;                  /* Total trningstid i sekunder. */
+
+   /* Medlemsfunktioner: */
+   void print(std::ostream& ostream = std::cout) const;
+};
+
+/********************************************************************************
+* model_header: Huvud fr binrt lagrade modeller, som upptar de frsta 64
+*               byten i filen. Drefter fljer bias samt vikter fr det dolda
+*               lagret och sedan fr utgngslagret. Bias fylls ut med nollor
+*               till en multipel av en cache-line och vikterna lagras radvis
+*               med samma utfyllnad som i strukten matrix, s att samtliga
+*               parametrar r justerade och kan anvndas direkt nr filen
+*               minnesmappas. Vrdena lagras i processorns egen byteordning.
+********************************************************************************/
+struct model_header
+{
+   char magic[8];             /* Filsignatur, "ANNMODEL". */
+   std::uint32_t version;     /* Filformatets version. */
+   std::uint32_t value_size;  /* Antalet byte per parameter (4 = float, 8 = double). */
+   std::uint32_t byte_order;  /* Vrdet 0x01020304 skrivet i filens byteordning. */
+   std::uint32_t num_layers;  /* Antalet lager med parametrar. */
+   std::uint64_t num_inputs;  /* Antalet noder i ingngslagret. */
+   std::uint64_t num_hidden;  /* Antalet noder i det dolda lagret. */
+   std::uint64_t num_outputs; /* Antalet noder i utgngslagret. */
+   std::uint8_t padding[16];  /* Utfyllnad till 64 byte, stts till 0. */
+};
+
+static_assert(sizeof(model_header) == 64, "model_header must occupy 64 bytes!");
+
+/********************************************************************************
+* ann_batch: Strukt innehllande samtliga buffertar som krvs fr att trna
+*            ett neuralt ntverk p en minibatch, dvs. indata, referensdata
+*            samt utdata, avvikelser och gradienter fr respektive lager.
+*            Vid parallell trning har varje trd en egen instans, s att
+*            trdarna inte skriver till gemensamma buffertar.
+********************************************************************************/
+template <typename T = double>
+struct ann_batch
+{
+   /* Medlemmar: */
+   matrix<T> input;       /* Indata, en rad per trningsuppsttning. */
+   matrix<T> reference;   /* Referensdata, en rad per trningsuppsttning. */
+   dense_batch<T> hidden; /* Buffertar fr det dolda lagret. */
+   dense_batch<T> output; /* Buffertar fr utgngslagret. */
+
+   /* Medlemsfunktioner: */
+   ann_batch(void) { }
+   void resize(const std::size_t batch_size,
+               const std::size_t num_inputs,
+               const std::size_t num_hidden,
+               const std::size_t num_outputs);
+};
+
+/********************************************************************************
+* ann_workspace: Strukt innehllande buffertar fr utdata frn respektive lager
+*                vid prediktion via ann::predict med egen arbetsyta. Varje
+*                trd som genomfr prediktion br ha en egen arbetsyta, som
+*                med frdel allokeras en gng via ann::workspace och sedan
+*                teranvnds, s att prediktion sker utan minnesallokering.
+********************************************************************************/
+template <typename T = double>
+struct ann_workspace
+{
+   /* Medlemmar: */
+   std::vector<T> hidden; /* Utdata frn det dolda lagret. */
+   std::vector<T> output; /* Utdata frn utgngslagret. */
+
+   /* Medlemsfunktioner: */
+   ann_workspace(void) { }
+   void resize(const std::size_t num_hidden,
+               const std::size_t num_outputs);
+};
+
+/********************************************************************************
+* ann_incremental: Tillstnd fr inkrementell prediktion via ann::update, dr
+*                  aktuell indata samt det dolda lagrets summor fre
+*                  aktivering sparas mellan anropen. Nr endast ett ftal
+*                  indata frndras mellan tv prediktioner uppdateras
+*                  summorna med bidragen frn de frndrade indata, i stllet
+*                  fr att samtliga summor rknas om. Fr att begrnsa
+*                  ackumulerade avrundningsfel rknas summorna om helt frn
+*                  sparad indata nr antalet frndrade indata sedan senaste
+*                  omrkning nr refresh_interval. Summorna rknas ven om
+*                  helt nr ntverkets generation skiljer sig frn den som
+*                  sparades vid senaste omrkning, exempelvis efter trning
+*                  eller byte till en annan modell med samma dimensioner.
+*                  Varje trd br ha ett eget tillstnd per datastrm, som
+*                  allokeras via ann::incremental.
+********************************************************************************/
+template <typename T = double>
+struct ann_incremental
+{
+   /* Medlemmar: */
+   std::vector<T> input;               /* Aktuell indata. */
+   std::vector<T> sum;                 /* Det dolda lagrets summor fre aktivering. */
+   std::vector<T> hidden;              /* Utdata frn det dolda lagret. */
+   std::vector<T> output;              /* Utdata frn utgngslagret. */
+   std::vector<std::uint32_t> changed; /* Index fr frndrade indata i senaste anropet. */
+   std::vector<T> delta;               /* Frndring fr respektive index i changed. */
+   std::size_t refresh_interval = 0;   /* Frndringar mellan omrkningar, 0 = antalet indata. */
+   std::size_t num_changes = 0;        /* Frndringar sedan senaste omrkning. */
+   std::uint64_t generation = 0;       /* Ntverkets generation vid senaste omrkning. */
+
+   /* Medlemsfunktioner: */
+   ann_incremental(void) { }
+   void resize(const std::size_t num_inputs,
+               const std::size_t num_hidden,
+               const std::size_t num_outputs);
+};
 
 /********************************************************************************
 * ann: Strukt fr enklare neurala ntverk innehllande ett ingngslager, ett
 *      dolt lager samt ett utgngslager med valfritt antal noder i respektive
 *      lager. Trningsdata kan passeras via referenser till tvdimensionella
-*      vektorer, vars innehll lagras fr trning.
+*      vektorer, vars innehll lagras i ett sammanhngande minnesblock, eller
+*      via en dataset, som exempelvis kan minnesmappas frn fil. Samtliga
+*      parametrar samt in- och utdata utgrs av flyttal av typen T (float eller
+*      double). Typen double anvnds som default, vilket innebr att exempelvis
+*      ann ann1(2, 3, 1) skapar ett ntverk med parametrar av typen double.
+*      Startvrden samt ordningsfljd vid trning genereras av ntverkets egen
+*      slumptalsgenerator, vars startvrde kan anges vid initiering eller via
+*      seed, s att en trning med samma startvrde kan terskapas exakt.
+*      Om biblioteket kompileras med ANN_PROFILING definierat mts tid per fas,
+*      antalet trnade och predikterade uppsttningar samt frlust per epok,
+*      vilket kan lsas av via medlemmen profile, exempelvis som JSON via
+*      ann1.profile.write_json(). Annars frblir samtliga mtvrden noll.
+*      Varje trning returnerar frlusten fr den sista epoken, som summeras
+*      vid backpropagation utan extra berkningar. Via train_options kan
+*      trningen ven valideras mot en andel av trningsdatan, avbrytas nr
+*      frlusten slutar minska och anvnda en varierande lrhastighet.
+*      Gles indata, exempelvis one-hot-kodade kategorier, kan passeras via
+*      sparse_matrix vid trning och via sparse_row vid prediktion, varvid
+*      det dolda lagret endast lser och justerar vikterna fr de indata som
+*      r skilda frn noll. Parametrarna justeras via gradient descent om
+*      inte momentum, RMSProp eller Adam vljs via set_optimizer eller
+*      train_options::optimizer. Vid strmmande prediktion dr endast ett
+*      ftal indata frndras mellan anropen kan ann::update anvndas, som
+*      endast rknar om bidragen frn de frndrade indata i det dolda lagret.
+*      Varje ntverk har en generation som r unik inom processen och frnyas
+*      nr parametrarna frndras via train eller load, s att tillstnd fr
+*      inkrementell prediktion kan avgra vilka parametrar summorna avser.
 ********************************************************************************/
+template <typename T = double>
 struct ann
 {
    /* Medlemmar: */
-   dense_layer hidden_layer;                         /* Dolt lager. */
-   dense_layer output_layer;                         /* Utgngslager. */
-   std::vector<std::vector<double>> train_in;        /* Indata fr trningsuppsttningar. */
-   std::vector<std::vector<double>> train_out;       /* Utdata fr trningsuppsttningar. */
-   std::vector<std::size_t> train_order;             /* Ordningsfljd fr trningsuppsttningar. */
-   const std::vector<double>* input_layer = nullptr; /* Pekare till aktuell indata. */ 
+   dense_layer<T> hidden_layer;          /* Dolt lager. */
+   dense_layer<T> output_layer;          /* Utgngslager. */
+   dataset<T> train_data;                /* In- och utdata fr trningsuppsttningar. */
+   std::vector<std::size_t> train_order; /* Ordningsfljd fr trningsuppsttningar. */
+   ann_batch<T> batch;                   /* Buffertar fr trning i minibatcher. */
+   std::shared_ptr<mapped_file> model;   /* Minnesmappad modellfil, annars nullptr. */
+   mutable ann_profile profile;          /* Mtvrden vid trning och prediktion. */
+   rng generator;                        /* Slumptalsgenerator fr startvrden och ordningsfljd. */
+   std::uint64_t generation;             /* Parametrarnas generation, frnyas vid frndring. */
 
    /* Medlemsfunktioner: */
-   ann(void) { }
+   ann(void) : generation(next_generation()) { }
    ann(const std::size_t num_inputs,
        const std::size_t num_hidden,
-       const std::size_t num_outputs);
+       const std::size_t num_outputs,
+       const std::uint64_t seed = rng::default_seed);
 
-   std::size_t num_inputs(void) const { return this->input_layer->size(); }
+   std::size_t num_inputs(void) const { return this->hidden_layer.num_weights(); }
    std::size_t num_hidden(void) const { return this->hidden_layer.num_nodes(); }
    std::size_t num_outputs(void) const { return this->output_layer.num_nodes(); }
    std::size_t num_sets(void) const { return this->train_order.size(); }
-   std::vector<double>& output(void) { return this->output_layer.output; }
+   std::vector<T>& output(void) { return this->output_layer.output; }
+   void seed(const std::uint64_t seed) { this->generator = rng(seed); }
+   void set_optimizer(const optimizer_options<T>& optimizer);
 
-   void set_training_data(const std::vector<std::vector<double>>& train_in,
-                          const std::vector<std::vector<double>>& train_out);
-   void train(const std::size_t num_epochs,
-              const double learning_rate);
-   std::vector<double>& predict(const std::vector<double>& input);
+   void set_training_data(const std::vector<std::vector<T>>& train_in,
+                          const std::vector<std::vector<T>>& train_out);
+   void set_training_data(dataset<T> train_data);
+   bool load_training_data(const std::string& filename);
+   double train(const std::size_t num_epochs,
+                const T learning_rate,
+                const std::size_t batch_size = 1,
+                const std::size_t num_threads = 1,
+                const parallel_mode mode = parallel_mode::synchronous);
+   double train(data_stream<T>& stream,
+                const std::size_t num_epochs,
+                const T learning_rate,
+                const std::size_t batch_size = 1,
+                const std::size_t num_threads = 1,
+                const parallel_mode mode = parallel_mode::synchronous);
+   double train(const sparse_matrix<T>& train_in,
+                const std::vector<std::vector<T>>& train_out,
+                const std::size_t num_epochs,
+                const T learning_rate,
+                const std::size_t batch_size = 1);
+   train_report train(const train_options<T>& options);
+   std::vector<T>& predict(const std::vector<T>& input);
+   ann_workspace<T> workspace(void) const;
+   const std::vector<T>& predict(const std::vector<T>& input,
+                                 ann_workspace<T>& workspace) const;
+   void predict(const T* input,
+                const std::size_t num_inputs,
+                T* output,
+                ann_workspace<T>& workspace) const;
+   void predict(const T* input,
+                const std::size_t num_rows,
+                const std::size_t num_inputs,
+                T* output,
+                const std::size_t num_threads = 1) const;
+   const std::vector<T>& predict(const sparse_row<T>& input,
+                                 ann_workspace<T>& workspace) const;
+   void predict(const sparse_row<T>& input,
+                T* output,
+                ann_workspace<T>& workspace) const;
+   void predict(const sparse_matrix<T>& input,
+                T* output) const;
+   ann_incremental<T> incremental(const std::size_t refresh_interval = 0) const;
+   const std::vector<T>& predict(const std::vector<T>& input,
+                                 ann_incremental<T>& state) const;
+   const std::vector<T>& update(const sparse_row<T>& changes,
+                                ann_incremental<T>& state) const;
    void predict(std::ostream& ostream = std::cout,
                 const double threshold = 0.001);
-   void predict(const std::vector<std::vector<double>>& input, 
+   void predict(const std::vector<std::vector<T>>& input, 
                 std::ostream& ostream = std::cout,
                 const double threshold = 0.001);
+   bool save(const std::string& filename) const;
+   bool load(const std::string& filename);
 
 private:
+   static std::uint64_t next_generation(void);
    void shuffle(void);
-   void optimize(const std::vector<double>& input, 
-                 const std::vector<double>& reference,
-                 const double learning_rate);
+   double optimize(const T* input,
+                   const T* reference,
+                   const T learning_rate);
+   double optimize(const std::size_t first,
+                   const std::size_t num_samples,
+                   const T learning_rate);
+   double optimize(const sparse_row<T>& input,
+                   const T* reference,
+                   const std::size_t num_references,
+                   const T learning_rate);
+   double optimize(const sparse_row<T>* input,
+                   const std::size_t num_samples,
+                   const T learning_rate);
+   void load_batch(ann_batch<T>& batch,
+                   const std::size_t first,
+                   const std::size_t num_samples) const;
+   double compute_gradients(ann_batch<T>& batch,
+                            const std::size_t num_samples) const;
+   double train_parallel(const std::size_t num_epochs,
+                         const T learning_rate,
+                         const std::size_t batch_size,
+                         const std::size_t num_threads,
+                         const parallel_mode mode);
+   void refresh(ann_incremental<T>& state) const;
+   double evaluate(const std::vector<std::size_t>& sets) const;
+   double mean_loss(const double loss,
+                    const std::size_t num_sets) const;
 };
 
 #endif /* ANN_HPP_ */
\ No newline at end of file
@@ -0,0 +1,656 @@
+/********************************************************************************
+* benchmark.cpp: Mikrobenchmarks fr de mest tidskritiska delarna av
+*                biblioteket, dvs. feedforward, backpropagation och
+*                optimering i dense-lager samt trning och prediktion i
+*                neurala ntverk. Varje mtning genomfrs fr ett rutnt av
+*                lagerbredder, batchstorlekar samt antal trdar och redovisar
+*                antalet trningsuppsttningar per sekund, GFLOP/s samt
+*                uppskattad mngd flyttad data. Fr sm ntverk med fast
+*                topologi jmfrs ven latensen per prediktion mellan
+*                static_ann och ann.
+*
+*                Bygg och kr via CMake enligt fljande:
+*                $ cmake -S . -B build
+*                $ cmake --build build --target benchmark
+*                $ ./build/benchmark --output results.json
+*
+*                Tillgngliga argument:
+*                --output <fil>       : Skriver resultatet i JSON-format till
+*                                       angiven fil fr jmfrelse mellan
+*                                       versioner.
+*                --type float|double  : Flyttalstyp (default = double).
+*                --min-time <sekunder>: Minsta mttid per fall (default = 0.2).
+*                --quick              : Mindre rutnt fr snabba kontroller.
+********************************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "ann.hpp"
+#include "population.hpp"
+#include "quantized_ann.hpp"
+#include "simd.hpp"
+#include "static_ann.hpp"
+
+namespace
+{
+/********************************************************************************
+* result: Resultat frn en enskild mtning.
+********************************************************************************/
+struct result
+{
+   std::string name;        /* Den funktion som mttes. */
+   std::size_t width = 0;   /* Antalet noder samt vikter per nod i lagret. */
+   std::size_t batch = 0;   /* Antalet trningsuppsttningar per anrop. */
+   std::size_t threads = 0; /* Antalet trdar. */
+   std::size_t calls = 0;   /* Antalet genomfrda anrop. */
+   double seconds = 0;      /* Total mttid i sekunder. */
+   double samples = 0;      /* Antalet behandlade trningsuppsttningar. */
+   double flops = 0;        /* Antalet flyttalsoperationer. */
+   double bytes = 0;        /* Uppskattad mngd lst och skriven data i byte. */
+
+   double samples_per_second(void) const { return this->samples / this->seconds; }
+   double gflops(void) const { return this->flops / this->seconds * 1e-9; }
+   double gbytes_per_second(void) const { return this->bytes / this->seconds * 1e-9; }
+};
+
+/********************************************************************************
+* options: Instllningar angivna via kommandoraden.
+********************************************************************************/
+struct options
+{
+   std::string output;          /* Fil fr resultat i JSON-format, tom om ingen. */
+   std::string type = "double"; /* Flyttalstyp. */
+   double min_time = 0.2;       /* Minsta mttid per fall i sekunder. */
+   bool quick = false;          /* Indikerar mindre rutnt. */
+};
+
+/********************************************************************************
+* measure: Anropar angiven funktion upprepade gnger tills minst min_time
+*          sekunder har passerat och returnerar uppmtt resultat, dr antalet
+*          behandlade uppsttningar, flyttalsoperationer samt byte per anrop
+*          multipliceras med antalet anrop. Ett frsta anrop genomfrs innan
+*          mtningen startar fr att vrma upp cacheminnen.
+*
+*          - base    : Resultat innehllande namn, bredd, batchstorlek samt
+*                      antal trdar, per anrop: samples, flops samt bytes.
+*          - min_time: Minsta mttid i sekunder.
+*          - function: Den funktion som skall mtas.
+********************************************************************************/
+template <typename F>
+result measure(result base,
+               const double min_time,
+               F&& function)
+{
+   using clock = std::chrono::steady_clock;
+   function();
+
+   const auto start = clock::now();
+   std::size_t calls = 0;
+   double elapsed = 0;
+
+   do
+   {
+      function();
+      ++calls;
+      elapsed = std::chrono::duration<double>(clock::now() - start).count();
+   } while (elapsed < min_time);
+
+   base.calls = calls;
+   base.seconds = elapsed;
+   base.samples *= calls;
+   base.flops *= calls;
+   base.bytes *= calls;
+   return base;
+}
+
+/********************************************************************************
+* randomize: Fyller angiven buffert med slumpmssiga vrden mellan 0 - 0.1,
+*            s att aktiveringarna varken vxer okontrollerat eller blir noll.
+*            Vrdena genereras via angiven generator, s att indatan blir
+*            densamma mellan krningar och plattformar.
+*
+*            - data     : Pekare till buffertens frsta element.
+*            - size     : Antalet element i bufferten.
+*            - generator: Slumptalsgenerator som vrdena hmtas frn.
+********************************************************************************/
+template <typename T>
+void randomize(T* data,
+               const std::size_t size,
+               rng& generator)
+{
+   generator.fill(data, size);
+
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      data[i] *= static_cast<T>(0.1);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* randomize: Tilldelar samtliga bias och vikter i angivet dense-lager
+*            slumpmssiga vrden mellan 0 - 0.1.
+*
+*            - layer    : Det dense-lager som skall tilldelas nya parametrar.
+*            - generator: Slumptalsgenerator som vrdena hmtas frn.
+********************************************************************************/
+template <typename T>
+void randomize(dense_layer<T>& layer,
+               rng& generator)
+{
+   randomize(layer.bias.data(), layer.bias.size(), generator);
+
+   for (std::size_t i = 0; i < layer.num_nodes(); ++i)
+   {
+      randomize(layer.weights[i], layer.num_weights(), generator);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* benchmark_layer: Mter feedforward, backpropagation samt optimering fr ett
+*                  dense-lager med width noder och width vikter per nod, dr
+*                  en batchstorlek p 1 mts via funktionerna fr enskilda
+*                  trningsuppsttningar, ven med gles indata dr 1 % av
+*                  elementen r satta, och vriga via batchfunktionerna,
+*                  dr optimering ven mts med momentum, RMSProp och Adam.
+*
+*                  - width     : Antalet noder samt vikter per nod.
+*                  - batch_size: Antalet trningsuppsttningar per anrop.
+*                  - min_time  : Minsta mttid per fall i sekunder.
+*                  - results   : Vektor som resultaten lggs till i.
+********************************************************************************/
+template <typename T>
+void benchmark_layer(const std::size_t width,
+                     const std::size_t batch_size,
+                     const double min_time,
+                     std::vector<result>& results)
+{
+   const double w = static_cast<double>(width);
+   const double b = static_cast<double>(batch_size);
+   const double weights = w * w * sizeof(T);
+   const double activations = b * w * sizeof(T);
+
+   rng generator;
+   dense_layer<T> layer(width, width), next(width, width);
+   randomize(layer, generator);
+   randomize(next, generator);
+
+   auto make = [&](const char* name, const double flops, const double bytes)
+   {
+      result base;
+      base.name = name;
+      base.width = width;
+      base.batch = batch_size;
+      base.threads = 1;
+      base.samples = b;
+      base.flops = flops;
+      base.bytes = bytes;
+      return base;
+   };
+
+   if (batch_size == 1)
+   {
+      std::vector<T> input(width), reference(width);
+      randomize(input.data(), width, generator);
+      randomize(reference.data(), width, generator);
+      layer.feedforward(input);
+      next.feedforward(layer.output);
+      next.backpropagate(reference);
+
+      results.push_back(measure(make("dense_layer::feedforward", 2 * w * w, weights + 2 * activations), min_time,
+                                [&] { layer.feedforward(input); }));
+      results.push_back(measure(make("dense_layer::backpropagate(reference)", 2 * w, 3 * activations), min_time,
+                                [&] { next.backpropagate(reference); }));
+      results.push_back(measure(make("dense_layer::backpropagate(next_layer)", 2 * w * w, weights + 3 * activations), min_time,
+                                [&] { layer.backpropagate(next); }));
+      results.push_back(measure(make("dense_layer::backpropagate(next_layer, lr)", 4 * w * w, 2 * weights + 4 * activations),
+                                min_time, [&] { layer.backpropagate(next, static_cast<T>(1e-9)); }));
+      results.push_back(measure(make("dense_layer::optimize", 2 * w * w, 2 * weights + 2 * activations), min_time,
+                                [&] { layer.optimize(input, static_cast<T>(1e-9)); }));
+
+      const auto nonzeros = std::max<std::size_t>(width / 100, 1);
+      const double z = static_cast<double>(nonzeros);
+      sparse_matrix<T> sparse;
+      std::vector<T> row(width, 0);
+      for (std::size_t k = 0; k < nonzeros; ++k) row[k * width / nonzeros] = input[k];
+      sparse.append(row.data(), width);
+
+      results.push_back(measure(make("dense_layer::feedforward(sparse)", 2 * w * z, w * z * sizeof(T) + activations), min_time,
+                                [&] { layer.feedforward(sparse[0], layer.output.data()); }));
+      results.push_back(measure(make("dense_layer::optimize(sparse)", 2 * w * z, 2 * w * z * sizeof(T) + activations), min_time,
+                                [&] { layer.optimize(sparse[0], static_cast<T>(1e-9)); }));
+   }
+   else
+   {
+      matrix<T> input(batch_size, width), reference(batch_size, width);
+      dense_batch<T> batch, next_batch;
+      batch.resize(batch_size, width, width);
+      next_batch.resize(batch_size, width, width);
+      randomize(input.elements(), input.size(), generator);
+      randomize(reference.elements(), reference.size(), generator);
+      layer.feedforward(input, batch_size, batch);
+      next.feedforward(batch.output, batch_size, next_batch);
+      next.backpropagate(reference, batch_size, next_batch);
+      layer.backpropagate(next, next_batch, batch_size, batch);
+      layer.accumulate(input, batch_size, batch);
+
+      results.push_back(measure(make("dense_layer::feedforward", 2 * b * w * w, weights + 2 * activations), min_time,
+                                [&] { layer.feedforward(input, batch_size, batch); }));
+      results.push_back(measure(make("dense_layer::backpropagate(reference)", 2 * b * w, 3 * activations), min_time,
+                                [&] { next.backpropagate(reference, batch_size, next_batch); }));
+      results.push_back(measure(make("dense_layer::backpropagate(next_layer)", 2 * b * w * w, weights + 3 * activations), min_time,
+                                [&] { layer.backpropagate(next, next_batch, batch_size, batch); }));
+      results.push_back(measure(make("dense_layer::accumulate", 2 * b * w * w, weights + 2 * activations), min_time,
+                                [&] { layer.accumulate(input, batch_size, batch); }));
+      results.push_back(measure(make("dense_layer::optimize", 2 * w * w, 3 * weights), min_time,
+                                [&] { layer.optimize(batch, batch_size, static_cast<T>(1e-9)); }));
+
+      layer.set_optimizer(optimizer_type::momentum);
+      results.push_back(measure(make("dense_layer::optimize(momentum)", 4 * w * w, 5 * weights), min_time,
+                                [&] { layer.optimize(batch, batch_size, static_cast<T>(1e-9)); }));
+      layer.set_optimizer(optimizer_type::rmsprop);
+      results.push_back(measure(make("dense_layer::optimize(rmsprop)", 8 * w * w, 5 * weights), min_time,
+                                [&] { layer.optimize(batch, batch_size, static_cast<T>(1e-9)); }));
+      layer.set_optimizer(optimizer_type::adam);
+      results.push_back(measure(make("dense_layer::optimize(adam)", 11 * w * w, 7 * weights), min_time,
+                                [&] { layer.optimize(batch, batch_size, static_cast<T>(1e-9)); }));
+   }
+
+   return;
+}
+
+/********************************************************************************
+* benchmark_network: Mter en epok av ann::train samt prediktion av
+*                    batch_size rader per anrop via ann::predict fr ett
+*                    ntverk med width noder i samtliga lager, trnat p
+*                    num_sets slumpmssiga uppsttningar. Vid en trd mts
+*                    ven prediktion via motsvarande quantized_ann samt, vid
+*                    batchstorlek 1, inkrementell prediktion via ann::update
+*                    dr 1 % av indatan frndras per anrop.
+*
+*                    - width      : Antalet noder i respektive lager.
+*                    - batch_size : Antalet trningsuppsttningar per minibatch.
+*                    - num_threads: Antalet trdar.
+*                    - min_time   : Minsta mttid per fall i sekunder.
+*                    - results    : Vektor som resultaten lggs till i.
+********************************************************************************/
+template <typename T>
+void benchmark_network(const std::size_t width,
+                       const std::size_t batch_size,
+                       const std::size_t num_threads,
+                       const double min_time,
+                       std::vector<result>& results)
+{
+   const std::size_t num_sets = std::max<std::size_t>(4 * batch_size * num_threads, 256);
+   const double w = static_cast<double>(width);
+   const double n = static_cast<double>(num_sets);
+   const double weights = 2 * w * w * sizeof(T);
+   const double batches = std::ceil(n / batch_size);
+
+   std::vector<std::vector<T>> train_in(num_sets, std::vector<T>(width));
+   std::vector<std::vector<T>> train_out(num_sets, std::vector<T>(width));
+   std::vector<T> flat(num_sets * width), output(num_sets * width);
+   rng generator;
+
+   for (std::size_t i = 0; i < num_sets; ++i)
+   {
+      randomize(train_in[i].data(), width, generator);
+      randomize(train_out[i].data(), width, generator);
+      std::copy(train_in[i].begin(), train_in[i].end(), flat.begin() + i * width);
+   }
+
+   ann<T> network(width, width, width);
+   randomize(network.hidden_layer, generator);
+   randomize(network.output_layer, generator);
+   network.set_training_data(train_in, train_out);
+
+   result train;
+   train.name = "ann::train";
+   train.width = width;
+   train.batch = batch_size;
+   train.threads = num_threads;
+   train.samples = n;
+   train.flops = 6 * n * 2 * w * w;
+   train.bytes = 3 * weights * batches + 4 * n * w * sizeof(T);
+   results.push_back(measure(train, min_time, [&] { network.train(1, static_cast<T>(1e-9), batch_size, num_threads); }));
+
+   result predict = train;
+   predict.name = "ann::predict";
+   predict.samples = static_cast<double>(batch_size);
+   predict.flops = 2 * predict.samples * 2 * w * w;
+   predict.bytes = weights + 2 * predict.samples * w * sizeof(T);
+   results.push_back(measure(predict, min_time, [&] { network.predict(flat.data(), batch_size, width, output.data(), num_threads); }));
+   if (num_threads != 1) return;
+
+   const quantized_ann<T> quantized(network);
+   result quantized_predict = predict;
+   quantized_predict.name = "quantized_ann::predict";
+   quantized_predict.bytes = 2 * w * w + 2 * predict.samples * w * sizeof(T);
+   results.push_back(measure(quantized_predict, min_time, [&] { quantized.predict(flat.data(), batch_size, width, output.data()); }));
+   if (batch_size != 1) return;
+
+   const auto num_changes = std::max<std::size_t>(width / 100, 1);
+   const double c = static_cast<double>(num_changes);
+   auto state = network.incremental();
+   std::vector<std::uint32_t> index(num_changes);
+   std::vector<T> value(num_changes);
+   std::size_t step = 0;
+   network.predict(train_in[0], state);
+
+   for (std::size_t k = 0; k < num_changes; ++k)
+   {
+      index[k] = static_cast<std::uint32_t>(k * width / num_changes);
+   }
+
+   result update = predict;
+   update.name = "ann::update(1% changed)";
+   update.flops = 2 * w * c + 2 * w * w;
+   update.bytes = w * c * sizeof(T) + w * w * sizeof(T) + 3 * w * sizeof(T);
+   results.push_back(measure(update, min_time, [&]
+   {
+      const auto& source = train_in[++step % num_sets];
+      for (std::size_t k = 0; k < num_changes; ++k) value[k] = source[index[k]];
+      network.update(sparse_row<T>(index.data(), value.data(), num_changes), state);
+   }));
+   return;
+}
+
+/********************************************************************************
+* benchmark_population: Mter en epok av trning fr num_models sm ntverk
+*                       med width noder i in- och det dolda lagret samt en
+*                       utgngsnod, dels ett ntverk i taget via ann::train,
+*                       dels samtliga samtidigt via population::train. Antalet
+*                       behandlade uppsttningar rknas per ntverk, s att
+*                       fallen kan jmfras direkt. Kolumnen batch anger
+*                       antalet ntverk.
+*
+*                       - width      : Antalet noder i in- och det dolda lagret.
+*                       - num_models : Antalet ntverk.
+*                       - num_threads: Antalet trdar vid population::train.
+*                       - min_time   : Minsta mttid per fall i sekunder.
+*                       - results    : Vektor som resultaten lggs till i.
+********************************************************************************/
+template <typename T>
+void benchmark_population(const std::size_t width,
+                          const std::size_t num_models,
+                          const std::size_t num_threads,
+                          const double min_time,
+                          std::vector<result>& results)
+{
+   constexpr std::size_t num_sets = 256;
+   const double w = static_cast<double>(width);
+   const double samples = static_cast<double>(num_sets * num_models);
+   const double parameters = w * w + 2 * w + 1;
+
+   std::vector<std::vector<T>> train_in(num_sets, std::vector<T>(width));
+   std::vector<std::vector<T>> train_out(num_sets, std::vector<T>(1));
+   std::vector<population_member<T>> members(num_models);
+   std::vector<ann<T>> networks;
+   rng generator;
+
+   for (std::size_t i = 0; i < num_sets; ++i)
+   {
+      randomize(train_in[i].data(), width, generator);
+      randomize(train_out[i].data(), 1, generator);
+   }
+
+   for (std::size_t i = 0; i < num_models; ++i)
+   {
+      members[i].learning_rate = static_cast<T>(1e-9 * (i + 1));
+      members[i].seed = i + 1;
+      networks.emplace_back(width, width, 1, members[i].seed);
+      networks.back().set_training_data(train_in, train_out);
+   }
+
+   const dataset<T> data(train_in, train_out);
+   population<T> models(width, width, 1, members);
+
+   result base;
+   base.width = width;
+   base.batch = num_models;
+   base.samples = samples;
+   base.flops = 6 * samples * parameters;
+   base.bytes = 3 * samples * parameters * sizeof(T);
+
+   if (num_threads == 1)
+   {
+      base.name = "ann::train(per model)";
+      base.threads = 1;
+      results.push_back(measure(base, min_time, [&]
+      {
+         for (auto& i : networks)
+         {
+            i.train(1, static_cast<T>(1e-9));
+         }
+      }));
+   }
+
+   base.name = "population::train";
+   base.threads = num_threads;
+   results.push_back(measure(base, min_time, [&] { models.train(data, 1, num_threads); }));
+   return;
+}
+
+/********************************************************************************
+* benchmark_static: Mter prediktion av en uppsttning i taget fr ett ntverk
+*                   med fast topologi, dels via static_ann::predict, dels via
+*                   ann::predict med en frallokerad arbetsyta fr ett ann med
+*                   samma parametrar, s att latensen per prediktion kan
+*                   jmfras direkt. Indatan roteras mellan num_sets
+*                   slumpmssiga uppsttningar och utdatan summeras i en
+*                   volatile variabel, s att anropen inte kan optimeras bort.
+*
+*                   - min_time: Minsta mttid per fall i sekunder.
+*                   - results : Vektor som resultaten lggs till i.
+********************************************************************************/
+template <std::size_t Width, typename T>
+void benchmark_static(const double min_time,
+                      std::vector<result>& results)
+{
+   constexpr std::size_t num_sets = 256;
+   const double w = static_cast<double>(Width);
+   static_ann<Width, Width, Width, T> network;
+   const auto reference = network.to_ann();
+   auto workspace = reference.workspace();
+   std::vector<std::array<T, Width>> input(num_sets);
+   std::vector<std::vector<T>> vector_input(num_sets, std::vector<T>(Width));
+   std::array<T, Width> output{};
+   std::size_t step = 0;
+   volatile T sink = 0;
+   rng generator;
+
+   for (std::size_t i = 0; i < num_sets; ++i)
+   {
+      randomize(input[i].data(), Width, generator);
+      std::copy(input[i].begin(), input[i].end(), vector_input[i].begin());
+   }
+
+   result base;
+   base.width = Width;
+   base.batch = 1;
+   base.threads = 1;
+   base.samples = 1;
+   base.flops = 2 * 2 * w * w;
+   base.bytes = 2 * (w * w + w) * sizeof(T) + 2 * w * sizeof(T);
+
+   base.name = "static_ann::predict";
+   results.push_back(measure(base, min_time, [&]
+   {
+      network.predict(input[++step % num_sets], output);
+      sink = sink + output[0];
+   }));
+
+   base.name = "ann::predict(workspace)";
+   results.push_back(measure(base, min_time, [&]
+   {
+      sink = sink + reference.predict(vector_input[++step % num_sets], workspace)[0];
+   }));
+   return;
+}
+
+/********************************************************************************
+* run: Genomfr samtliga mtningar fr flyttalstypen T och returnerar
+*      resultaten.
+*
+*      - settings: Instllningar angivna via kommandoraden.
+********************************************************************************/
+template <typename T>
+std::vector<result> run(const options& settings)
+{
+   const auto hardware_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+   const std::vector<std::size_t> widths = settings.quick ? std::vector<std::size_t>{ 16, 256 } : std::vector<std::size_t>{ 16, 64, 256, 1024 };
+   const std::vector<std::size_t> batch_sizes = settings.quick ? std::vector<std::size_t>{ 1, 64 } : std::vector<std::size_t>{ 1, 16, 128 };
+   std::vector<std::size_t> thread_counts{ 1 };
+   std::vector<result> results;
+
+   if (hardware_threads > 1) thread_counts.push_back(hardware_threads);
+
+   for (const auto width : widths)
+   {
+      for (const auto batch_size : batch_sizes)
+      {
+         benchmark_layer<T>(width, batch_size, settings.min_time, results);
+
+         for (const auto num_threads : thread_counts)
+         {
+            benchmark_network<T>(width, batch_size, num_threads, settings.min_time, results);
+         }
+      }
+   }
+
+   for (const auto num_threads : thread_counts)
+   {
+      benchmark_population<T>(16, 64, num_threads, settings.min_time, results);
+   }
+
+   benchmark_static<4, T>(settings.min_time, results);
+   benchmark_static<16, T>(settings.min_time, results);
+   benchmark_static<64, T>(settings.min_time, results);
+   return results;
+}
+
+/********************************************************************************
+* print: Skriver ut angivna resultat som en tabell via angiven utstrm.
+*
+*        - results: Resultaten som skall skrivas ut.
+*        - ostream: Angiven utstrm.
+********************************************************************************/
+void print(const std::vector<result>& results,
+           std::ostream& ostream)
+{
+   ostream << std::left << std::setw(44) << "benchmark" << std::right
+           << std::setw(7) << "width" << std::setw(7) << "batch" << std::setw(8) << "threads"
+           << std::setw(16) << "samples/s" << std::setw(10) << "GFLOP/s" << std::setw(8) << "GB/s" << "\n";
+
+   for (const auto& i : results)
+   {
+      ostream << std::left << std::setw(44) << i.name << std::right
+              << std::setw(7) << i.width << std::setw(7) << i.batch << std::setw(8) << i.threads
+              << std::fixed << std::setprecision(0) << std::setw(16) << i.samples_per_second()
+              << std::setprecision(2) << std::setw(10) << i.gflops() << std::setw(8) << i.gbytes_per_second()
+              << std::defaultfloat << "\n";
+   }
+
+   return;
+}
+
+/********************************************************************************
+* write_json: Skriver angivna resultat i JSON-format via angiven utstrm,
+*             tillsammans med vald flyttalstyp och instruktionsuppsttning.
+*
+*             - results : Resultaten som skall skrivas ut.
+*             - settings: Instllningar angivna via kommandoraden.
+*             - ostream : Angiven utstrm.
+********************************************************************************/
+void write_json(const std::vector<result>& results,
+                const options& settings,
+                std::ostream& ostream)
+{
+   ostream << "{\n  \"version\": 1,\n  \"type\": \"" << settings.type << "\",\n  \"isa\": \"" << simd::isa()
+           << "\",\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n  \"results\": [\n";
+   ostream << std::setprecision(9);
+
+   for (std::size_t i = 0; i < results.size(); ++i)
+   {
+      const auto& r = results[i];
+      ostream << "    { \"name\": \"" << r.name << "\", \"width\": " << r.width << ", \"batch\": " << r.batch
+              << ", \"threads\": " << r.threads << ", \"calls\": " << r.calls << ", \"seconds\": " << r.seconds
+              << ", \"samples_per_second\": " << r.samples_per_second() << ", \"gflops\": " << r.gflops()
+              << ", \"bytes\": " << r.bytes << ", \"gbytes_per_second\": " << r.gbytes_per_second() << " }"
+              << (i + 1 < results.size() ? ",\n" : "\n");
+   }
+
+   ostream << "  ]\n}\n";
+   return;
+}
+
+/********************************************************************************
+* parse: Lser in instllningar frn kommandoraden. Returnerar false vid
+*        oknt eller ofullstndigt argument.
+*
+*        - argc    : Antalet argument.
+*        - argv    : Argumenten.
+*        - settings: Struktur dr instllningarna lagras.
+********************************************************************************/
+bool parse(const int argc,
+           char** argv,
+           options& settings)
+{
+   for (int i = 1; i < argc; ++i)
+   {
+      const std::string arg = argv[i];
+      const bool has_value = i + 1 < argc;
+
+      if (arg == "--output" && has_value) settings.output = argv[++i];
+      else if (arg == "--type" && has_value) settings.type = argv[++i];
+      else if (arg == "--min-time" && has_value) settings.min_time = std::atof(argv[++i]);
+      else if (arg == "--quick") settings.quick = true;
+      else return false;
+   }
+
+   return settings.type == "float" || settings.type == "double";
+}
+}
+
+/********************************************************************************
+* main: Genomfr samtliga mtningar, skriver ut resultatet som en tabell och
+*       sparar det i JSON-format om en utfil har angivits.
+********************************************************************************/
+int main(int argc, char** argv)
+{
+   options settings;
+
+   if (!parse(argc, argv, settings))
+   {
+      std::cerr << "Usage: " << argv[0] << " [--output <file>] [--type float|double] [--min-time <seconds>] [--quick]\n";
+      return 1;
+   }
+
+   const auto results = settings.type == "float" ? run<float>(settings) : run<double>(settings);
+   std::cout << "ISA: " << simd::isa() << ", type: " << settings.type << "\n\n";
+   print(results, std::cout);
+
+   if (!settings.output.empty())
+   {
+      std::ofstream ofstream(settings.output);
+      write_json(results, settings, ofstream);
+
+      if (!ofstream)
+      {
+         std::cerr << "Could not write " << settings.output << "!\n";
+         return 1;
+      }
+   }
+
+   return 0;
+}
@@ -0,0 +1,271 @@
+/********************************************************************************
+* data_stream.cpp: Definition av funktionsmedlemmar tillhrande strukten
+*                  data_stream fr strmmande inlsning av trningsdata.
+********************************************************************************/
+#include "data_stream.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+/********************************************************************************
+* open_binary: ppnar angiven binrfil, skriven via dataset::save, fr
+*              strmmande inlsning i block om angivet antal
+*              trningsuppsttningar och startar inlsningen av det frsta
+*              blocket. Returnerar true om filen kunde ppnas och har ett
+*              giltigt filhuvud fr element av typen T.
+*
+*              - filename  : Skvg till filen som skall lsas.
+*              - chunk_size: Antalet trningsuppsttningar per block
+*                            (default = 65 536).
+********************************************************************************/
+template <typename T>
+bool data_stream<T>::open_binary(const std::string& filename,
+                                 const std::size_t chunk_size)
+{
+   this->close();
+   this->file.open(filename, std::ios::binary | std::ios::ate);
+   if (!this->file) return false;
+
+   const auto file_size = static_cast<std::uint64_t>(this->file.tellg());
+   dataset_header header{};
+   this->file.seekg(0);
+
+   if (!this->file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+       !dataset<T>::valid_header(header, file_size))
+   {
+      this->file.close();
+      return false;
+   }
+
+   this->format = stream_format::binary;
+   this->data_start = this->file.tellg();
+   this->chunk_size = std::max<std::size_t>(chunk_size, 1);
+   this->inputs = header.num_inputs;
+   this->outputs = header.num_outputs;
+   this->start();
+   return true;
+}
+
+/********************************************************************************
+* open_csv: ppnar angiven textfil fr strmmande inlsning i block om angivet
+*           antal trningsuppsttningar och startar inlsningen av det frsta
+*           blocket. Varje rad skall innehlla num_inputs vrden indata fljt
+*           av num_outputs vrden referensdata. Rader som inte inleds med ett
+*           tal, exempelvis rubrikrader, hoppas ver och saknade vrden stts
+*           till noll. Returnerar true om filen kunde ppnas.
+*
+*           - filename   : Skvg till filen som skall lsas.
+*           - num_inputs : Antalet vrden indata per rad.
+*           - num_outputs: Antalet vrden referensdata per rad.
+*           - chunk_size : Antalet trningsuppsttningar per block
+*                          (default = 65 536).
+********************************************************************************/
+template <typename T>
+bool data_stream<T>::open_csv(const std::string& filename,
+                              const std::size_t num_inputs,
+                              const std::size_t num_outputs,
+                              const std::size_t chunk_size)
+{
+   this->close();
+   this->file.open(filename);
+   if (!this->file) return false;
+
+   this->format = stream_format::csv;
+   this->data_start = this->file.tellg();
+   this->chunk_size = std::max<std::size_t>(chunk_size, 1);
+   this->inputs = num_inputs;
+   this->outputs = num_outputs;
+   this->start();
+   return true;
+}
+
+/********************************************************************************
+* next: Vntar tills bakgrundstrden har lst in nsta block och byter sedan
+*       plats p detta block och angiven dataset, vars tidigare minne drmed
+*       teranvnds vid inlsning av efterfljande block. Returnerar false
+*       nr samtliga block i filen har lsts, annars true.
+*
+*       - chunk: Dataset som tilldelas nsta block.
+********************************************************************************/
+template <typename T>
+bool data_stream<T>::next(dataset<T>& chunk)
+{
+   if (!this->reader.joinable() && !this->ready) return false;
+   std::unique_lock<std::mutex> lock(this->mutex);
+   this->condition.wait(lock, [&] { return this->ready; });
+   if (this->buffer.num_sets() == 0) return false;
+
+   std::swap(chunk, this->buffer);
+   this->ready = false;
+   this->condition.notify_all();
+   return true;
+}
+
+/********************************************************************************
+* rewind: Spolar tillbaka angiven strm till den frsta trningsuppsttningen
+*         och startar om inlsningen, exempelvis infr en ny epok. Returnerar
+*         false om ingen fil r ppen.
+********************************************************************************/
+template <typename T>
+bool data_stream<T>::rewind(void)
+{
+   if (!this->file.is_open()) return false;
+   this->halt();
+   this->file.clear();
+   this->file.seekg(this->data_start);
+   this->start();
+   return true;
+}
+
+/********************************************************************************
+* close: Avslutar bakgrundstrden och stnger eventuell ppen fil.
+********************************************************************************/
+template <typename T>
+void data_stream<T>::close(void)
+{
+   this->halt();
+   if (this->file.is_open()) this->file.close();
+   this->file.clear();
+   return;
+}
+
+/********************************************************************************
+* start: Startar bakgrundstrden, som lser in block till dess att filen r
+*        slut eller strmmen stoppas.
+********************************************************************************/
+template <typename T>
+void data_stream<T>::start(void)
+{
+   this->ready = false;
+   this->stop = false;
+   this->reader = std::thread(&data_stream::run, this);
+   return;
+}
+
+/********************************************************************************
+* halt: Signalerar bakgrundstrden att avslutas och vntar tills den har
+*       avslutats. Eventuellt inlst men ej hmtat block kasseras.
+********************************************************************************/
+template <typename T>
+void data_stream<T>::halt(void)
+{
+   if (this->reader.joinable())
+   {
+      {
+         std::lock_guard<std::mutex> lock(this->mutex);
+         this->stop = true;
+      }
+
+      this->condition.notify_all();
+      this->reader.join();
+   }
+
+   this->ready = false;
+   return;
+}
+
+/********************************************************************************
+* run: Bakgrundstrdens huvudloop. S fort fregende block har hmtats via
+*      next lses nsta block in, varefter anroparen signaleras. Ett tomt
+*      block markerar att filen r slut, varvid trden avslutas.
+********************************************************************************/
+template <typename T>
+void data_stream<T>::run(void)
+{
+   while (true)
+   {
+      {
+         std::unique_lock<std::mutex> lock(this->mutex);
+         this->condition.wait(lock, [&] { return !this->ready || this->stop; });
+         if (this->stop) return;
+      }
+
+      const auto num_sets = this->read_chunk(this->buffer);
+
+      {
+         std::lock_guard<std::mutex> lock(this->mutex);
+         this->ready = true;
+      }
+
+      this->condition.notify_all();
+      if (num_sets == 0) return;
+   }
+}
+
+/********************************************************************************
+* read_chunk: Lser in upp till chunk_size trningsuppsttningar till angiven
+*             dataset enligt strmmens format och returnerar antalet inlsta
+*             uppsttningar. Datasetens befintliga minne teranvnds, svida
+*             den inte r minnesmappad.
+*
+*             - chunk: Dataset som inlst data lagras i.
+********************************************************************************/
+template <typename T>
+std::size_t data_stream<T>::read_chunk(dataset<T>& chunk)
+{
+   if (chunk.is_mapped()) chunk.clear();
+   chunk.inputs = this->inputs;
+   chunk.outputs = this->outputs;
+   chunk.storage.resize(this->chunk_size * chunk.row_size());
+   chunk.rows = this->format == stream_format::binary ? this->read_binary(chunk) : this->read_csv(chunk);
+   return chunk.rows;
+}
+
+/********************************************************************************
+* read_binary: Lser in upp till chunk_size hela rader frn binrfilen direkt
+*              till angiven datasets minne och returnerar antalet inlsta
+*              rader.
+*
+*              - chunk: Dataset som inlst data lagras i.
+********************************************************************************/
+template <typename T>
+std::size_t data_stream<T>::read_binary(dataset<T>& chunk)
+{
+   const auto row_bytes = chunk.row_size() * sizeof(T);
+   if (row_bytes == 0) return 0;
+
+   this->file.read(reinterpret_cast<char*>(chunk.storage.data()), this->chunk_size * row_bytes);
+   return static_cast<std::size_t>(this->file.gcount()) / row_bytes;
+}
+
+/********************************************************************************
+* read_csv: Lser in upp till chunk_size rader frn textfilen till angiven
+*           datasets minne och returnerar antalet inlsta rader. Vrden
+*           separeras med kommatecken, semikolon eller blanksteg.
+*
+*           - chunk: Dataset som inlst data lagras i.
+********************************************************************************/
+template <typename T>
+std::size_t data_stream<T>::read_csv(dataset<T>& chunk)
+{
+   std::string line;
+   std::size_t num_sets = 0;
+
+   while (num_sets < this->chunk_size && std::getline(this->file, line))
+   {
+      auto* row = chunk.storage.data() + num_sets * chunk.row_size();
+      const char* s = line.c_str();
+      std::size_t num_values = 0;
+
+      while (num_values < chunk.row_size())
+      {
+         while (*s == ',' || *s == ';' || *s == ' ' || *s == '\t' || *s == '\r') ++s;
+         char* end = nullptr;
+         const auto value = std::strtod(s, &end);
+         if (end == s) break;
+         row[num_values++] = static_cast<T>(value);
+         s = end;
+      }
+
+      if (num_values == 0) continue;
+      std::fill(row + num_values, row + chunk.row_size(), 0);
+      num_sets++;
+   }
+
+   return num_sets;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template struct data_stream<float>;
+template struct data_stream<double>;
@@ -0,0 +1,84 @@
+/********************************************************************************
+* data_stream.hpp: Implementering av strmmande inlsning av trningsdata
+*                  frn fil i block om ett fast antal trningsuppsttningar,
+*                  s att ntverk kan trnas p datamngder som r strre n
+*                  arbetsminnet. Inlsningen sker i en bakgrundstrd, som
+*                  lser in nsta block medan det fregende anvnds fr
+*                  trning, s att filinlsning och berkningar verlappar.
+********************************************************************************/
+#ifndef DATA_STREAM_HPP_
+#define DATA_STREAM_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include "dataset.hpp"
+
+/********************************************************************************
+* stream_format: Anger filformatet fr strmmad trningsdata.
+*
+*                - binary: Binrfil skriven via dataset::save.
+*                - csv   : Textfil med en trningsuppsttning per rad, dr
+*                          indata fljs av referensdata, separerade med
+*                          kommatecken, semikolon eller blanksteg.
+********************************************************************************/
+enum class stream_format { binary, csv };
+
+/********************************************************************************
+* data_stream: Strukt fr strmmande inlsning av trningsdata i block om
+*              chunk_size trningsuppsttningar. Tv block anvnds vxelvis:
+*              medan anroparen trnar p ett block som hmtats via next
+*              lser bakgrundstrden in nsta block till det andra. Varje
+*              block lagras som en dataset, vars minne teranvnds mellan
+*              blocken. Strmmen kan spolas tillbaka via rewind infr varje
+*              ny epok.
+********************************************************************************/
+template <typename T = double>
+struct data_stream
+{
+   /* Medlemmar: */
+   std::ifstream file;                            /* Filen som data lses frn. */
+   stream_format format = stream_format::binary;  /* Filens format. */
+   std::streampos data_start = 0;                 /* Position fr frsta trningsuppsttningen. */
+   std::size_t chunk_size = 0;                    /* Antalet trningsuppsttningar per block. */
+   std::size_t inputs = 0;                        /* Antalet element indata per rad. */
+   std::size_t outputs = 0;                       /* Antalet element referensdata per rad. */
+   dataset<T> buffer;                             /* Block som lses in i bakgrunden. */
+   std::thread reader;                            /* Bakgrundstrd fr inlsning. */
+   std::mutex mutex;                              /* Skyddar ready samt stop. */
+   std::condition_variable condition;             /* Signalerar ndringar av ready samt stop. */
+   bool ready = false;                            /* Indikerar att buffer innehller ett inlst block. */
+   bool stop = false;                             /* Indikerar att bakgrundstrden skall avslutas. */
+
+   /* Medlemsfunktioner: */
+   data_stream(void) { }
+   data_stream(const data_stream&) = delete;
+   data_stream& operator=(const data_stream&) = delete;
+   ~data_stream(void) { this->close(); }
+
+   std::size_t num_inputs(void) const { return this->inputs; }
+   std::size_t num_outputs(void) const { return this->outputs; }
+   bool is_open(void) const { return this->file.is_open(); }
+
+   bool open_binary(const std::string& filename,
+                    const std::size_t chunk_size = 65536);
+   bool open_csv(const std::string& filename,
+                 const std::size_t num_inputs,
+                 const std::size_t num_outputs,
+                 const std::size_t chunk_size = 65536);
+   bool next(dataset<T>& chunk);
+   bool rewind(void);
+   void close(void);
+
+private:
+   void start(void);
+   void halt(void);
+   void run(void);
+   std::size_t read_chunk(dataset<T>& chunk);
+   std::size_t read_binary(dataset<T>& chunk);
+   std::size_t read_csv(dataset<T>& chunk);
+};
+
+#endif /* DATA_STREAM_HPP_ */
@@ -0,0 +1,257 @@
+/********************************************************************************
+* dataset.cpp: Definition av funktionsmedlemmar tillhrande strukten dataset
+*              fr sammanhngande samt minnesmappad trningsdata.
+********************************************************************************/
+#include "dataset.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <utility>
+
+namespace
+{
+/* Filsignatur samt aktuell version fr binrt lagrad trningsdata. */
+constexpr char dataset_magic[8] = { 'A', 'N', 'N', 'D', 'A', 'T', 'A', '\0' };
+constexpr std::uint32_t dataset_version = 1;
+constexpr std::uint32_t dataset_byte_order = 0x01020304;
+}
+
+/********************************************************************************
+* dataset: Initierar ny trningsdata via kopiering av angivna in- och
+*          referensdata till ett sammanhngande minnesblock, se assign.
+*
+*          - train_in : Innehller indata fr trningsuppsttningar.
+*          - train_out: Innehller referensdata fr trningsuppsttningar.
+********************************************************************************/
+template <typename T>
+dataset<T>::dataset(const std::vector<std::vector<T>>& train_in,
+                    const std::vector<std::vector<T>>& train_out)
+{
+   this->assign(train_in, train_out);
+   return;
+}
+
+/********************************************************************************
+* dataset: Initierar ny trningsdata som en kopia av angiven trningsdata.
+*          Kopian lagras alltid i egen vektor, ven om kllan r minnesmappad.
+*
+*          - source: Den trningsdata som skall kopieras.
+********************************************************************************/
+template <typename T>
+dataset<T>::dataset(const dataset& source)
+{
+   *this = source;
+   return;
+}
+
+/********************************************************************************
+* dataset: Initierar ny trningsdata genom att verta innehllet i angiven
+*          trningsdata, inklusive eventuell minnesmappning.
+*
+*          - source: Den trningsdata vars innehll vertas.
+********************************************************************************/
+template <typename T>
+dataset<T>::dataset(dataset&& source) noexcept
+{
+   *this = std::move(source);
+   return;
+}
+
+/********************************************************************************
+* operator=: Erstter innehllet i angiven trningsdata med en kopia av
+*            angiven klla, som lagras i egen vektor.
+*
+*            - source: Den trningsdata som skall kopieras.
+********************************************************************************/
+template <typename T>
+dataset<T>& dataset<T>::operator=(const dataset& source)
+{
+   if (this == &source) return *this;
+   const auto* data = source.data();
+   const auto size = source.num_sets() * source.row_size();
+
+   this->clear();
+   this->storage.assign(data, data + size);
+   this->rows = source.rows;
+   this->inputs = source.inputs;
+   this->outputs = source.outputs;
+   return *this;
+}
+
+/********************************************************************************
+* operator=: Erstter innehllet i angiven trningsdata genom att verta
+*            innehllet i angiven klla, som drefter r tom.
+*
+*            - source: Den trningsdata vars innehll vertas.
+********************************************************************************/
+template <typename T>
+dataset<T>& dataset<T>::operator=(dataset&& source) noexcept
+{
+   if (this == &source) return *this;
+   this->clear();
+
+   this->storage = std::move(source.storage);
+   this->mapped = source.mapped;
+   this->file = std::move(source.file);
+   this->rows = source.rows;
+   this->inputs = source.inputs;
+   this->outputs = source.outputs;
+
+   source.storage.clear();
+   source.mapped = nullptr;
+   source.rows = source.inputs = source.outputs = 0;
+   return *this;
+}
+
+/********************************************************************************
+* assign: Kopierar angivna in- och referensdata till ett sammanhngande
+*         minnesblock, dr varje rad bestr av indata fljt av referensdata.
+*         Antalet element per rad stts till den lngsta raden i respektive
+*         vektor, dr kortare rader fylls ut med nollor. Om vektorerna
+*         innehller olika antal rader anvnds det lgre antalet.
+*
+*         - train_in : Innehller indata fr trningsuppsttningar.
+*         - train_out: Innehller referensdata fr trningsuppsttningar.
+********************************************************************************/
+template <typename T>
+void dataset<T>::assign(const std::vector<std::vector<T>>& train_in,
+                        const std::vector<std::vector<T>>& train_out)
+{
+   const auto num_sets = std::min(train_in.size(), train_out.size());
+   std::size_t num_inputs = 0, num_outputs = 0;
+
+   for (std::size_t i = 0; i < num_sets; ++i)
+   {
+      num_inputs = std::max(num_inputs, train_in[i].size());
+      num_outputs = std::max(num_outputs, train_out[i].size());
+   }
+
+   this->clear();
+   this->rows = num_sets;
+   this->inputs = num_inputs;
+   this->outputs = num_outputs;
+   this->storage.assign(num_sets * this->row_size(), 0);
+
+   for (std::size_t i = 0; i < num_sets; ++i)
+   {
+      auto* row = this->storage.data() + i * this->row_size();
+      std::copy(train_in[i].begin(), train_in[i].end(), row);
+      std::copy(train_out[i].begin(), train_out[i].end(), row + num_inputs);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* clear: Tmmer angiven trningsdata och tar bort eventuell minnesmappning.
+********************************************************************************/
+template <typename T>
+void dataset<T>::clear(void)
+{
+   this->file.close();
+   this->storage.clear();
+   this->storage.shrink_to_fit();
+   this->mapped = nullptr;
+   this->rows = 0;
+   this->inputs = 0;
+   this->outputs = 0;
+   return;
+}
+
+/********************************************************************************
+* load: Lser in trningsdata frn angiven binrfil, skriven via save.
+*       P POSIX-system minnesmappas filen endast fr lsning, s att datan
+*       anvnds direkt frn sidcachen utan kopiering och endast de sidor som
+*       faktiskt anvnds lses in frn disk. P vriga system lses filen in
+*       i sin helhet, se mapped_file. Returnerar true om inlsningen
+*       lyckades, annars false, varvid trningsdatan r tom.
+*
+*       - filename: Skvg till filen som skall lsas in.
+********************************************************************************/
+template <typename T>
+bool dataset<T>::load(const std::string& filename)
+{
+   this->clear();
+   dataset_header header{};
+
+   if (!this->file.open(filename) || this->file.size() < sizeof(header))
+   {
+      this->file.close();
+      return false;
+   }
+
+   std::memcpy(&header, this->file.data(), sizeof(header));
+
+   if (!valid_header(header, this->file.size()))
+   {
+      this->file.close();
+      return false;
+   }
+
+   this->mapped = reinterpret_cast<const T*>(this->file.data() + sizeof(header));
+   this->rows = header.num_sets;
+   this->inputs = header.num_inputs;
+   this->outputs = header.num_outputs;
+   return true;
+}
+
+/********************************************************************************
+* save: Skriver angiven trningsdata till angiven binrfil, som sedan kan
+*       lsas in via load. Returnerar true om skrivningen lyckades.
+*
+*       - filename: Skvg till filen som skall skrivas.
+********************************************************************************/
+template <typename T>
+bool dataset<T>::save(const std::string& filename) const
+{
+   std::ofstream ofstream(filename, std::ios::binary | std::ios::trunc);
+   if (!ofstream) return false;
+
+   dataset_header header{};
+   std::memcpy(header.magic, dataset_magic, sizeof(dataset_magic));
+   header.version = dataset_version;
+   header.value_size = sizeof(T);
+   header.byte_order = dataset_byte_order;
+   header.num_sets = this->rows;
+   header.num_inputs = this->inputs;
+   header.num_outputs = this->outputs;
+
+   ofstream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   ofstream.write(reinterpret_cast<const char*>(this->data()), this->rows * this->row_size() * sizeof(T));
+   return static_cast<bool>(ofstream);
+}
+
+/********************************************************************************
+* valid_header: Indikerar ifall angivet filhuvud r giltigt fr element av
+*               typen T samt att en fil av angiven storlek rymmer samtliga
+*               trningsuppsttningar som anges i huvudet. Huvuden dr
+*               radens storlek i byte inte kan representeras, eller dr
+*               raderna saknar element trots att uppsttningar anges, r
+*               ogiltiga. Kontrollen sker via division, s att ingen
+*               berkning kan svmma ver.
+*
+*               - header   : Filhuvudet som skall kontrolleras.
+*               - file_size: Filens storlek i byte.
+********************************************************************************/
+template <typename T>
+bool dataset<T>::valid_header(const dataset_header& header,
+                              const std::uint64_t file_size)
+{
+   if (file_size < sizeof(dataset_header)) return false;
+   if (std::memcmp(header.magic, dataset_magic, sizeof(dataset_magic)) != 0) return false;
+   if (header.version != dataset_version || header.value_size != sizeof(T)) return false;
+   if (header.byte_order != dataset_byte_order) return false;
+
+   constexpr auto max_size = std::numeric_limits<std::uint64_t>::max();
+   if (header.num_inputs > max_size - header.num_outputs) return false;
+   const auto row_size = header.num_inputs + header.num_outputs;
+   if (row_size > max_size / sizeof(T)) return false;
+   if (row_size == 0) return header.num_sets == 0;
+   return header.num_sets <= (file_size - sizeof(dataset_header)) / sizeof(T) / row_size;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template struct dataset<float>;
+template struct dataset<double>;
@@ -0,0 +1,91 @@
+/********************************************************************************
+* dataset.hpp: Implementering av trningsdata lagrad i ett enda
+*              sammanhngande minnesblock, dr varje trningsuppsttning
+*              utgrs av en rad bestende av indata fljt av referensdata.
+*              Trningsdata kan sparas i ett kompakt binrt format, som vid
+*              inlsning minnesmappas direkt utan kopiering, vilket medfr
+*              att ven mycket stora datamngder kan lsas in snabbt.
+********************************************************************************/
+#ifndef DATASET_HPP_
+#define DATASET_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+
+/********************************************************************************
+* dataset_header: Huvud fr binrt lagrad trningsdata, som upptar de frsta
+*                 64 byten i filen. Drefter fljer num_sets rader, dr varje
+*                 rad bestr av num_inputs element indata fljt av num_outputs
+*                 element referensdata, lagrade utan utfyllnad i processorns
+*                 egen byteordning. Eftersom huvudet upptar en hel cache-line
+*                 r datan justerad nr filen minnesmappas.
+********************************************************************************/
+struct dataset_header
+{
+   char magic[8];             /* Filsignatur, "ANNDATA" fljt av nolltecken. */
+   std::uint32_t version;     /* Filformatets version. */
+   std::uint32_t value_size;  /* Antalet byte per element (4 = float, 8 = double). */
+   std::uint32_t byte_order;  /* Vrdet 0x01020304 skrivet i filens byteordning. */
+   std::uint32_t reserved;    /* Reserverat, stts till 0. */
+   std::uint64_t num_sets;    /* Antalet trningsuppsttningar. */
+   std::uint64_t num_inputs;  /* Antalet element indata per uppsttning. */
+   std::uint64_t num_outputs; /* Antalet element referensdata per uppsttning. */
+   std::uint8_t padding[16];  /* Utfyllnad till 64 byte, stts till 0. */
+};
+
+static_assert(sizeof(dataset_header) == 64, "dataset_header must occupy 64 bytes!");
+
+/********************************************************************************
+* dataset: Strukt fr trningsdata lagrad radvis i ett sammanhngande
+*          minnesblock, dr rad i innehller indata fljt av referensdata fr
+*          trningsuppsttning i. Datan lagras antingen i strukturens egen
+*          vektor eller i en minnesmappad fil, som endast lses. Indata och
+*          referensdata fr en given uppsttning ns via pekare, s att
+*          trning kan genomfras direkt p datan utan kopiering.
+********************************************************************************/
+template <typename T = double>
+struct dataset
+{
+   /* Medlemmar: */
+   std::vector<T> storage;    /* Egen lagring d datan inte r minnesmappad. */
+   const T* mapped = nullptr; /* Pekare till minnesmappad data, annars nullptr. */
+   mapped_file file;          /* Minnesmappad fil. */
+   std::size_t rows = 0;      /* Antalet trningsuppsttningar. */
+   std::size_t inputs = 0;    /* Antalet element indata per rad. */
+   std::size_t outputs = 0;   /* Antalet element referensdata per rad. */
+
+   /* Medlemsfunktioner: */
+   dataset(void) { }
+   dataset(const std::vector<std::vector<T>>& train_in,
+           const std::vector<std::vector<T>>& train_out);
+   dataset(const dataset& source);
+   dataset(dataset&& source) noexcept;
+   dataset& operator=(const dataset& source);
+   dataset& operator=(dataset&& source) noexcept;
+   ~dataset(void) { this->clear(); }
+
+   std::size_t num_sets(void) const { return this->rows; }
+   std::size_t num_inputs(void) const { return this->inputs; }
+   std::size_t num_outputs(void) const { return this->outputs; }
+   std::size_t row_size(void) const { return this->inputs + this->outputs; }
+   bool is_mapped(void) const { return this->file.is_open(); }
+
+   const T* data(void) const { return this->mapped ? this->mapped : this->storage.data(); }
+   const T* input(const std::size_t set) const { return this->data() + set * this->row_size(); }
+   const T* output(const std::size_t set) const { return this->input(set) + this->inputs; }
+
+   void assign(const std::vector<std::vector<T>>& train_in,
+               const std::vector<std::vector<T>>& train_out);
+   void clear(void);
+   bool load(const std::string& filename);
+   bool save(const std::string& filename) const;
+
+   static bool valid_header(const dataset_header& header,
+                            const std::uint64_t file_size);
+};
+
+#endif /* DATASET_HPP_ */
@@ -4,6 +4,10 @@
 *                  samt utgngslager i neurala ntverk.
 ********************************************************************************/
 #include "dense_layer.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
 
 /********************************************************************************
 * dense_layer: Initierar parametrar i ett nytt dense-lager med valbart antal
@@ -15,8 +19,9 @@
 *              - num_nodes  : Antalet noder i det nya dense-lagret.
 *              - num_weights: Antalet vikter per nod i det nya dense-lagret.
 ********************************************************************************/
-dense_layer::dense_layer(const std::size_t num_nodes,
-                         const std::size_t num_weights)
+template <typename T>
+dense_layer<T>::dense_layer(const std::size_t num_nodes,
+                            const std::size_t num_weights)
 {
    this->resize(num_nodes, num_weights);
    return;
@@ -25,31 +30,79 @@ dense_layer::dense_layer(const std::size_t num_nodes,
 /********************************************************************************
 * resize: Allokerar minne samt tilldelar startvrden fr angivet antal noder
 *         samt angivet antal vikter per nod i angivet dense-lager. Eventuellt
-*         tidigare innehll raderas innan omallokering genomfrs.
+*         tidigare innehll raderas innan omallokering genomfrs. Startvrdena
+*         genereras av en generator med rng::default_seed som startvrde.
+* 
+*         - num_nodes  : Nytt antal noder i dense-lagret efter omallokering.
+*         - num_weights: Nytt antal vikter per nod i dense-lagret efter 
+*                        omallokering.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::resize(const std::size_t num_nodes,
+                            const std::size_t num_weights)
+{
+   rng generator;
+   this->resize(num_nodes, num_weights, generator);
+   return;
+}
+
+/********************************************************************************
+* resize: Allokerar minne samt tilldelar startvrden fr angivet antal noder
+*         samt angivet antal vikter per nod i angivet dense-lager, dr bias
+*         och vikter genereras nod fr nod av angiven generator.
 * 
 *         - num_nodes  : Nytt antal noder i dense-lagret efter omallokering.
 *         - num_weights: Nytt antal vikter per nod i dense-lagret efter 
 *                        omallokering.
+*         - generator  : Slumptalsgenerator fr startvrdena.
 ********************************************************************************/
-void dense_layer::resize(const std::size_t num_nodes,
-                         const std::size_t num_weights)
+template <typename T>
+void dense_layer<T>::resize(const std::size_t num_nodes,
+                            const std::size_t num_weights,
+                            rng& generator)
 {
    this->clear();
-   this->output.resize(num_nodes, 0.0);
-   this->error.resize(num_nodes, 0.0);
-   this->bias.resize(num_nodes, 0.0);
-   this->weights.resize(num_nodes, std::vector<double>(num_weights, 0.0));
+   this->output.resize(num_nodes, 0);
+   this->error.resize(num_nodes, 0);
+   this->bias.resize(num_nodes, 0);
+   this->weights.resize(num_nodes, num_weights);
 
    for (std::size_t i = 0; i < this->num_nodes(); ++i)
    {
-      this->bias[i] = this->get_random();
-
-      for (std::size_t j = 0; j < this->num_weights(); ++j)
-      {
-         this->weights[i][j] = this->get_random();
-      }
+      this->bias[i] = generator.uniform<T>();
+      generator.fill(this->weights[i], this->num_weights());
    }
 
+   this->reset_optimizer();
+   return;
+}
+
+/********************************************************************************
+* attach: Tilldelar angivet dense-lager angivet antal noder och vikter per nod
+*         med parametrar frn externt minne, exempelvis en minnesmappad
+*         modellfil. Bias kopieras, medan vikterna anvnds direkt utan
+*         kopiering och drmed mste finnas kvar s lnge lagret anvnds,
+*         se matrix::attach. Eventuellt tidigare innehll raderas, medan
+*         vald optimerare behlls med nollstllt tillstnd.
+*
+*         - bias       : Pekare till nodernas bias, ett element per nod.
+*         - weights    : Pekare till nodernas vikter, lagrade radvis med
+*                        samma utfyllnad som i strukten matrix.
+*         - num_nodes  : Antalet noder i dense-lagret.
+*         - num_weights: Antalet vikter per nod i dense-lagret.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::attach(const T* bias,
+                            T* weights,
+                            const std::size_t num_nodes,
+                            const std::size_t num_weights)
+{
+   this->clear();
+   this->output.resize(num_nodes, 0);
+   this->error.resize(num_nodes, 0);
+   this->bias.assign(bias, bias + num_nodes);
+   this->weights.attach(weights, num_nodes, num_weights);
+   this->reset_optimizer();
    return;
 }
 
@@ -60,12 +113,62 @@ void dense_layer::resize(const std::size_t num_nodes,
 *        av medlemsfunktionen resize.
 * 
 ********************************************************************************/
-void dense_layer::clear(void)
+template <typename T>
+void dense_layer<T>::clear(void)
 {
    this->output.clear();
    this->error.clear();
    this->bias.clear();
    this->weights.clear();
+   this->state.clear();
+   this->bias_state.clear();
+   this->correction.clear();
+   this->gradient.clear();
+   return;
+}
+
+/********************************************************************************
+* set_optimizer: Vljer optimerare fr angivet dense-lager och allokerar
+*                optimerarens tillstnd, som nollstlls. Tillstndet
+*                allokeras endast hr samt vid ndrad storlek p lagret, s
+*                att optimeringen drefter genomfrs utan minnesallokering.
+*
+*                - optimizer: Instllningar fr den nya optimeraren.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::set_optimizer(const optimizer_options<T>& optimizer)
+{
+   this->optimizer = optimizer;
+   this->reset_optimizer();
+   return;
+}
+
+/********************************************************************************
+* reset_optimizer: Nollstller optimerarens tillstnd i angivet dense-lager,
+*                  dr num_moments rader per nod allokeras fr vikterna och
+*                  num_moments element per nod fr bias. Nodens rader lagras
+*                  intill varandra, s att en viktrad och dess moment ligger
+*                  nra varandra i minnet. Vid gradient descent frigrs
+*                  samtliga buffertar, eftersom inget tillstnd krvs.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::reset_optimizer(void)
+{
+   const auto moments = this->optimizer.num_moments();
+
+   if (moments == 0)
+   {
+      this->state.clear();
+      this->bias_state.clear();
+      this->correction.clear();
+      this->gradient.clear();
+      return;
+   }
+
+   this->state.resize(moments * this->num_nodes(), this->num_weights());
+   this->bias_state.assign(moments * this->num_nodes(), 0);
+   this->correction.assign(2 * this->num_nodes(), 1);
+   this->gradient.assign(this->num_weights(), 0);
    return;
 }
 
@@ -76,18 +179,36 @@ void dense_layer::clear(void)
 *              - input: Ny indata som anvnds fr att uppdatera nodernas
 *                       utdata.
 ********************************************************************************/
-void dense_layer::feedforward(const std::vector<double>& input)
+template <typename T>
+void dense_layer<T>::feedforward(const std::vector<T>& input)
 {
-   for (std::size_t i = 0; i < this->num_nodes(); ++i)
-   {
-      double sum = this->bias[i];
+   this->feedforward(input.data(), input.size(), this->output.data());
+   return;
+}
 
-      for (std::size_t j = 0; j < this->num_weights() && j < input.size(); ++j)
-      {
-         sum += input[j] * this->weights[i][j];
-      }
+/********************************************************************************
+* feedforward: Berknar utdata fr samtliga noder i angivet dense-lager via
+*              angiven indata och lagrar resultatet i angiven buffert i
+*              stllet fr i lagrets utdata. Lagret modifieras inte, vilket
+*              medfr att flera trdar kan anvnda samma lager samtidigt s
+*              lnge var och en har en egen utdatabuffert.
+*
+*              - input     : Pekare till indata.
+*              - num_inputs: Antalet element i indatan.
+*              - output    : Pekare till buffert med plats fr lagrets utdata,
+*                            dvs. ett element per nod.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::feedforward(const T* input,
+                                 const std::size_t num_inputs,
+                                 T* output) const
+{
+   const auto num_weights = std::min(this->num_weights(), num_inputs);
 
-      this->output[i] = this->relu(sum);
+   for (std::size_t i = 0; i < this->num_nodes(); ++i)
+   {
+      const auto sum = this->bias[i] + simd::dot(this->weights[i], input, num_weights);
+      output[i] = this->relu(sum);
    }
 
    return;
@@ -95,42 +216,119 @@ void dense_layer::feedforward(const std::vector<double>& input)
 
 /********************************************************************************
 * backpropagate: Berknar avvikelser i angivet utgngslager via jmfrelse av
-*                predikterad utdata samt angiven referensdata.
+*                predikterad utdata samt angiven referensdata. Returnerar
+*                summan av de kvadrerade skillnaderna mellan referensdata och
+*                utdata, dvs. frlusten fr trningsuppsttningen.
 * 
 *                - reference: Referensdata frn trningsuppsttningarna,
 *                             vilket jmfrs mot predikterad utdata.
 ********************************************************************************/
-void dense_layer::backpropagate(const std::vector<double>& reference)
+template <typename T>
+T dense_layer<T>::backpropagate(const std::vector<T>& reference)
+{
+   return this->backpropagate(reference.data(), reference.size());
+}
+
+/********************************************************************************
+* backpropagate: Berknar avvikelser i angivet utgngslager via jmfrelse av
+*                predikterad utdata samt referensdata lagrad i angiven
+*                buffert, exempelvis en rad i en dataset. Skillnaderna
+*                kvadreras och summeras i samma passage, s att frlusten
+*                erhlls utan extra berkningar och returneras.
+*
+*                - reference     : Pekare till referensdata.
+*                - num_references: Antalet element i referensdatan.
+********************************************************************************/
+template <typename T>
+T dense_layer<T>::backpropagate(const T* reference,
+                                const std::size_t num_references)
 {
-   for (std::size_t i = 0; i < this->num_nodes() && i < reference.size(); ++i)
+   T loss = 0;
+
+   for (std::size_t i = 0; i < this->num_nodes() && i < num_references; ++i)
    {
       const auto deviation = reference[i] - this->output[i];
       this->error[i] = deviation * this->delta_relu(this->output[i]);
+      loss += deviation * deviation;
    }
 
-   return;
+   return loss;
 }
 
 /********************************************************************************
 * backpropagate: Berknar avvikelser i angivet dolt lagret via uppmtta 
 *                avvikelser samt vikter i efterfljande utgngslager.
+*                Avvikelserna summeras radvis, dr varje nod i nsta lager
+*                adderar sin avvikelse multiplicerad med sin viktrad, vilket
+*                medfr att vikterna i nsta lager lses sekventiellt.
 * 
 *                - next_layer: Nsta lager i ett givet neuralt ntverk, vilket
 *                              fr denna implementering br utgras av ett
 *                              utgngslager.
 ********************************************************************************/
-void dense_layer::backpropagate(const dense_layer& next_layer)
+template <typename T>
+void dense_layer<T>::backpropagate(const dense_layer& next_layer)
 {
+   const auto num_weights = std::min(this->num_nodes(), next_layer.num_weights());
+   std::fill(this->error.begin(), this->error.end(), 0);
+
+   for (std::size_t j = 0; j < next_layer.num_nodes(); ++j)
+   {
+      simd::axpy(next_layer.error[j], next_layer.weights[j], this->error.data(), num_weights);
+   }
+
    for (std::size_t i = 0; i < this->num_nodes(); ++i)
    {
-      auto deviation = 0.0;
+      this->error[i] *= this->delta_relu(this->output[i]);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* backpropagate: Berknar avvikelser i angivet dolt lager via uppmtta
+*                avvikelser samt vikter i efterfljande lager och justerar
+*                samtidigt nsta lagers parametrar, motsvarande ett anrop av
+*                backpropagate(next_layer) fljt av next_layer.optimize med
+*                lagrets utdata som indata. Varje viktrad i nsta lager
+*                adderas frst till avvikelserna och justeras sedan medan den
+*                ligger kvar i register, vilket medfr att raden endast lses
+*                och skrivs en gng per trningsuppsttning i stllet fr att
+*                lsas i tv separata passager. Om nsta lager anvnder en
+*                optimerare med moment justeras raden tillsammans med sina
+*                moment direkt efter summeringen, medan den ligger kvar i
+*                cacheminnet.
+*
+*                - next_layer   : Nsta lager i ett givet neuralt ntverk,
+*                                 vars parametrar justeras.
+*                - learning_rate: Lrhastigheten fr nsta lager.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::backpropagate(dense_layer& next_layer,
+                                   const T learning_rate)
+{
+   const auto num_weights = std::min(this->num_nodes(), next_layer.num_weights());
+   std::fill(this->error.begin(), this->error.end(), 0);
 
-      for (std::size_t j = 0; j < next_layer.num_nodes(); ++j)
+   for (std::size_t j = 0; j < next_layer.num_nodes(); ++j)
+   {
+      if (next_layer.optimizer.type == optimizer_type::sgd)
       {
-         deviation += next_layer.error[j] * next_layer.weights[j][i];
+         const auto change_rate = next_layer.error[j] * learning_rate;
+         next_layer.bias[j] += change_rate;
+         simd::axpy_update(next_layer.error[j], next_layer.weights[j], this->error.data(), change_rate,
+                           this->output.data(), num_weights);
       }
+      else
+      {
+         simd::axpy(next_layer.error[j], next_layer.weights[j], this->error.data(), num_weights);
+         next_layer.update(j, next_layer.error[j], this->output.data(), next_layer.error[j], num_weights, learning_rate);
+      }
+   }
 
-      this->error[i] = deviation * this->delta_relu(this->output[i]);
+   for (std::size_t i = 0; i < this->num_nodes(); ++i)
+   {
+      this->error[i] *= this->delta_relu(this->output[i]);
    }
 
    return;
@@ -146,18 +344,662 @@ void dense_layer::backpropagate(const dense_layer& next_layer)
 *           - learning_rate: Lrhastigheten, som avgr hur mycket dense-lagrets
 *                            parametrar skall justeras vid uppmtt avvikelse.
 ********************************************************************************/
-void dense_layer::optimize(const std::vector<double>& input,
-                           const double learning_rate)
+template <typename T>
+void dense_layer<T>::optimize(const std::vector<T>& input,
+                              const T learning_rate)
 {
+   this->optimize(input.data(), input.size(), learning_rate);
+   return;
+}
+
+/********************************************************************************
+* optimize: Justerar parametrar (bias och vikter) i angivet dense-lager med
+*           angiven lrhastighet via indata lagrad i angiven buffert med
+*           vald optimerare.
+*
+*           - input        : Pekare till utdata frn fregende lager.
+*           - num_inputs   : Antalet element i indatan.
+*           - learning_rate: Lrhastigheten, som avgr hur mycket dense-lagrets
+*                            parametrar skall justeras vid uppmtt avvikelse.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::optimize(const T* input,
+                              const std::size_t num_inputs,
+                              const T learning_rate)
+{
+   const auto num_weights = std::min(this->num_weights(), num_inputs);
+
    for (std::size_t i = 0; i < this->num_nodes(); ++i)
    {
-      const auto change_rate = this->error[i] * learning_rate;
-      this->bias[i] += change_rate;
+      this->update(i, this->error[i], input, this->error[i], num_weights, learning_rate);
+   }
 
-      for (std::size_t j = 0; j < this->num_weights() && j < input.size(); ++j)
+   return;
+}
+
+/********************************************************************************
+* feedforward: Berknar utdata fr samtliga noder i angivet dense-lager via
+*              angiven gles indata och lagrar resultatet i angiven buffert.
+*              Endast vikterna fr de kolumner som terfinns i indatan lses,
+*              vilket medfr att kostnaden r proportionell mot antalet
+*              lagrade vrden i stllet fr antalet vikter per nod. Index
+*              utanfr lagrets vikter ignoreras. Lagret modifieras inte.
+*
+*              - input : Gles indata.
+*              - output: Pekare till buffert med plats fr lagrets utdata,
+*                        dvs. ett element per nod.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::feedforward(const sparse_row<T>& input,
+                                 T* output) const
+{
+   const auto num_weights = this->num_weights();
+
+   for (std::size_t i = 0; i < this->num_nodes(); ++i)
+   {
+      const auto* weights = this->weights[i];
+      auto sum = this->bias[i];
+
+      for (std::size_t k = 0; k < input.size; ++k)
+      {
+         if (input.index[k] < num_weights) sum += weights[input.index[k]] * input.value[k];
+      }
+
+      output[i] = this->relu(sum);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* preactivate: Berknar summan fre aktivering, dvs. bias plus viktad indata,
+*              fr samtliga noder i angivet dense-lager via angiven indata och
+*              lagrar resultatet i angiven buffert. Summorna kan drefter
+*              uppdateras via update_preactivation nr indatan frndras och
+*              omvandlas till utdata via activate. Lagret modifieras inte.
+*
+*              - input     : Pekare till indata.
+*              - num_inputs: Antalet element i indatan.
+*              - sum       : Pekare till buffert med plats fr ett element per
+*                            nod.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::preactivate(const T* input,
+                                 const std::size_t num_inputs,
+                                 T* sum) const
+{
+   const auto num_weights = std::min(this->num_weights(), num_inputs);
+
+   for (std::size_t i = 0; i < this->num_nodes(); ++i)
+   {
+      sum[i] = this->bias[i] + simd::dot(this->weights[i], input, num_weights);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* update_preactivation: Uppdaterar summorna fre aktivering fr samtliga noder
+*                       i angivet dense-lager nr ett ftal indata har
+*                       frndrats, dr frndringarna passeras glest som
+*                       skillnaden mellan nytt och tidigare vrde. Endast
+*                       vikterna fr de frndrade indata lses, vilket
+*                       medfr att kostnaden r proportionell mot antalet
+*                       frndringar i stllet fr antalet vikter per nod.
+*                       Index utanfr lagrets vikter ignoreras. Eftersom
+*                       avrundningsfel ackumuleras vid varje uppdatering br
+*                       summorna med jmna mellanrum rknas om via preactivate.
+*
+*                       - delta: Frndringar av indatan, dr value[k] anger
+*                                nytt minus tidigare vrde fr index[k].
+*                       - sum  : Pekare till nodernas summor, som uppdateras.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::update_preactivation(const sparse_row<T>& delta,
+                                          T* sum) const
+{
+   const auto num_weights = this->num_weights();
+
+   for (std::size_t i = 0; i < this->num_nodes(); ++i)
+   {
+      const auto* weights = this->weights[i];
+      auto change = T(0);
+
+      for (std::size_t k = 0; k < delta.size; ++k)
       {
-         this->weights[i][j] += change_rate * input[j];
+         if (delta.index[k] < num_weights) change += weights[delta.index[k]] * delta.value[k];
       }
+
+      sum[i] += change;
+   }
+
+   return;
+}
+
+/********************************************************************************
+* activate: Berknar utdata fr samtliga noder i angivet dense-lager via
+*           angivna summor fre aktivering, se preactivate, och lagrar
+*           resultatet i angiven buffert.
+*
+*           - sum   : Pekare till nodernas summor fre aktivering.
+*           - output: Pekare till buffert med plats fr ett element per nod.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::activate(const T* sum,
+                              T* output) const
+{
+   for (std::size_t i = 0; i < this->num_nodes(); ++i)
+   {
+      output[i] = this->relu(sum[i]);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* optimize: Justerar parametrar (bias och vikter) i angivet dense-lager med
+*           angiven lrhastighet via angiven gles indata. Eftersom
+*           gradienten fr en vikt r noll nr motsvarande indata r noll
+*           justeras endast vikterna i de kolumner som terfinns i indatan,
+*           vilket ger samma resultat som motsvarande tta optimering. Noder
+*           utan avvikelse hoppas ver. Vid optimering med moment justeras
+*           endast momenten fr de vikter som berrs, vilket innebr att
+*           momenten fr vriga vikter inte avtar frrn de berrs igen.
+*
+*           - input        : Gles indata till lagret.
+*           - learning_rate: Lrhastigheten, som avgr hur mycket dense-lagrets
+*                            parametrar skall justeras vid uppmtt avvikelse.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::optimize(const sparse_row<T>& input,
+                              const T learning_rate)
+{
+   const auto num_weights = this->num_weights();
+
+   const auto moments = this->optimizer.num_moments();
+
+   for (std::size_t i = 0; i < this->num_nodes(); ++i)
+   {
+      if (this->error[i] == 0) continue;
+      const auto rate = this->step_rate(i, learning_rate);
+      auto* weights = this->weights[i];
+      auto* moment = moments > 0 ? this->state[i * moments] : nullptr;
+      this->adjust(this->bias[i], this->bias_state.data() + i * moments, 1, this->error[i], rate);
+
+      for (std::size_t k = 0; k < input.size; ++k)
+      {
+         const auto j = input.index[k];
+         if (j >= num_weights) continue;
+         this->adjust(weights[j], moment ? moment + j : nullptr, this->state.stride, this->error[i] * input.value[k], rate);
+      }
+   }
+
+   return;
+}
+
+/********************************************************************************
+* feedforward: Berknar utdata fr samtliga noder i angivet dense-lager fr
+*              de frsta num_samples raderna i angiven indata, dr varje rad
+*              utgr en trningsuppsttning. Resultatet lagras radvis i
+*              angiven batch. Berkningen genomfrs som en matrisprodukt, s
+*              att varje vikt teranvnds fr samtliga uppsttningar i batchen
+*              medan den ligger kvar i cacheminnet.
+*
+*              - input      : Indata, en rad per trningsuppsttning.
+*              - num_samples: Antalet trningsuppsttningar i batchen.
+*              - batch      : Buffertar dr utdata lagras.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::feedforward(const matrix<T>& input,
+                                 const std::size_t num_samples,
+                                 dense_batch<T>& batch) const
+{
+   this->feedforward(input[0], num_samples, input.cols, input.stride, batch.output[0], batch.output.stride);
+   return;
+}
+
+/********************************************************************************
+* feedforward: Berknar utdata fr samtliga noder i angivet dense-lager fr
+*              angivet antal rader i en radvis lagrad indatamatris och lagrar
+*              resultatet radvis i angiven utdatamatris. Lagret modifieras
+*              inte, vilket medfr att flera trdar kan anvnda samma lager
+*              samtidigt med var sin utdatamatris.
+*
+*              - input        : Pekare till indatamatrisens frsta element.
+*              - num_samples  : Antalet rader i indatamatrisen.
+*              - num_inputs   : Antalet element per rad i indatamatrisen.
+*              - input_stride : Avstndet mellan indatamatrisens rader.
+*              - output       : Pekare till utdatamatrisens frsta element,
+*                               med plats fr ett element per nod och rad.
+*              - output_stride: Avstndet mellan utdatamatrisens rader.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::feedforward(const T* input,
+                                 const std::size_t num_samples,
+                                 const std::size_t num_inputs,
+                                 const std::size_t input_stride,
+                                 T* output,
+                                 const std::size_t output_stride) const
+{
+   const auto num_weights = std::min(this->num_weights(), num_inputs);
+
+   for (std::size_t s = 0; s < num_samples; ++s)
+   {
+      std::copy(this->bias.begin(), this->bias.end(), output + s * output_stride);
+   }
+
+   simd::gemm_nt(num_samples, this->num_nodes(), num_weights, input, input_stride,
+                 this->weights[0], this->weights.stride, output, output_stride);
+
+   for (std::size_t s = 0; s < num_samples; ++s)
+   {
+      auto* row = output + s * output_stride;
+
+      for (std::size_t i = 0; i < this->num_nodes(); ++i)
+      {
+         row[i] = this->relu(row[i]);
+      }
+   }
+
+   return;
+}
+
+/********************************************************************************
+* backpropagate: Berknar avvikelser i angivet utgngslager fr samtliga
+*                trningsuppsttningar i en batch via jmfrelse av
+*                predikterad utdata samt angiven referensdata. Returnerar
+*                summan av de kvadrerade skillnaderna fr samtliga
+*                trningsuppsttningar, dvs. frlusten fr batchen.
+*
+*                - reference  : Referensdata, en rad per trningsuppsttning.
+*                - num_samples: Antalet trningsuppsttningar i batchen.
+*                - batch      : Buffertar innehllande lagrets utdata, dr
+*                               berknade avvikelser lagras.
+********************************************************************************/
+template <typename T>
+T dense_layer<T>::backpropagate(const matrix<T>& reference,
+                                const std::size_t num_samples,
+                                dense_batch<T>& batch) const
+{
+   const auto num_references = std::min(this->num_nodes(), reference.cols);
+   T loss = 0;
+
+   for (std::size_t s = 0; s < num_samples; ++s)
+   {
+      const auto* output = batch.output[s];
+      auto* error = batch.error[s];
+
+      for (std::size_t i = 0; i < this->num_nodes(); ++i)
+      {
+         const auto deviation = i < num_references ? reference[s][i] - output[i] : 0;
+         error[i] = deviation * this->delta_relu(output[i]);
+         loss += deviation * deviation;
+      }
+   }
+
+   return loss;
+}
+
+/********************************************************************************
+* backpropagate: Berknar avvikelser i angivet dolt lager fr samtliga
+*                trningsuppsttningar i en batch via uppmtta avvikelser samt
+*                vikter i efterfljande lager, vilket genomfrs som en
+*                matrisprodukt mellan nsta lagers avvikelser och vikter.
+*
+*                - next_layer : Nsta lager i ett givet neuralt ntverk.
+*                - next_batch : Buffertar innehllande nsta lagers avvikelser.
+*                - num_samples: Antalet trningsuppsttningar i batchen.
+*                - batch      : Buffertar innehllande lagrets utdata, dr
+*                               berknade avvikelser lagras.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::backpropagate(const dense_layer& next_layer,
+                                   const dense_batch<T>& next_batch,
+                                   const std::size_t num_samples,
+                                   dense_batch<T>& batch) const
+{
+   const auto num_weights = std::min(this->num_nodes(), next_layer.num_weights());
+
+   for (std::size_t s = 0; s < num_samples; ++s)
+   {
+      std::fill(batch.error[s], batch.error[s] + this->num_nodes(), 0);
+   }
+
+   simd::gemm_nn(num_samples, num_weights, next_layer.num_nodes(), next_batch.error[0], next_batch.error.stride,
+                 next_layer.weights[0], next_layer.weights.stride, batch.error[0], batch.error.stride);
+
+   for (std::size_t s = 0; s < num_samples; ++s)
+   {
+      const auto* output = batch.output[s];
+      auto* error = batch.error[s];
+
+      for (std::size_t i = 0; i < this->num_nodes(); ++i)
+      {
+         error[i] *= this->delta_relu(output[i]);
+      }
+   }
+
+   return;
+}
+
+/********************************************************************************
+* accumulate: Berknar gradienter fr bias och vikter i angivet dense-lager,
+*             summerade ver samtliga trningsuppsttningar i en batch.
+*             Tidigare innehll i batchens gradienter skrivs ver.
+*
+*             - input      : Utdata frn fregende lager, en rad per
+*                            trningsuppsttning.
+*             - num_samples: Antalet trningsuppsttningar i batchen.
+*             - batch      : Buffertar innehllande lagrets avvikelser, dr
+*                            berknade gradienter lagras.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::accumulate(const matrix<T>& input,
+                                const std::size_t num_samples,
+                                dense_batch<T>& batch) const
+{
+   const auto num_inputs = std::min(this->num_weights(), input.cols);
+   std::fill(batch.weight_gradient[0], batch.weight_gradient[0] + batch.weight_gradient.size(), 0);
+   std::fill(batch.bias_gradient[0], batch.bias_gradient[0] + batch.bias_gradient.size(), 0);
+
+   for (std::size_t s = 0; s < num_samples; ++s)
+   {
+      simd::axpy(T(1), batch.error[s], batch.bias_gradient[0], this->num_nodes());
+   }
+
+   simd::gemm_tn(this->num_nodes(), num_inputs, num_samples, batch.error[0], batch.error.stride,
+                 input[0], input.stride, batch.weight_gradient[0], batch.weight_gradient.stride);
+   return;
+}
+
+/********************************************************************************
+* optimize: Justerar parametrar (bias och vikter) i angivet dense-lager med
+*           gradienter ackumulerade ver en batch, dr medelvrdet av
+*           gradienterna anvnds. Eftersom vikterna och gradienterna lagras
+*           med samma radavstnd uppdateras samtliga vikter vid gradient
+*           descent i en enda sekventiell passage. Med vald optimerare
+*           justeras varje viktrad tillsammans med sina moment. Noderna kan
+*           delas upp i num_parts lika stora delar, dr endast del part
+*           justeras, vilket medfr att flera trdar kan justera var sin del
+*           av lagret.
+*
+*           - batch        : Buffertar innehllande ackumulerade gradienter.
+*           - num_samples  : Antalet trningsuppsttningar som gradienterna
+*                            har ackumulerats ver.
+*           - learning_rate: Lrhastigheten fr justeringen.
+*           - part         : Index fr den del av noderna som skall justeras
+*                            (default = 0).
+*           - num_parts    : Antalet delar som noderna delas upp i
+*                            (default = 1, dvs. samtliga noder justeras).
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::optimize(const dense_batch<T>& batch,
+                              const std::size_t num_samples,
+                              const T learning_rate,
+                              const std::size_t part,
+                              const std::size_t num_parts)
+{
+   const auto first = this->num_nodes() * part / num_parts;
+   const auto last = this->num_nodes() * (part + 1) / num_parts;
+   if (first >= last || num_samples == 0) return;
+
+   if (this->optimizer.type == optimizer_type::sgd)
+   {
+      const auto step = learning_rate / num_samples;
+      simd::axpy(step, batch.bias_gradient[0] + first, this->bias.data() + first, last - first);
+      simd::axpy(step, batch.weight_gradient[first], this->weights[first], (last - first) * this->weights.stride);
+      return;
+   }
+
+   const auto num_weights = std::min(this->num_weights(), batch.weight_gradient.cols);
+   const auto scale = T(1) / num_samples;
+
+   for (auto i = first; i < last; ++i)
+   {
+      this->update(i, scale, batch.weight_gradient[i], batch.bias_gradient[0][i] * scale, num_weights, learning_rate);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* feedforward: Berknar utdata fr samtliga noder i angivet dense-lager fr
+*              angivet antal glesa rader, dr varje rad utgr en
+*              trningsuppsttning, och lagrar resultatet radvis i angiven
+*              batch.
+*
+*              - input      : Pekare till glesa indata, en rad per
+*                             trningsuppsttning.
+*              - num_samples: Antalet trningsuppsttningar i batchen.
+*              - batch      : Buffertar dr utdata lagras.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::feedforward(const sparse_row<T>* input,
+                                 const std::size_t num_samples,
+                                 dense_batch<T>& batch) const
+{
+   for (std::size_t s = 0; s < num_samples; ++s)
+   {
+      this->feedforward(input[s], batch.output[s]);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* optimize: Justerar parametrar (bias och vikter) i angivet dense-lager via
+*           avvikelserna i angiven batch samt motsvarande glesa indata.
+*           I stllet fr att ackumulera en tt gradient adderas varje
+*           trningsuppsttnings bidrag direkt till de vikter som berrs,
+*           vilket ger samma resultat som accumulate fljt av optimize men
+*           endast lser och skriver de kolumner som terfinns i indatan.
+*           Avvikelserna mste drfr vara berknade fr hela batchen innan
+*           anropet. Varje viktrad justeras fr samtliga uppsttningar innan
+*           nsta rad behandlas, s att raden ligger kvar i cacheminnet.
+*
+*           Vid optimering med moment mste gradienten fr varje vikt
+*           summeras ver hela batchen innan momenten justeras. Nodens
+*           gradienter summeras drfr frst i lagrets glesa buffert, dr
+*           endast de kolumner som terfinns i indatan skrivs, varefter varje
+*           berrd vikt justeras en gng och motsvarande element nollstlls.
+*
+*           - input        : Pekare till glesa indata, en rad per
+*                            trningsuppsttning.
+*           - num_samples  : Antalet trningsuppsttningar i batchen.
+*           - batch        : Buffertar innehllande lagrets avvikelser.
+*           - learning_rate: Lrhastigheten fr justeringen, dr medelvrdet
+*                            av gradienterna anvnds.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::optimize(const sparse_row<T>* input,
+                              const std::size_t num_samples,
+                              const dense_batch<T>& batch,
+                              const T learning_rate)
+{
+   const auto num_weights = this->num_weights();
+   const auto moments = this->optimizer.num_moments();
+   if (num_samples == 0) return;
+
+   if (moments == 0)
+   {
+      const auto step = learning_rate / num_samples;
+
+      for (std::size_t i = 0; i < this->num_nodes(); ++i)
+      {
+         auto* weights = this->weights[i];
+
+         for (std::size_t s = 0; s < num_samples; ++s)
+         {
+            const auto change_rate = batch.error[s][i] * step;
+            if (change_rate == 0) continue;
+            const auto& row = input[s];
+            this->bias[i] += change_rate;
+
+            for (std::size_t k = 0; k < row.size; ++k)
+            {
+               if (row.index[k] < num_weights) weights[row.index[k]] += change_rate * row.value[k];
+            }
+         }
+      }
+
+      return;
+   }
+
+   const auto scale = T(1) / num_samples;
+   auto* gradient = this->gradient.data();
+
+   for (std::size_t i = 0; i < this->num_nodes(); ++i)
+   {
+      T bias_gradient = 0;
+      bool touched = false;
+
+      for (std::size_t s = 0; s < num_samples; ++s)
+      {
+         const auto error = batch.error[s][i];
+         if (error == 0) continue;
+         const auto& row = input[s];
+         bias_gradient += error;
+         touched = true;
+
+         for (std::size_t k = 0; k < row.size; ++k)
+         {
+            if (row.index[k] < num_weights) gradient[row.index[k]] += error * row.value[k];
+         }
+      }
+
+      if (!touched) continue;
+      const auto rate = this->step_rate(i, learning_rate);
+      auto* weights = this->weights[i];
+      auto* moment = this->state[i * moments];
+      this->adjust(this->bias[i], this->bias_state.data() + i * moments, 1, bias_gradient * scale, rate);
+
+      for (std::size_t s = 0; s < num_samples; ++s)
+      {
+         const auto& row = input[s];
+
+         for (std::size_t k = 0; k < row.size; ++k)
+         {
+            const auto j = row.index[k];
+            if (j >= num_weights || gradient[j] == 0) continue;
+            this->adjust(weights[j], moment + j, this->state.stride, gradient[j] * scale, rate);
+            gradient[j] = 0;
+         }
+      }
+   }
+
+   return;
+}
+
+/********************************************************************************
+* step_rate: Returnerar lrhastigheten fr nsta justering av angiven nod.
+*            Fr Adam rknas potenserna beta1^t och beta2^t fr noden upp ett
+*            steg, varefter lrhastigheten multipliceras med
+*            sqrt(1 - beta2^t) / (1 - beta1^t), vilket korrigerar fr att
+*            momenten startar p noll. Fr vriga optimerare returneras
+*            angiven lrhastighet ofrndrad.
+*
+*            - node         : Index fr den nod som skall justeras.
+*            - learning_rate: Angiven lrhastighet.
+********************************************************************************/
+template <typename T>
+T dense_layer<T>::step_rate(const std::size_t node,
+                            const T learning_rate)
+{
+   if (this->optimizer.type != optimizer_type::adam) return learning_rate;
+   auto* power = this->correction.data() + 2 * node;
+   power[0] *= this->optimizer.momentum;
+   power[1] *= this->optimizer.decay;
+   return learning_rate * std::sqrt(1 - power[1]) / (1 - power[0]);
+}
+
+/********************************************************************************
+* adjust: Justerar en enskild parameter samt dess moment med angiven
+*         gradient enligt vald optimerare. Anvnds fr bias samt fr glesa
+*         justeringar, dr endast enstaka vikter berrs.
+*
+*         - parameter: Referens till den parameter som skall justeras.
+*         - moment   : Pekare till parameterns frsta moment, annars nullptr.
+*         - stride   : Avstndet till parameterns andra moment (Adam).
+*         - gradient : Parameterns gradient.
+*         - rate     : Lrhastigheten, fr Adam inklusive biaskorrigering.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::adjust(T& parameter,
+                            T* moment,
+                            const std::size_t stride,
+                            const T gradient,
+                            const T rate) const
+{
+   const auto& optimizer = this->optimizer;
+
+   if (optimizer.type == optimizer_type::momentum)
+   {
+      moment[0] = optimizer.momentum * moment[0] + gradient;
+      parameter += rate * moment[0];
+   }
+   else if (optimizer.type == optimizer_type::rmsprop)
+   {
+      moment[0] = optimizer.decay * moment[0] + (1 - optimizer.decay) * gradient * gradient;
+      parameter += rate * gradient / (std::sqrt(moment[0]) + optimizer.epsilon);
+   }
+   else if (optimizer.type == optimizer_type::adam)
+   {
+      moment[0] = optimizer.momentum * moment[0] + (1 - optimizer.momentum) * gradient;
+      moment[stride] = optimizer.decay * moment[stride] + (1 - optimizer.decay) * gradient * gradient;
+      parameter += rate * moment[0] / (std::sqrt(moment[stride]) + optimizer.epsilon);
+   }
+   else
+   {
+      parameter += rate * gradient;
+   }
+
+   return;
+}
+
+/********************************************************************************
+* update: Justerar bias samt vikter fr angiven nod enligt vald optimerare,
+*         dr viktgradienten utgrs av scale * gradient[j]. Viktraden och
+*         dess moment justeras i en enda vektoriserad passage.
+*
+*         - node         : Index fr den nod som skall justeras.
+*         - scale        : Skalfaktor fr gradienterna.
+*         - gradient     : Pekare till viktgradienterna fre skalning,
+*                          exempelvis fregende lagers utdata.
+*         - bias_gradient: Gradienten fr nodens bias.
+*         - num_weights  : Antalet vikter som skall justeras.
+*         - learning_rate: Lrhastigheten fr justeringen.
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::update(const std::size_t node,
+                            const T scale,
+                            const T* gradient,
+                            const T bias_gradient,
+                            const std::size_t num_weights,
+                            const T learning_rate)
+{
+   const auto& optimizer = this->optimizer;
+   const auto moments = optimizer.num_moments();
+   const auto rate = this->step_rate(node, learning_rate);
+   auto* weights = this->weights[node];
+   auto* moment = moments > 0 ? this->state[node * moments] : nullptr;
+   this->adjust(this->bias[node], this->bias_state.data() + node * moments, 1, bias_gradient, rate);
+
+   if (optimizer.type == optimizer_type::momentum)
+   {
+      simd::momentum_update(scale, gradient, weights, moment, optimizer.momentum, rate, num_weights);
+   }
+   else if (optimizer.type == optimizer_type::rmsprop)
+   {
+      simd::rmsprop_update(scale, gradient, weights, moment, optimizer.decay, rate, optimizer.epsilon, num_weights);
+   }
+   else if (optimizer.type == optimizer_type::adam)
+   {
+      simd::adam_update(scale, gradient, weights, moment, moment + this->state.stride, optimizer.momentum,
+                        optimizer.decay, rate, optimizer.epsilon, num_weights);
+   }
+   else
+   {
+      simd::axpy(scale * rate, gradient, weights, num_weights);
    }
 
    return;
@@ -176,8 +1018,9 @@ void dense_layer::optimize(const std::vector<double>& input,
 *                     inom intervallet [-threshold, threshold] avrundas till
 *                     noll (default = 0.001).
 ********************************************************************************/
-void dense_layer::print(std::ostream& ostream,
-                        const double threshold)
+template <typename T>
+void dense_layer<T>::print(std::ostream& ostream,
+                           const double threshold)
 {
    ostream << "--------------------------------------------------------------------------------\n";
 
@@ -197,7 +1040,7 @@ void dense_layer::print(std::ostream& ostream,
    for (std::size_t i = 0; i < this->num_nodes(); ++i)
    {
       ostream << "Node " << i + 1 << ": ";
-      print_parameters(this->weights[i], ostream, threshold);
+      print_parameters(this->weights[i], this->num_weights(), ostream, threshold);
    }
 
    ostream << "--------------------------------------------------------------------------------\n\n";
@@ -220,22 +1063,155 @@ void dense_layer::print(std::ostream& ostream,
 *                                [-threshold, threshold] avrundas till noll
 *                                (default = 0.001).
 ********************************************************************************/
-void dense_layer::print_parameters(const std::vector<double>& data,
-                                   std::ostream& ostream, 
-                                   const double threshold)
+template <typename T>
+void dense_layer<T>::print_parameters(const std::vector<T>& data,
+                                      std::ostream& ostream, 
+                                      const double threshold)
 {
-   for (auto& i : data)
+   print_parameters(data.data(), data.size(), ostream, threshold);
+   return;
+}
+
+/********************************************************************************
+* print_parameters: Skriver ut angivet antal parametrar med start p angiven
+*                   adress p en enda rad via angiven utstrm. Anvnds fr
+*                   utskrift av enskilda rader i en matris.
+* 
+*                   - data     : Pekare till den frsta parametern.
+*                   - size     : Antalet parametrar som skall skrivas ut.
+*                   - ostream  : Angiven utstrm (default = std::cout).
+*                   - threshold: Trskelvrde nra noll, dr samtliga 
+*                                predikterade vrden inom intervallet 
+*                                [-threshold, threshold] avrundas till noll
+*                                (default = 0.001).
+********************************************************************************/
+template <typename T>
+void dense_layer<T>::print_parameters(const T* data,
+                                      const std::size_t size,
+                                      std::ostream& ostream, 
+                                      const double threshold)
+{
+   for (std::size_t i = 0; i < size; ++i)
    {
-      if (i < threshold && i > -threshold)
+      if (data[i] < threshold && data[i] > -threshold)
       {
          ostream << "0 ";
       }
       else
       {
-         ostream << i << " ";
+         ostream << data[i] << " ";
       }
    }
 
    ostream << "\n";
    return;
-}
\ No newline at end of file
+}
+
+/********************************************************************************
+* resize: Allokerar buffertar fr angiven batchstorlek i ett dense-lager med
+*         angivet antal noder samt vikter per nod. Om buffertarna redan har
+*         angiven storlek genomfrs ingen omallokering.
+*
+*         - batch_size : Maximalt antal trningsuppsttningar per batch.
+*         - num_nodes  : Antalet noder i dense-lagret.
+*         - num_weights: Antalet vikter per nod i dense-lagret.
+********************************************************************************/
+template <typename T>
+void dense_batch<T>::resize(const std::size_t batch_size,
+                            const std::size_t num_nodes,
+                            const std::size_t num_weights)
+{
+   if (this->output.rows != batch_size || this->output.cols != num_nodes)
+   {
+      this->output.resize(batch_size, num_nodes);
+      this->error.resize(batch_size, num_nodes);
+   }
+
+   if (this->weight_gradient.rows != num_nodes || this->weight_gradient.cols != num_weights)
+   {
+      this->weight_gradient.resize(num_nodes, num_weights);
+      this->bias_gradient.resize(1, num_nodes);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* add: Adderar gradienterna i angiven batch till angiven batchs gradienter,
+*      exempelvis fr att summera gradienter berknade av olika trdar innan
+*      de appliceras. Noderna kan delas upp i num_parts lika stora delar, dr
+*      endast gradienterna fr del part adderas, s att flera trdar kan
+*      summera var sin del.
+*
+*      - source   : Batch vars gradienter adderas.
+*      - part     : Index fr den del av noderna som skall adderas
+*                   (default = 0).
+*      - num_parts: Antalet delar som noderna delas upp i (default = 1).
+********************************************************************************/
+template <typename T>
+void dense_batch<T>::add(const dense_batch& source,
+                         const std::size_t part,
+                         const std::size_t num_parts)
+{
+   const auto num_nodes = this->weight_gradient.rows;
+   const auto first = num_nodes * part / num_parts;
+   const auto last = num_nodes * (part + 1) / num_parts;
+   if (first >= last) return;
+
+   simd::axpy(T(1), source.bias_gradient[0] + first, this->bias_gradient[0] + first, last - first);
+   simd::axpy(T(1), source.weight_gradient[first], this->weight_gradient[first], (last - first) * this->weight_gradient.stride);
+   return;
+}
+
+/********************************************************************************
+* attach: Placerar samtliga buffertar fr angiven batch i angivet minnesblock,
+*         som mste vara justerat till en cache-line och rymma minst
+*         arena_size element. Buffertarna placeras i ordningen utdata,
+*         avvikelser, viktgradienter och biasgradienter, dr varje buffert
+*         upptar ett helt antal cache-lines. Returnerar en pekare till frsta
+*         element efter buffertarna, dr nsta lagers buffertar kan placeras.
+*
+*         - arena      : Pekare till minnesblockets frsta lediga element.
+*         - batch_size : Maximalt antal trningsuppsttningar per batch.
+*         - num_nodes  : Antalet noder i dense-lagret.
+*         - num_weights: Antalet vikter per nod i dense-lagret.
+********************************************************************************/
+template <typename T>
+T* dense_batch<T>::attach(T* arena,
+                          const std::size_t batch_size,
+                          const std::size_t num_nodes,
+                          const std::size_t num_weights)
+{
+   this->output.attach(arena, batch_size, num_nodes);
+   arena += this->output.size();
+   this->error.attach(arena, batch_size, num_nodes);
+   arena += this->error.size();
+   this->weight_gradient.attach(arena, num_nodes, num_weights);
+   arena += this->weight_gradient.size();
+   this->bias_gradient.attach(arena, 1, num_nodes);
+   return arena + this->bias_gradient.size();
+}
+
+/********************************************************************************
+* arena_size: Returnerar antalet element som krvs fr att placera samtliga
+*             buffertar fr en batch av angiven storlek i ett minnesblock
+*             via attach.
+*
+*             - batch_size : Maximalt antal trningsuppsttningar per batch.
+*             - num_nodes  : Antalet noder i dense-lagret.
+*             - num_weights: Antalet vikter per nod i dense-lagret.
+********************************************************************************/
+template <typename T>
+std::size_t dense_batch<T>::arena_size(const std::size_t batch_size,
+                                       const std::size_t num_nodes,
+                                       const std::size_t num_weights)
+{
+   const auto nodes = matrix<T>::padded(num_nodes);
+   return 2 * batch_size * nodes + num_nodes * matrix<T>::padded(num_weights) + nodes;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template struct dense_batch<float>;
+template struct dense_batch<double>;
+template struct dense_layer<float>;
+template struct dense_layer<double>;
\ No newline at end of file
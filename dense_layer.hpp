@@ -2,7 +2,7 @@
 * dense_layer.hpp: Implementering av dense-lager fr dolda samt utgngslager
 *                  i neurala ntverk. Funktionalitet fr att genomfra
 *                  feedforward, backpropagation samt optimering via gradient
-*                  descent r implementerat. 
+*                  descent, momentum, RMSProp eller Adam r implementerat. 
 ********************************************************************************/
 #ifndef DENSE_LAYER_HPP_
 #define DENSE_LAYER_HPP_
@@ -10,46 +10,231 @@
 /* Inkluderingsdirektiv: */
 #include <iostream>
 #include <vector>
+#include "matrix.hpp"
+#include "rng.hpp"
+#include "sparse.hpp"
+
+/********************************************************************************
+* optimizer_type: Anger hur parametrarna i ett dense-lager justeras utifrn
+*                 gradienten g vid optimering.
+*
+*                 - sgd     : Gradient descent, dr parametrarna justeras med
+*                             gradienten skalad med lrhastigheten.
+*                 - momentum: Gradienterna summeras i en hastighet som avtar
+*                             med faktorn momentum, vilket dmpar
+*                             oscillationer och ger snabbare konvergens lngs
+*                             flacka riktningar.
+*                 - rmsprop : Gradienten normeras med roten ur ett glidande
+*                             medelvrde av kvadrerade gradienter, s att
+*                             varje parameter fr en egen steglngd.
+*                 - adam    : Kombination av momentum och RMSProp, dr bda
+*                             momenten biaskorrigeras under de frsta
+*                             justeringarna.
+********************************************************************************/
+enum class optimizer_type { sgd, momentum, rmsprop, adam };
+
+/********************************************************************************
+* optimizer_options: Instllningar fr optimeraren i ett dense-lager. Vid
+*                    initiering via optimeringsmetod stts decay till 0.9
+*                    fr RMSProp och 0.999 fr vriga metoder.
+********************************************************************************/
+template <typename T = double>
+struct optimizer_options
+{
+   /* Medlemmar: */
+   optimizer_type type = optimizer_type::sgd; /* Optimeringsmetod. */
+   T momentum = T(0.9);                       /* Andel av hastigheten (Adam: beta1) som behlls. */
+   T decay = T(0.999);                        /* Andel av medelvrdet av g^2 (Adam: beta2) som behlls. */
+   T epsilon = T(1e-8);                       /* Litet tal som frhindrar division med noll. */
+
+   /* Medlemsfunktioner: */
+   optimizer_options(const optimizer_type type = optimizer_type::sgd)
+      : type(type), decay(type == optimizer_type::rmsprop ? T(0.9) : T(0.999)) { }
+   std::size_t num_moments(void) const
+   {
+      if (this->type == optimizer_type::sgd) return 0;
+      return this->type == optimizer_type::adam ? 2 : 1;
+   }
+};
+
+/********************************************************************************
+* dense_batch: Strukt innehllande buffertar fr trning av ett dense-lager i
+*              minibatcher, dr varje rad i utdata samt avvikelser motsvarar
+*              en trningsuppsttning i batchen. Gradienter fr lagrets bias
+*              och vikter ackumuleras ver hela batchen innan de appliceras
+*              via dense_layer::optimize. Buffertarna allokeras antingen
+*              separat via resize eller i ett gemensamt minnesblock via
+*              attach, exempelvis fr samtliga lager i ett ntverk.
+********************************************************************************/
+template <typename T = double>
+struct dense_batch
+{
+   /* Medlemmar: */
+   matrix<T> output;          /* Nodernas utdata per trningsuppsttning. */
+   matrix<T> error;           /* Nodernas avvikelser per trningsuppsttning. */
+   matrix<T> weight_gradient; /* Ackumulerade gradienter fr vikterna. */
+   matrix<T> bias_gradient;   /* Ackumulerade gradienter fr bias (en rad). */
+
+   /* Medlemsfunktioner: */
+   dense_batch(void) { }
+   std::size_t batch_size(void) const { return this->output.rows; }
+
+   void resize(const std::size_t batch_size,
+               const std::size_t num_nodes,
+               const std::size_t num_weights);
+   void add(const dense_batch& source,
+            const std::size_t part = 0,
+            const std::size_t num_parts = 1);
+   T* attach(T* arena,
+             const std::size_t batch_size,
+             const std::size_t num_nodes,
+             const std::size_t num_weights);
+
+   static std::size_t arena_size(const std::size_t batch_size,
+                                 const std::size_t num_nodes,
+                                 const std::size_t num_weights);
+};
 
 /********************************************************************************
 * dense_layer: Strukt fr enkel implementering av dense-lager i neurala ntverk,
 *              dr antalet noder samt vikter per nod kan vljas utefter behov.
 *              Objekt av denna strukt kan med frdel anvndas fr dolda samt
-*              utgngslager i neurala ntverk.
+*              utgngslager i neurala ntverk. Samtliga parametrar utgrs av
+*              flyttal av typen T, dr float halverar minnestgngen och
+*              frdubblar antalet element per vektorinstruktion jmfrt med
+*              double. Indata kan ven passeras glest via sparse_row, varvid
+*              endast vikterna fr de indata som r skilda frn noll lses
+*              vid feedforward och justeras vid optimering. Nodernas summor
+*              fre aktivering kan ven berknas och uppdateras separat via
+*              preactivate samt update_preactivation, s att endast bidragen
+*              frn frndrade indata behver rknas om mellan anrop.
+*
+*              Parametrarna justeras via gradient descent om inget annat
+*              anges. Via set_optimizer kan momentum, RMSProp eller Adam
+*              vljas, varvid optimerarens tillstnd allokeras en gng i en
+*              matris med samma radavstnd som vikterna, dr nodens moment
+*              lagras i intilliggande rader. Varje viktrad justeras drefter
+*              tillsammans med sitt tillstnd i en enda vektoriserad passage.
+*              Biaskorrigeringen fr Adam rknas per nod, s att olika trdar
+*              kan justera var sin del av noderna oberoende av varandra.
 ********************************************************************************/
+template <typename T = double>
 struct dense_layer
 {
    /* Medlemmar: */
-   std::vector<double> output;               /* Nodernas utdata. */
-   std::vector<double> error;                /* Nodernas avvikelser. */
-   std::vector<double> bias;                 /* Nodernas vilovrden (m-vrden). */
-   std::vector<std::vector<double>> weights; /* Nodernas vikter (k-vrden). */
+   std::vector<T> output;          /* Nodernas utdata. */
+   std::vector<T> error;           /* Nodernas avvikelser. */
+   std::vector<T> bias;            /* Nodernas vilovrden (m-vrden). */
+   matrix<T> weights;              /* Nodernas vikter (k-vrden), en rad per nod. */
+   optimizer_options<T> optimizer; /* Optimerare fr lagrets parametrar. */
+   matrix<T> state;                /* Moment fr vikterna, num_moments rader per nod. */
+   std::vector<T> bias_state;      /* Moment fr bias, num_moments element per nod. */
+   std::vector<T> correction;      /* Potenserna beta1^t samt beta2^t per nod (Adam). */
+   std::vector<T> gradient;        /* Buffert fr glesa gradienter vid optimering med moment. */
 
    /* Medlemsfunktioner: */
    dense_layer(void) { }
    dense_layer(const std::size_t num_nodes,
                const std::size_t num_weights);
    std::size_t num_nodes(void) const { return this->output.size(); }
-   std::size_t num_weights(void) const { return this->weights[0].size(); }
+   std::size_t num_weights(void) const { return this->weights.cols; }
 
    void resize(const std::size_t num_nodes,
                const std::size_t num_weights);
+   void resize(const std::size_t num_nodes,
+               const std::size_t num_weights,
+               rng& generator);
+   void attach(const T* bias,
+               T* weights,
+               const std::size_t num_nodes,
+               const std::size_t num_weights);
    void clear(void);
+   void set_optimizer(const optimizer_options<T>& optimizer);
+   void reset_optimizer(void);
 
-   void feedforward(const std::vector<double>& input);
-   void backpropagate(const std::vector<double>& reference);
+   void feedforward(const std::vector<T>& input);
+   void feedforward(const T* input,
+                    const std::size_t num_inputs,
+                    T* output) const;
+   T backpropagate(const std::vector<T>& reference);
+   T backpropagate(const T* reference,
+                   const std::size_t num_references);
    void backpropagate(const dense_layer& next_layer);
-   void optimize(const std::vector<double>& input, const double learning_rate);
+   void backpropagate(dense_layer& next_layer,
+                      const T learning_rate);
+   void optimize(const std::vector<T>& input, const T learning_rate);
+   void optimize(const T* input,
+                 const std::size_t num_inputs,
+                 const T learning_rate);
+   void feedforward(const sparse_row<T>& input,
+                    T* output) const;
+   void optimize(const sparse_row<T>& input,
+                 const T learning_rate);
+   void preactivate(const T* input,
+                    const std::size_t num_inputs,
+                    T* sum) const;
+   void update_preactivation(const sparse_row<T>& delta,
+                             T* sum) const;
+   void activate(const T* sum,
+                 T* output) const;
+
+   void feedforward(const matrix<T>& input,
+                    const std::size_t num_samples,
+                    dense_batch<T>& batch) const;
+   void feedforward(const T* input,
+                    const std::size_t num_samples,
+                    const std::size_t num_inputs,
+                    const std::size_t input_stride,
+                    T* output,
+                    const std::size_t output_stride) const;
+   T backpropagate(const matrix<T>& reference,
+                   const std::size_t num_samples,
+                   dense_batch<T>& batch) const;
+   void backpropagate(const dense_layer& next_layer,
+                      const dense_batch<T>& next_batch,
+                      const std::size_t num_samples,
+                      dense_batch<T>& batch) const;
+   void accumulate(const matrix<T>& input,
+                   const std::size_t num_samples,
+                   dense_batch<T>& batch) const;
+   void optimize(const dense_batch<T>& batch,
+                 const std::size_t num_samples,
+                 const T learning_rate,
+                 const std::size_t part = 0,
+                 const std::size_t num_parts = 1);
+   void feedforward(const sparse_row<T>* input,
+                    const std::size_t num_samples,
+                    dense_batch<T>& batch) const;
+   void optimize(const sparse_row<T>* input,
+                 const std::size_t num_samples,
+                 const dense_batch<T>& batch,
+                 const T learning_rate);
 
    void print(std::ostream& ostream = std::cout, 
               const double threshold = 0.001);
-   static void print_parameters(const std::vector<double>& data,
+   static void print_parameters(const std::vector<T>& data,
+                                std::ostream& ostream = std::cout,
+                                const double threshold = 0.001);
+   static void print_parameters(const T* data,
+                                const std::size_t size,
                                 std::ostream& ostream = std::cout,
                                 const double threshold = 0.001);
 private:
-   static double get_random(void) { return std::rand() / static_cast<double>(RAND_MAX); }
-   static double relu(const double sum) { return sum > 0.0 ? sum : 0.0; }
-   static double delta_relu(const double output) { return output > 0.0 ? 1.0 : 0.0; }
+   static T relu(const T sum) { return sum > 0 ? sum : 0; }
+   static T delta_relu(const T output) { return output > 0 ? 1 : 0; }
+   T step_rate(const std::size_t node,
+               const T learning_rate);
+   void adjust(T& parameter,
+               T* moment,
+               const std::size_t stride,
+               const T gradient,
+               const T rate) const;
+   void update(const std::size_t node,
+               const T scale,
+               const T* gradient,
+               const T bias_gradient,
+               const std::size_t num_weights,
+               const T learning_rate);
 };
 
 #endif /* DENSE_LAYER_HPP_ */
\ No newline at end of file
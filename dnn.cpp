@@ -0,0 +1,323 @@
+/********************************************************************************
+* dnn.cpp: Definition av funktionsmedlemmar tillhrande strukten dnn fr
+*          implementering av neurala ntverk med godtyckligt antal lager.
+********************************************************************************/
+#include "dnn.hpp"
+
+#include <algorithm>
+#include <utility>
+
+/********************************************************************************
+* dnn: Initierar nytt neuralt ntverk med angiven topologi, dr bias och
+*      vikter i samtliga lager tilldelas randomiserade startvrden. Arenan
+*      allokeras en gng och delas upp i buffertar fr indata, drefter
+*      utdata, avvikelser samt gradienter fr respektive lager i tur och
+*      ordning och slutligen referensdata. En topologi med frre n tv lager
+*      ger ett tomt ntverk.
+*
+*      - topology  : Antalet noder i respektive lager, dr det frsta vrdet
+*                    utgr ingngslagret och det sista utgngslagret.
+*      - batch_size: Antalet trningsuppsttningar per minibatch, vilket
+*                    ven utgr antalet rader som behandlas t gngen vid
+*                    prediktion (default = 1).
+*      - seed      : Startvrde fr ntverkets slumptalsgenerator
+*                    (default = rng::default_seed).
+********************************************************************************/
+template <typename T>
+dnn<T>::dnn(const std::vector<std::size_t>& topology,
+            const std::size_t batch_size,
+            const std::uint64_t seed)
+   : generator(seed)
+{
+   if (topology.size() < 2) return;
+   const auto num_samples = std::max<std::size_t>(batch_size, 1);
+   auto size = num_samples * (matrix<T>::padded(topology.front()) + matrix<T>::padded(topology.back()));
+
+   for (std::size_t i = 1; i < topology.size(); ++i)
+   {
+      size += dense_batch<T>::arena_size(num_samples, topology[i], topology[i - 1]);
+   }
+
+   this->arena.assign(size, 0);
+   this->layers.resize(topology.size() - 1);
+   this->buffers.resize(topology.size() - 1);
+   auto* next = this->arena.data();
+
+   this->input.attach(next, num_samples, topology.front());
+   next += this->input.size();
+
+   for (std::size_t i = 1; i < topology.size(); ++i)
+   {
+      this->layers[i - 1].resize(topology[i], topology[i - 1], this->generator);
+      next = this->buffers[i - 1].attach(next, num_samples, topology[i], topology[i - 1]);
+   }
+
+   this->reference.attach(next, num_samples, topology.back());
+   return;
+}
+
+/********************************************************************************
+* set_training_data: Lser in trningsdata fr angivet neuralt ntverk via
+*                    passerade in- och utsignaler, som kopieras till ett
+*                    sammanhngande minnesblock.
+*
+*                    - train_in : Innehller indata fr trningsuppsttningar.
+*                    - train_out: Innehller utdata fr trningsuppsttningar.
+********************************************************************************/
+template <typename T>
+void dnn<T>::set_training_data(const std::vector<std::vector<T>>& train_in,
+                               const std::vector<std::vector<T>>& train_out)
+{
+   this->set_training_data(dataset<T>(train_in, train_out));
+   return;
+}
+
+/********************************************************************************
+* set_training_data: Tilldelar angivet neuralt ntverk angiven trningsdata.
+*                    Passeras datan via std::move vertas den utan kopiering.
+*
+*                    - train_data: Trningsdata fr ntverket.
+********************************************************************************/
+template <typename T>
+void dnn<T>::set_training_data(dataset<T> train_data)
+{
+   this->train_data = std::move(train_data);
+   this->train_order.resize(this->train_data.num_sets());
+
+   for (std::size_t i = 0; i < this->train_order.size(); ++i)
+   {
+      this->train_order[i] = i;
+   }
+
+   return;
+}
+
+/********************************************************************************
+* train: Trnar angivet neuralt ntverk med befintlig trningsdata under
+*        angivet antal epoker med angiven lrhastighet. Ordningen p
+*        trningsuppsttningarna randomiseras i brjan av varje epok,
+*        varefter ntverket trnas i minibatcher om batch_size uppsttningar,
+*        dr parametrarna justeras med medelvrdet av gradienterna.
+*
+*        - num_epochs   : Antalet epoker/omgngar som trning skall genomfras.
+*        - learning_rate: Lrhastigheten, som avgr hur stor andel av uppmtt
+*                         avvikelse som ntverkets parametrar justeras med.
+********************************************************************************/
+template <typename T>
+void dnn<T>::train(const std::size_t num_epochs,
+                   const T learning_rate)
+{
+   if (this->layers.empty()) return;
+
+   for (std::size_t i = 0; i < num_epochs; ++i)
+   {
+      this->shuffle();
+
+      for (std::size_t j = 0; j < this->num_sets(); j += this->batch_size())
+      {
+         const auto num_samples = std::min(this->batch_size(), this->num_sets() - j);
+         this->load_batch(j, num_samples);
+         this->optimize(num_samples, learning_rate);
+      }
+   }
+
+   return;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk fr angiven
+*          kombination av indata och returnerar en pekare till predikterad
+*          utdata, som ligger kvar i arenan till nsta prediktion eller
+*          trning.
+*
+*          - input: Vektor innehllande den kombination av indata som
+*                   prediktion skall ske utefter.
+********************************************************************************/
+template <typename T>
+const T* dnn<T>::predict(const std::vector<T>& input)
+{
+   const auto num_inputs = std::min(input.size(), this->num_inputs());
+   std::copy(input.begin(), input.begin() + num_inputs, this->input[0]);
+   std::fill(this->input[0] + num_inputs, this->input[0] + this->num_inputs(), 0);
+   this->feedforward(1);
+   return this->buffers.back().output[0];
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk fr samtliga rader
+*          i en radvis lagrad indatamatris och skriver predikterad utdata
+*          radvis till angiven utdatamatris. Raderna behandlas i block om
+*          batch_size rader via arenan.
+*
+*          - input     : Pekare till indatamatrisen, som innehller
+*                        num_rows x num_inputs element.
+*          - num_rows  : Antalet rader i in- och utdatamatrisen.
+*          - num_inputs: Antalet element per rad i indatamatrisen.
+*          - output    : Pekare till utdatamatrisen, med plats fr
+*                        num_rows x num_outputs() element.
+********************************************************************************/
+template <typename T>
+void dnn<T>::predict(const T* input,
+                     const std::size_t num_rows,
+                     const std::size_t num_inputs,
+                     T* output)
+{
+   const auto num_values = std::min(num_inputs, this->num_inputs());
+
+   for (std::size_t first = 0; first < num_rows && !this->layers.empty(); first += this->batch_size())
+   {
+      const auto num_samples = std::min(this->batch_size(), num_rows - first);
+
+      for (std::size_t s = 0; s < num_samples; ++s)
+      {
+         const auto* row = input + (first + s) * num_inputs;
+         std::copy(row, row + num_values, this->input[s]);
+         std::fill(this->input[s] + num_values, this->input[s] + this->num_inputs(), 0);
+      }
+
+      this->feedforward(num_samples);
+
+      for (std::size_t s = 0; s < num_samples; ++s)
+      {
+         const auto* result = this->buffers.back().output[s];
+         std::copy(result, result + this->num_outputs(), output + (first + s) * this->num_outputs());
+      }
+   }
+
+   return;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk via indata frn
+*          samtliga befintliga trningsuppsttningar och skriver varje
+*          kombination av indata samt motsvarande predikterad utdata via
+*          angiven utstrm p samma format som fr strukten ann.
+*
+*          - ostream  : Angiven utstrm (default = std::cout).
+*          - threshold: Trskelvrde nra noll, dr samtliga predikterade
+*                       vrden inom intervallet [-threshold, threshold]
+*                       avrundas till noll (default = 0.001).
+********************************************************************************/
+template <typename T>
+void dnn<T>::predict(std::ostream& ostream,
+                     const double threshold)
+{
+   const auto& data = this->train_data;
+   ostream << "--------------------------------------------------------------------------------\n";
+
+   for (std::size_t i = 0; i < data.num_sets() && !this->layers.empty(); ++i)
+   {
+      const std::vector<T> input(data.input(i), data.input(i) + data.num_inputs());
+      const auto* prediction = this->predict(input);
+      ostream << "Input: ";
+      dense_layer<T>::print_parameters(input, ostream, threshold);
+
+      ostream << "Output: ";
+      dense_layer<T>::print_parameters(prediction, this->num_outputs(), ostream, threshold);
+      if (i + 1 < data.num_sets()) ostream << "\n";
+   }
+
+   ostream << "--------------------------------------------------------------------------------\n\n";
+   return;
+}
+
+/********************************************************************************
+* shuffle: Randomiserar den inbrdes ordningen p trningsuppsttningarna fr
+*          angivet neuralt ntverk p samma stt som fr strukten ann.
+********************************************************************************/
+template <typename T>
+void dnn<T>::shuffle(void)
+{
+   this->generator.shuffle(this->train_order.data(), this->train_order.size());
+   return;
+}
+
+/********************************************************************************
+* load_batch: Kopierar in- och referensdata fr de trningsuppsttningar som
+*             terfinns p index [first, first + num_samples) i aktuell
+*             ordningsfljd till arenan. Rader kortare n ntverkets in-
+*             respektive utgngslager fylls ut med nollor.
+*
+*             first      : Frsta index i ordningsfljden som ingr i batchen.
+*             num_samples: Antalet trningsuppsttningar i batchen.
+********************************************************************************/
+template <typename T>
+void dnn<T>::load_batch(const std::size_t first,
+                        const std::size_t num_samples)
+{
+   const auto num_inputs = std::min(this->train_data.num_inputs(), this->num_inputs());
+   const auto num_references = std::min(this->train_data.num_outputs(), this->num_outputs());
+
+   for (std::size_t s = 0; s < num_samples; ++s)
+   {
+      const auto k = this->train_order[first + s];
+      const auto* input = this->train_data.input(k);
+      const auto* reference = this->train_data.output(k);
+
+      std::copy(input, input + num_inputs, this->input[s]);
+      std::fill(this->input[s] + num_inputs, this->input[s] + this->num_inputs(), 0);
+      std::copy(reference, reference + num_references, this->reference[s]);
+      std::fill(this->reference[s] + num_references, this->reference[s] + this->num_outputs(), 0);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* feedforward: Berknar utdata fr samtliga lager fr de frsta num_samples
+*              raderna i arenans indata, dr varje lager lser fregende
+*              lagers utdata direkt ur arenan.
+*
+*              num_samples: Antalet rader som skall berknas.
+********************************************************************************/
+template <typename T>
+void dnn<T>::feedforward(const std::size_t num_samples)
+{
+   const auto* input = &this->input;
+
+   for (std::size_t i = 0; i < this->num_layers(); ++i)
+   {
+      this->layers[i].feedforward(*input, num_samples, this->buffers[i]);
+      input = &this->buffers[i].output;
+   }
+
+   return;
+}
+
+/********************************************************************************
+* optimize: Genomfr feedforward och backpropagation genom samtliga lager fr
+*           aktuell batch i arenan, ackumulerar gradienterna och justerar
+*           drefter samtliga lagers parametrar med medelvrdet av
+*           gradienterna. Avvikelserna berknas frn utgngslagret bakt
+*           innan ngra parametrar justeras.
+*
+*           num_samples  : Antalet trningsuppsttningar i batchen.
+*           learning_rate: Lrhastigheten, som avgr hur mycket ntverkets
+*                          parametrar justeras vid fel.
+********************************************************************************/
+template <typename T>
+void dnn<T>::optimize(const std::size_t num_samples,
+                      const T learning_rate)
+{
+   const auto last = this->num_layers() - 1;
+   this->feedforward(num_samples);
+   this->layers[last].backpropagate(this->reference, num_samples, this->buffers[last]);
+
+   for (auto i = last; i-- > 0;)
+   {
+      this->layers[i].backpropagate(this->layers[i + 1], this->buffers[i + 1], num_samples, this->buffers[i]);
+   }
+
+   for (std::size_t i = 0; i < this->num_layers(); ++i)
+   {
+      const auto& input = i > 0 ? this->buffers[i - 1].output : this->input;
+      this->layers[i].accumulate(input, num_samples, this->buffers[i]);
+      this->layers[i].optimize(this->buffers[i], num_samples, learning_rate);
+   }
+
+   return;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template struct dnn<float>;
+template struct dnn<double>;
@@ -0,0 +1,83 @@
+/********************************************************************************
+* dnn.hpp: Implementering av djupa neurala ntverk via strukten dnn
+*          (DNN = Deep Neural Network), som till skillnad frn strukten ann
+*          kan innehlla ett godtyckligt antal dolda lager.
+********************************************************************************/
+#ifndef DNN_HPP_
+#define DNN_HPP_
+
+/* Inkluderingsdirektiv: */
+#include "dataset.hpp"
+#include "dense_layer.hpp"
+#include "rng.hpp"
+
+/********************************************************************************
+* dnn: Strukt fr neurala ntverk med ett ingngslager fljt av valfritt antal
+*      dense-lager, dr det sista lagret utgr utgngslager. Topologin anges
+*      vid initiering som antalet noder i respektive lager, exempelvis
+*      dnn network({ 784, 256, 128, 10 }), dr det frsta vrdet utgr
+*      antalet noder i ingngslagret.
+*
+*      Utdata, avvikelser samt gradienter fr samtliga lager lagras lager fr
+*      lager i ett enda sammanhngande minnesblock (arena), som allokeras
+*      vid initiering och rymmer en batch av angiven storlek. Trning och
+*      prediktion sker drmed utan minnesallokering, och bde feedforward
+*      och backpropagation lser buffertarna sekventiellt i minnet. Lagren
+*      innehller endast parametrarna (bias och vikter).
+*
+*      Eftersom buffertarna pekar in i ntverkets egen arena kan ntverket
+*      flyttas men inte kopieras.
+********************************************************************************/
+template <typename T = double>
+struct dnn
+{
+   /* Medlemmar: */
+   std::vector<dense_layer<T>> layers;         /* Dense-lager, dr det sista utgr utgngslager. */
+   std::vector<dense_batch<T>> buffers;        /* Buffertar fr respektive lager i arenan. */
+   matrix<T> input;                            /* Indata fr aktuell batch i arenan. */
+   matrix<T> reference;                        /* Referensdata fr aktuell batch i arenan. */
+   std::vector<T, aligned_allocator<T>> arena; /* Minnesblock fr samtliga buffertar. */
+   dataset<T> train_data;                      /* In- och utdata fr trningsuppsttningar. */
+   std::vector<std::size_t> train_order;       /* Ordningsfljd fr trningsuppsttningar. */
+   rng generator;                              /* Slumptalsgenerator fr startvrden och ordningsfljd. */
+
+   /* Medlemsfunktioner: */
+   dnn(void) { }
+   dnn(const std::vector<std::size_t>& topology,
+       const std::size_t batch_size = 1,
+       const std::uint64_t seed = rng::default_seed);
+   dnn(const dnn&) = delete;
+   dnn(dnn&&) = default;
+   dnn& operator=(const dnn&) = delete;
+   dnn& operator=(dnn&&) = default;
+
+   std::size_t num_layers(void) const { return this->layers.size(); }
+   std::size_t num_inputs(void) const { return this->input.cols; }
+   std::size_t num_outputs(void) const { return this->reference.cols; }
+   std::size_t num_sets(void) const { return this->train_order.size(); }
+   std::size_t batch_size(void) const { return this->input.rows; }
+   void seed(const std::uint64_t seed) { this->generator = rng(seed); }
+
+   void set_training_data(const std::vector<std::vector<T>>& train_in,
+                          const std::vector<std::vector<T>>& train_out);
+   void set_training_data(dataset<T> train_data);
+   void train(const std::size_t num_epochs,
+              const T learning_rate);
+   const T* predict(const std::vector<T>& input);
+   void predict(const T* input,
+                const std::size_t num_rows,
+                const std::size_t num_inputs,
+                T* output);
+   void predict(std::ostream& ostream = std::cout,
+                const double threshold = 0.001);
+
+private:
+   void shuffle(void);
+   void load_batch(const std::size_t first,
+                   const std::size_t num_samples);
+   void feedforward(const std::size_t num_samples);
+   void optimize(const std::size_t num_samples,
+                 const T learning_rate);
+};
+
+#endif /* DNN_HPP_ */
@@ -0,0 +1,660 @@
+/********************************************************************************
+* inference_server.cpp: Definition av funktionsmedlemmar tillhrande
+*                       strukterna bounded_queue, inference_server samt
+*                       socket_frontend fr prediktion i mikrobatcher.
+********************************************************************************/
+#include "inference_server.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define INFERENCE_SERVER_SOCKET 1
+#endif
+
+namespace
+{
+#ifdef INFERENCE_SERVER_SOCKET
+/********************************************************************************
+* receive: Lser angivet antal byte frn angiven socket. Returnerar false om
+*          anslutningen stngdes eller om ett fel uppstod innan samtliga
+*          byte hade lsts.
+*
+*          - connection: Socket som data lses frn.
+*          - data      : Pekare till buffert dr datan lagras.
+*          - size      : Antalet byte som skall lsas.
+********************************************************************************/
+bool receive(const int connection,
+             void* data,
+             std::size_t size)
+{
+   auto* destination = static_cast<char*>(data);
+
+   while (size > 0)
+   {
+      const auto count = ::recv(connection, destination, size, 0);
+
+      if (count < 0 && errno == EINTR) continue;
+      if (count <= 0) return false;
+      destination += count;
+      size -= static_cast<std::size_t>(count);
+   }
+
+   return true;
+}
+
+/********************************************************************************
+* send: Skriver angivet antal byte till angiven socket. Returnerar false om
+*       ett fel uppstod, exempelvis om klienten har stngt anslutningen.
+*
+*       - connection: Socket som data skrivs till.
+*       - data      : Pekare till den data som skall skrivas.
+*       - size      : Antalet byte som skall skrivas.
+********************************************************************************/
+bool send(const int connection,
+          const void* data,
+          std::size_t size)
+{
+#ifdef MSG_NOSIGNAL
+   constexpr int flags = MSG_NOSIGNAL;
+#else
+   constexpr int flags = 0;
+#endif
+   const auto* source = static_cast<const char*>(data);
+
+   while (size > 0)
+   {
+      const auto count = ::send(connection, source, size, flags);
+
+      if (count < 0 && errno == EINTR) continue;
+      if (count <= 0) return false;
+      source += count;
+      size -= static_cast<std::size_t>(count);
+   }
+
+   return true;
+}
+#endif /* INFERENCE_SERVER_SOCKET */
+}
+
+/********************************************************************************
+* bounded_queue: Initierar ny k med plats fr minst angivet antal element,
+*                dr kapaciteten avrundas uppt till en tvpotens. Plats i
+*                tilldelas sekvensnumret i, vilket anger att den r ledig fr
+*                skrivning nummer i.
+*
+*                - capacity: Minsta antal element som kn skall rymma.
+********************************************************************************/
+template <typename T>
+bounded_queue<T>::bounded_queue(const std::size_t capacity)
+{
+   std::size_t size = 2;
+
+   while (size < capacity)
+   {
+      size *= 2;
+   }
+
+   this->slots.reset(new slot[size]);
+   this->mask = size - 1;
+
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      this->slots[i].sequence.store(i, std::memory_order_relaxed);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* push: Lgger angivet element sist i kn. Platsen reserveras genom att
+*       skrivpositionen rknas upp via compare-and-swap, varefter elementet
+*       flyttas in och platsens sekvensnummer stts till position + 1, vilket
+*       publicerar elementet fr lsning. Returnerar false utan att elementet
+*       flyttas om kn r full.
+*
+*       - value: Elementet som skall lggas i kn.
+********************************************************************************/
+template <typename T>
+bool bounded_queue<T>::push(T&& value)
+{
+   auto position = this->head.load(std::memory_order_relaxed);
+
+   while (true)
+   {
+      auto& slot = this->slots[position & this->mask];
+      const auto sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+
+      if (difference == 0)
+      {
+         if (this->head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+         {
+            slot.value = std::move(value);
+            slot.sequence.store(position + 1, std::memory_order_release);
+            return true;
+         }
+      }
+      else if (difference < 0)
+      {
+         return false;
+      }
+      else
+      {
+         position = this->head.load(std::memory_order_relaxed);
+      }
+   }
+}
+
+/********************************************************************************
+* pop: Flyttar det frsta elementet i kn till angiven referens. Platsen
+*      reserveras genom att lspositionen rknas upp via compare-and-swap,
+*      varefter elementet flyttas ut och platsens sekvensnummer rknas upp
+*      ett varv, vilket frigr platsen fr nsta skrivning. Returnerar false
+*      om kn r tom.
+*
+*      - value: Referens dit elementet flyttas.
+********************************************************************************/
+template <typename T>
+bool bounded_queue<T>::pop(T& value)
+{
+   auto position = this->tail.load(std::memory_order_relaxed);
+
+   while (true)
+   {
+      auto& slot = this->slots[position & this->mask];
+      const auto sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+
+      if (difference == 0)
+      {
+         if (this->tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+         {
+            value = std::move(slot.value);
+            slot.sequence.store(position + this->mask + 1, std::memory_order_release);
+            return true;
+         }
+      }
+      else if (difference < 0)
+      {
+         return false;
+      }
+      else
+      {
+         position = this->tail.load(std::memory_order_relaxed);
+      }
+   }
+}
+
+/********************************************************************************
+* inference_server: Startar ny tjnst fr prediktion med angivet ntverk och
+*                   angivna instllningar, dr arbetstrdarna startas direkt.
+*
+*                   - network: Ntverk som anvnds fr prediktion.
+*                   - options: Tjnstens instllningar (default = standard-
+*                              instllningar enligt server_options).
+********************************************************************************/
+template <typename T>
+inference_server<T>::inference_server(const ann<T>& network,
+                                      const server_options& options)
+   : network(&network), options(options), queue(options.queue_size)
+{
+   this->start();
+   return;
+}
+
+/********************************************************************************
+* inference_server: Startar ny tjnst fr prediktion med den version av
+*                   ntverket som fr tillfllet r publicerad via angivet
+*                   handtag, dr arbetstrdarna startas direkt. Nya versioner
+*                   som publiceras via handtaget anvnds frn och med nsta
+*                   mikrobatch.
+*
+*                   - model  : Handtag till ntverket som anvnds fr
+*                              prediktion.
+*                   - options: Tjnstens instllningar (default = standard-
+*                              instllningar enligt server_options).
+********************************************************************************/
+template <typename T>
+inference_server<T>::inference_server(const model_handle<T>& model,
+                                      const server_options& options)
+   : model(&model), options(options), queue(options.queue_size)
+{
+   this->start();
+   return;
+}
+
+/********************************************************************************
+* start: Startar angivet antal arbetstrdar, dr 0 innebr en trd per
+*        processorkrna.
+********************************************************************************/
+template <typename T>
+void inference_server<T>::start(void)
+{
+   const auto hardware_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+   const auto thread_count = this->options.num_threads > 0 ? this->options.num_threads : hardware_threads;
+   this->options.max_batch = std::max<std::size_t>(this->options.max_batch, 1);
+   this->running = true;
+
+   for (std::size_t t = 0; t < thread_count; ++t)
+   {
+      this->workers.emplace_back(&inference_server::run, this);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* submit: Lmnar in en frfrgan om prediktion fr angiven indata och
+*         returnerar en future, som uppfylls med ntverkets utdata nr
+*         frfrgan har besvarats. Om tjnsten har stoppats avvisas
+*         frfrgan, varvid anrop av get fr returnerad future kastar
+*         std::future_error (broken_promise).
+*
+*         - input: Indata, ett vrde per nod i ingngslagret.
+********************************************************************************/
+template <typename T>
+std::future<std::vector<T>> inference_server<T>::submit(std::vector<T> input)
+{
+   inference_request<T> request;
+   request.input = std::move(input);
+   request.arrival = std::chrono::steady_clock::now();
+   auto result = request.result.get_future();
+   this->enqueue(std::move(request));
+   return result;
+}
+
+/********************************************************************************
+* submit: Lmnar in en frfrgan om prediktion fr angiven indata, dr angiven
+*         callback anropas frn en arbetstrd med en pekare till utdatan
+*         samt antalet utdata nr frfrgan har besvarats. Pekaren r endast
+*         giltig under anropet. Returnerar false om tjnsten har stoppats,
+*         varvid callback aldrig anropas.
+*
+*         - input: Indata, ett vrde per nod i ingngslagret.
+*         - done : Funktion som anropas med utdatan.
+********************************************************************************/
+template <typename T>
+bool inference_server<T>::submit(std::vector<T> input,
+                                 callback done)
+{
+   inference_request<T> request;
+   request.input = std::move(input);
+   request.callback = std::move(done);
+   request.arrival = std::chrono::steady_clock::now();
+   return this->enqueue(std::move(request));
+}
+
+/********************************************************************************
+* stop: Slutar ta emot frfrgningar och vntar tills arbetstrdarna har
+*       besvarat samtliga frfrgningar i kn och avslutats. Inlmningar som
+*       redan har pbrjats slutfrs och besvaras, eftersom arbetstrdarna
+*       inte avslutas frrn antalet pgende inlmningar r noll.
+********************************************************************************/
+template <typename T>
+void inference_server<T>::stop(void)
+{
+   this->running = false;
+
+   {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->condition.notify_all();
+   }
+
+   for (auto& i : this->workers)
+   {
+      i.join();
+   }
+
+   this->workers.clear();
+   return;
+}
+
+/********************************************************************************
+* stats: Returnerar antalet besvarade frfrgningar samt genomfrda
+*        mikrobatcher sedan tjnsten startades.
+********************************************************************************/
+template <typename T>
+server_stats inference_server<T>::stats(void) const
+{
+   server_stats stats;
+   stats.num_requests = this->num_requests.load();
+   stats.num_batches = this->num_batches.load();
+   return stats;
+}
+
+/********************************************************************************
+* enqueue: Lgger angiven frfrgan i kn och vcker en sovande arbetstrd,
+*          om ngon sover. Om kn r full vntar anropet tills plats
+*          frigrs. Antalet pgende inlmningar rknas upp innan tjnstens
+*          status kontrolleras, s att stop inte kan avsluta arbetstrdarna
+*          mellan kontrollen och att frfrgan lggs i kn. Returnerar false
+*          om tjnsten har stoppats, varvid frfrgan lmnas orrd.
+*
+*          - request: Frfrgan som skall lggas i kn.
+********************************************************************************/
+template <typename T>
+bool inference_server<T>::enqueue(inference_request<T>&& request)
+{
+   ++this->num_submitting;
+
+   if (!this->running)
+   {
+      --this->num_submitting;
+      return false;
+   }
+
+   while (!this->queue.push(std::move(request)))
+   {
+      std::this_thread::yield();
+   }
+
+   if (this->num_idle > 0)
+   {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->condition.notify_one();
+   }
+
+   --this->num_submitting;
+   return true;
+}
+
+/********************************************************************************
+* run: Arbetstrdarnas huvudloop. Den frsta frfrgan i varje mikrobatch
+*      hmtas frn kn, varefter ytterligare frfrgningar hmtas tills
+*      batchen r full eller den frsta frfrgan har vntat i max_delay.
+*      Indatan kopieras radvis till en matris, varefter feedforward
+*      genomfrs fr hela batchen via lagrens batchfunktioner och varje
+*      frfrgan besvaras med sin rad i utdatan. Indata som r kortare n
+*      ntverkets ingngslager fylls ut med nollor. Vid ett handtag hmtas
+*      aktuell version av ntverket en gng per mikrobatch och slpps direkt
+*      efter feedforward, varvid buffertarna anpassas om den nya versionen
+*      har andra dimensioner. Nr kn r tom sover trden tills en ny frfrgan
+*      lmnas in. Trden avslutas nr tjnsten har stoppats, inga inlmningar
+*      pgr och kn r tom.
+********************************************************************************/
+template <typename T>
+void inference_server<T>::run(void)
+{
+   const auto max_batch = this->options.max_batch;
+   std::vector<inference_request<T>> batch(max_batch);
+   matrix<T> input, hidden, output;
+
+   while (true)
+   {
+      if (!this->queue.pop(batch[0]))
+      {
+         if (!this->running && this->num_submitting == 0 && this->queue.empty()) return;
+         this->wait();
+         continue;
+      }
+
+      const auto deadline = batch[0].arrival + this->options.max_delay;
+      std::size_t num_samples = 1;
+
+      while (num_samples < max_batch)
+      {
+         if (this->queue.pop(batch[num_samples])) ++num_samples;
+         else if (!this->running || std::chrono::steady_clock::now() >= deadline) break;
+         else std::this_thread::yield();
+      }
+
+      auto model = this->acquire();
+      const auto& network = *model;
+      const auto num_inputs = network.num_inputs();
+      const auto num_outputs = network.num_outputs();
+
+      if (input.rows != max_batch || input.cols != num_inputs) input.resize(max_batch, num_inputs);
+      if (hidden.rows != max_batch || hidden.cols != network.num_hidden()) hidden.resize(max_batch, network.num_hidden());
+      if (output.rows != max_batch || output.cols != num_outputs) output.resize(max_batch, num_outputs);
+
+      for (std::size_t s = 0; s < num_samples; ++s)
+      {
+         const auto& values = batch[s].input;
+         const auto count = std::min(values.size(), num_inputs);
+         std::copy(values.begin(), values.begin() + count, input[s]);
+         std::fill(input[s] + count, input[s] + num_inputs, 0);
+      }
+
+      network.hidden_layer.feedforward(input[0], num_samples, num_inputs, input.stride, hidden[0], hidden.stride);
+      network.output_layer.feedforward(hidden[0], num_samples, hidden.cols, hidden.stride, output[0], output.stride);
+      model.release();
+      this->num_requests += num_samples;
+      ++this->num_batches;
+
+      for (std::size_t s = 0; s < num_samples; ++s)
+      {
+         auto& request = batch[s];
+
+         if (request.callback)
+         {
+            request.callback(output[s], num_outputs);
+         }
+         else
+         {
+            request.result.set_value(std::vector<T>(output[s], output[s] + num_outputs));
+         }
+
+         request = inference_request<T>();
+      }
+   }
+}
+
+/********************************************************************************
+* wait: Lter anropande arbetstrd sova tills en frfrgan har lmnats in
+*       eller tjnsten har stoppats. Antalet sovande trdar rknas upp under
+*       lset innan kn kontrolleras, s att en frfrgan som lmnas in
+*       drefter alltid vcker trden. Trden vcks ven efter en kort
+*       tidsgrns som skydd.
+********************************************************************************/
+template <typename T>
+void inference_server<T>::wait(void)
+{
+   std::unique_lock<std::mutex> lock(this->mutex);
+   ++this->num_idle;
+   this->condition.wait_for(lock, std::chrono::milliseconds(10),
+                            [this] { return !this->queue.empty() || !this->running; });
+   --this->num_idle;
+   return;
+}
+
+/********************************************************************************
+* open: Skapar en Unix-socket p angiven skvg och brjar ta emot
+*       anslutningar i en egen trd. En eventuell befintlig fil p skvgen
+*       tas bort frst. Returnerar true om socketen kunde skapas.
+*
+*       - path: Skvg till socketen.
+********************************************************************************/
+template <typename T>
+bool socket_frontend<T>::open(const std::string& path)
+{
+#ifdef INFERENCE_SERVER_SOCKET
+   this->close();
+   sockaddr_un address{};
+   address.sun_family = AF_UNIX;
+   if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+   std::copy(path.begin(), path.end(), address.sun_path);
+
+   this->listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+   if (this->listener < 0) return false;
+   ::unlink(path.c_str());
+
+   if (::bind(this->listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+       ::listen(this->listener, SOMAXCONN) != 0)
+   {
+      ::close(this->listener);
+      this->listener = -1;
+      return false;
+   }
+
+   this->path = path;
+   this->running = true;
+   this->acceptor = std::thread(&socket_frontend::accept, this);
+   return true;
+#else
+   (void)path;
+   return false;
+#endif /* INFERENCE_SERVER_SOCKET */
+}
+
+/********************************************************************************
+* close: Slutar ta emot anslutningar, stnger samtliga ppna anslutningar och
+*        vntar tills deras trdar har avslutats, varefter socketen tas bort.
+*        Frfrgningar som redan har lmnats in till tjnsten besvaras, men
+*        svaren skickas inte till klienten.
+********************************************************************************/
+template <typename T>
+void socket_frontend<T>::close(void)
+{
+#ifdef INFERENCE_SERVER_SOCKET
+   if (this->listener < 0) return;
+   this->running = false;
+   ::shutdown(this->listener, SHUT_RDWR);
+   this->acceptor.join();
+   ::close(this->listener);
+   ::unlink(this->path.c_str());
+   this->listener = -1;
+
+   std::vector<std::thread> connections;
+
+   {
+      std::lock_guard<std::mutex> lock(this->mutex);
+
+      for (const auto i : this->sockets)
+      {
+         ::shutdown(i, SHUT_RDWR);
+      }
+
+      connections.swap(this->connections);
+      this->finished.clear();
+   }
+
+   for (auto& i : connections)
+   {
+      i.join();
+   }
+#endif /* INFERENCE_SERVER_SOCKET */
+   return;
+}
+
+/********************************************************************************
+* accept: Tar emot nya anslutningar tills close anropas och startar en trd
+*         per anslutning. Trdar fr anslutningar som har stngts sedan
+*         fregende anslutning vntas frst in, s att antalet trdar inte
+*         vxer med antalet betjnade klienter.
+********************************************************************************/
+template <typename T>
+void socket_frontend<T>::accept(void)
+{
+#ifdef INFERENCE_SERVER_SOCKET
+   while (this->running)
+   {
+      const auto connection = ::accept(this->listener, nullptr, nullptr);
+
+      if (connection < 0)
+      {
+         if (errno == EINTR || errno == ECONNABORTED) continue;
+         return;
+      }
+
+      std::lock_guard<std::mutex> lock(this->mutex);
+
+      if (!this->running)
+      {
+         ::close(connection);
+         return;
+      }
+
+      this->reap();
+      this->sockets.push_back(connection);
+      this->connections.emplace_back(&socket_frontend::serve, this, connection);
+   }
+#endif /* INFERENCE_SERVER_SOCKET */
+   return;
+}
+
+/********************************************************************************
+* serve: Skickar socket_header till klienten och besvarar drefter
+*        frfrgningar frn angiven anslutning i tur och ordning tills
+*        klienten stnger anslutningen, tjnsten stoppas eller close
+*        anropas. Anslutningen stngs drefter och trden registreras som
+*        avslutad, s att den kan vntas in via reap. Om en ny version av
+*        ntverket med frre utgngsnoder har publicerats fylls svaret ut
+*        med nollor, s att det alltid motsvarar socket_header.
+*
+*        - connection: Anslutning till klienten.
+********************************************************************************/
+template <typename T>
+void socket_frontend<T>::serve(const int connection)
+{
+#ifdef INFERENCE_SERVER_SOCKET
+   const auto num_inputs = this->server->num_inputs();
+   const auto num_outputs = this->server->num_outputs();
+   const socket_header header{ sizeof(T), static_cast<std::uint32_t>(num_inputs),
+                               static_cast<std::uint32_t>(num_outputs), 0 };
+   std::vector<T> input(num_inputs);
+
+   if (send(connection, &header, sizeof(header)) && num_inputs > 0)
+   {
+      while (receive(connection, input.data(), num_inputs * sizeof(T)))
+      {
+         auto result = this->server->submit(input);
+         std::vector<T> output;
+
+         try
+         {
+            output = result.get();
+         }
+         catch (const std::future_error&)
+         {
+            break;
+         }
+
+         output.resize(num_outputs, 0);
+         if (!send(connection, output.data(), num_outputs * sizeof(T))) break;
+      }
+   }
+
+   std::lock_guard<std::mutex> lock(this->mutex);
+   this->sockets.erase(std::remove(this->sockets.begin(), this->sockets.end(), connection), this->sockets.end());
+   this->finished.push_back(std::this_thread::get_id());
+   ::close(connection);
+#else
+   (void)connection;
+#endif /* INFERENCE_SERVER_SOCKET */
+   return;
+}
+
+/********************************************************************************
+* reap: Vntar in och tar bort trdarna fr samtliga anslutningar som har
+*       registrerats som avslutade. Anropas med mutexen lst. Eftersom en
+*       trd registreras som avslutad sist under lset terstr endast att
+*       trden returnerar, vilket medfr att vntan r kortvarig.
+********************************************************************************/
+template <typename T>
+void socket_frontend<T>::reap(void)
+{
+   for (const auto id : this->finished)
+   {
+      const auto thread = std::find_if(this->connections.begin(), this->connections.end(),
+                                       [id](const std::thread& i) { return i.get_id() == id; });
+      if (thread == this->connections.end()) continue;
+      thread->join();
+      this->connections.erase(thread);
+   }
+
+   this->finished.clear();
+   return;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template struct bounded_queue<inference_request<float>>;
+template struct bounded_queue<inference_request<double>>;
+template struct inference_server<float>;
+template struct inference_server<double>;
+template struct socket_frontend<float>;
+template struct socket_frontend<double>;
@@ -0,0 +1,247 @@
+/********************************************************************************
+* inference_server.hpp: Tjnst fr prediktion med ett trnat neuralt ntverk
+*                       av typen ann, dr frfrgningar frn mnga trdar
+*                       samlas i mikrobatcher. Varje frfrgan bestr av en
+*                       enskild uppsttning indata, men i stllet fr att
+*                       varje frfrgan genomfr en egen matris-vektorprodukt
+*                       genomfrs en matris-matrisprodukt per mikrobatch, dr
+*                       varje vikt teranvnds fr samtliga frfrgningar i
+*                       batchen. Frfrgningar lmnas in via en lsfri k och
+*                       besvaras via std::future eller en callback. Via
+*                       socket_frontend kan tjnsten ven ns lokalt via en
+*                       Unix-socket, exempelvis vid benchmarking.
+********************************************************************************/
+#ifndef INFERENCE_SERVER_HPP_
+#define INFERENCE_SERVER_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ann.hpp"
+#include "model_handle.hpp"
+
+/********************************************************************************
+* bounded_queue: Lsfri k med fast kapacitet fr flera producenter och flera
+*                konsumenter. Varje plats har ett sekvensnummer som anger om
+*                platsen r ledig fr nsta skrivning eller innehller ett
+*                element fr nsta lsning, vilket medfr att producenter och
+*                konsumenter endast synkroniseras via atomra operationer p
+*                kns tv positioner samt platsens sekvensnummer. Kapaciteten
+*                avrundas uppt till en tvpotens.
+********************************************************************************/
+template <typename T>
+struct bounded_queue
+{
+   /****************************************************************************
+   * slot: Plats i kn, dr sekvensnumret avgr om platsen r ledig eller
+   *       innehller ett element.
+   ****************************************************************************/
+   struct slot
+   {
+      std::atomic<std::size_t> sequence{ 0 }; /* Sekvensnummer fr platsen. */
+      T value;                                /* Lagrat element. */
+   };
+
+   /* Medlemmar: */
+   std::unique_ptr<slot[]> slots;                  /* Kns platser. */
+   std::size_t mask = 0;                           /* Kapaciteten minus ett, fr indexering. */
+   alignas(64) std::atomic<std::size_t> head{ 0 }; /* Position fr nsta skrivning. */
+   alignas(64) std::atomic<std::size_t> tail{ 0 }; /* Position fr nsta lsning. */
+
+   /* Medlemsfunktioner: */
+   explicit bounded_queue(const std::size_t capacity);
+   bounded_queue(const bounded_queue&) = delete;
+   bounded_queue& operator=(const bounded_queue&) = delete;
+
+   std::size_t capacity(void) const { return this->mask + 1; }
+   bool empty(void) const { return this->head.load() == this->tail.load(); }
+   bool push(T&& value);
+   bool pop(T& value);
+};
+
+/********************************************************************************
+* inference_request: Frfrgan om prediktion fr en enskild uppsttning
+*                    indata, som besvaras antingen via ett lfte (promise)
+*                    eller via en callback om en sdan har angivits.
+********************************************************************************/
+template <typename T = double>
+struct inference_request
+{
+   /* Medlemmar: */
+   std::vector<T> input;                                /* Indata fr frfrgan. */
+   std::promise<std::vector<T>> result;                 /* Lfte som uppfylls med utdata. */
+   std::function<void(const T*, std::size_t)> callback; /* Anropas med utdata, annars tom. */
+   std::chrono::steady_clock::time_point arrival;       /* Tidpunkt d frfrgan lmnades in. */
+};
+
+/********************************************************************************
+* server_options: Instllningar fr en inference_server. En mikrobatch
+*                 skickas vidare s snart den innehller max_batch
+*                 frfrgningar eller nr den ldsta frfrgan har vntat i
+*                 max_delay, beroende p vilket som intrffar frst.
+********************************************************************************/
+struct server_options
+{
+   /* Medlemmar: */
+   std::size_t max_batch = 32;                 /* Strsta antal frfrgningar per mikrobatch. */
+   std::chrono::microseconds max_delay{ 200 }; /* Lngsta vntan p fler frfrgningar. */
+   std::size_t num_threads = 1;                /* Antalet arbetstrdar, 0 = en per processorkrna. */
+   std::size_t queue_size = 4096;              /* Kns kapacitet i antal frfrgningar. */
+};
+
+/********************************************************************************
+* server_stats: Rknare fr en inference_server.
+********************************************************************************/
+struct server_stats
+{
+   /* Medlemmar: */
+   std::uint64_t num_requests = 0; /* Antalet besvarade frfrgningar. */
+   std::uint64_t num_batches = 0;  /* Antalet genomfrda mikrobatcher. */
+
+   /* Medlemsfunktioner: */
+   double mean_batch_size(void) const
+   {
+      return this->num_batches > 0 ? static_cast<double>(this->num_requests) / this->num_batches : 0;
+   }
+};
+
+/********************************************************************************
+* inference_server: Tjnst fr prediktion med angivet ntverk, dr
+*                   frfrgningar lmnas in via submit frn valfritt antal
+*                   trdar. Varje arbetstrd hmtar frfrgningar frn kn
+*                   tills mikrobatchen r full eller tidsgrnsen fr den
+*                   ldsta frfrgan har passerats, genomfr feedforward fr
+*                   hela batchen som matrisprodukter via lagrens
+*                   batchfunktioner och besvarar drefter varje frfrgan.
+*                   Arbetstrdarnas buffertar allokeras en gng vid start.
+*                   Lediga arbetstrdar sover och vcks endast nr en
+*                   frfrgan lmnas in medan ngon trd sover, s att
+*                   inlmning normalt sker utan ls.
+*
+*                   Ntverket modifieras inte och mste finnas kvar s lnge
+*                   tjnsten krs. Om tjnsten i stllet skapas med en
+*                   model_handle hmtas aktuell version av ntverket en gng
+*                   per mikrobatch, s att en ny version kan publiceras utan
+*                   att tjnsten stoppas eller prediktionerna vntar p ls.
+*                   Handtaget mste d innehlla en publicerad version. Vid
+*                   stop besvaras samtliga frfrgningar som redan har
+*                   lmnats in innan arbetstrdarna avslutas, medan
+*                   frfrgningar som lmnas in drefter avvisas.
+********************************************************************************/
+template <typename T = double>
+struct inference_server
+{
+   /* Typdefinitioner: */
+   using callback = std::function<void(const T*, std::size_t)>;
+
+   /* Medlemmar: */
+   const ann<T>* network = nullptr;              /* Ntverk som anvnds fr prediktion. */
+   const model_handle<T>* model = nullptr;       /* Handtag till utbytbart ntverk, annars nullptr. */
+   server_options options;                       /* Tjnstens instllningar. */
+   bounded_queue<inference_request<T>> queue;    /* K fr inlmnade frfrgningar. */
+   std::vector<std::thread> workers;             /* Arbetstrdar. */
+   std::atomic<bool> running{ false };           /* Indikerar att frfrgningar tas emot. */
+   std::atomic<std::size_t> num_submitting{ 0 }; /* Antalet pgende inlmningar. */
+   std::atomic<std::size_t> num_idle{ 0 };       /* Antalet sovande arbetstrdar. */
+   std::atomic<std::uint64_t> num_requests{ 0 }; /* Antalet besvarade frfrgningar. */
+   std::atomic<std::uint64_t> num_batches{ 0 };  /* Antalet genomfrda mikrobatcher. */
+   std::mutex mutex;                             /* Mutex fr att vcka sovande arbetstrdar. */
+   std::condition_variable condition;            /* Villkor som sovande arbetstrdar vntar p. */
+
+   /* Medlemsfunktioner: */
+   explicit inference_server(const ann<T>& network,
+                             const server_options& options = server_options());
+   explicit inference_server(const model_handle<T>& model,
+                             const server_options& options = server_options());
+   inference_server(const inference_server&) = delete;
+   inference_server& operator=(const inference_server&) = delete;
+   ~inference_server(void) { this->stop(); }
+
+   std::size_t num_inputs(void) const { return this->acquire()->num_inputs(); }
+   std::size_t num_outputs(void) const { return this->acquire()->num_outputs(); }
+   bool is_running(void) const { return this->running.load(); }
+
+   std::future<std::vector<T>> submit(std::vector<T> input);
+   bool submit(std::vector<T> input,
+               callback done);
+   void stop(void);
+   server_stats stats(void) const;
+
+private:
+   typename model_handle<T>::reader acquire(void) const
+   {
+      return this->model ? this->model->acquire() : typename model_handle<T>::reader(*this->network);
+   }
+
+   void start(void);
+   bool enqueue(inference_request<T>&& request);
+   void run(void);
+   void wait(void);
+};
+
+/********************************************************************************
+* socket_header: Huvud som skickas till klienten nr en anslutning till en
+*                socket_frontend har upprttats, s att klienten vet hur
+*                stora frfrgningar och svar r.
+********************************************************************************/
+struct socket_header
+{
+   std::uint32_t value_size;  /* Antalet byte per vrde (4 = float, 8 = double). */
+   std::uint32_t num_inputs;  /* Antalet vrden per frfrgan. */
+   std::uint32_t num_outputs; /* Antalet vrden per svar. */
+   std::uint32_t reserved;    /* Reserverad, stts till 0. */
+};
+
+/********************************************************************************
+* socket_frontend: Lokal front end fr en inference_server via en
+*                  Unix-socket. Efter socket_header skickar klienten
+*                  frfrgningar bestende av num_inputs vrden av typen T i
+*                  processorns egen byteordning och erhller fr varje
+*                  frfrgan ett svar bestende av num_outputs vrden. Varje
+*                  anslutning hanteras av en egen trd, dr frfrgningarna
+*                  besvaras i tur och ordning, vilket medfr att samtidiga
+*                  frfrgningar krver flera anslutningar. Trdar fr
+*                  stngda anslutningar vntas in vid nsta anslutning, s
+*                  att endast trdar fr ppna anslutningar ligger kvar. Stds
+*                  endast p plattformar med Unix-socketar, annars misslyckas
+*                  open.
+********************************************************************************/
+template <typename T = double>
+struct socket_frontend
+{
+   /* Medlemmar: */
+   inference_server<T>* server = nullptr; /* Tjnst som frfrgningarna lmnas in till. */
+   std::string path;                      /* Skvg till socketen. */
+   int listener = -1;                     /* Lyssnande socket, annars -1. */
+   std::thread acceptor;                  /* Trd som tar emot nya anslutningar. */
+   std::vector<std::thread> connections;  /* En trd per anslutning. */
+   std::vector<std::thread::id> finished; /* Avslutade trdar som nnu inte har vntats in. */
+   std::vector<int> sockets;              /* ppna anslutningar. */
+   std::mutex mutex;                      /* Skyddar connections, finished och sockets. */
+   std::atomic<bool> running{ false };    /* Indikerar att anslutningar tas emot. */
+
+   /* Medlemsfunktioner: */
+   explicit socket_frontend(inference_server<T>& server) : server(&server) { }
+   socket_frontend(const socket_frontend&) = delete;
+   socket_frontend& operator=(const socket_frontend&) = delete;
+   ~socket_frontend(void) { this->close(); }
+
+   bool open(const std::string& path);
+   void close(void);
+
+private:
+   void accept(void);
+   void serve(const int connection);
+   void reap(void);
+};
+
+#endif /* INFERENCE_SERVER_HPP_ */
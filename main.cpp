@@ -4,13 +4,19 @@
 *
 *           Kompilera programmet med GCC-kompilatorn och skapa en krbar fil
 *           dpt main.exe via fljande kommando:
-*           $ g++ main.cpp dense_layer.cpp ann.cpp -o main.exe -Wall
+*           $ g++ main.cpp ann.cpp data_stream.cpp dataset.cpp dense_layer.cpp mapped_file.cpp matrix.cpp profile.cpp rng.cpp simd.cpp -o main.exe -Wall -O2 -pthread
 *
 *           I Windows, kr sedan programmet via fljande kommando.
 *           $ main.exe
 *
 *           I Linux, kr programmet via fljande kommando:
 *           $ ./main.exe
+*
+*           Alternativt kan programmet, tillsammans med biblioteket samt
+*           benchmarkprogrammet, byggas via CMake enligt fljande:
+*           $ cmake -S . -B build
+*           $ cmake --build build
+*           $ ./build/main
 ********************************************************************************/
 #include "ann.hpp"
 
@@ -25,9 +31,12 @@
 *       1 1 0
 * 
 *       Trningsdata lagras via var sin vektor och passeras till det neurala
-*       ntverket innan trning. Trning genomfrs sedan under 10 000 epoker
-*       med en lrhastighet p 1 %. Efter trning predikterar det neurala
-*       ntverket angivet mnster med 100 % precision.
+*       ntverket innan trning. Trning genomfrs sedan under hgst 10 000
+*       epoker med en lrhastighet p 5 %, men avbryts s snart genomsnittlig
+*       kvadrerad avvikelse understiger 0.001, vilket normalt sker efter ngra
+*       hundra epoker, eller om avvikelsen inte har minskat under 1000 epoker.
+*       Efter trning skrivs en sammanfattning av trningen ut, varefter det
+*       neurala ntverket predikterar angivet mnster med 100 % precision.
 ********************************************************************************/
 int main(void)
 {
@@ -47,9 +56,15 @@ int main(void)
       { 0 } 
    };
    
+   train_options options;
+   options.num_epochs = 10000;
+   options.learning_rate = 0.05;
+   options.target_loss = 0.001;
+   options.patience = 1000;
+
    ann ann1(2, 3, 1);
    ann1.set_training_data(train_in, train_out);
-   ann1.train(10000, 0.01);
+   ann1.train(options).print();
    ann1.predict();
    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+/********************************************************************************
+* mapped_file.cpp: Definition av funktionsmedlemmar tillhrande strukten
+*                  mapped_file fr minnesmappade filer.
+********************************************************************************/
+#include "mapped_file.hpp"
+
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP 1
+#endif
+
+/********************************************************************************
+* mapped_file: Initierar ny mappning genom att verta angiven mappning, som
+*              drefter r stngd.
+*
+*              - source: Den mappning som vertas.
+********************************************************************************/
+mapped_file::mapped_file(mapped_file&& source) noexcept
+{
+   *this = std::move(source);
+   return;
+}
+
+/********************************************************************************
+* operator=: Stnger eventuell befintlig mappning och vertar angiven
+*            mappning, som drefter r stngd.
+*
+*            - source: Den mappning som vertas.
+********************************************************************************/
+mapped_file& mapped_file::operator=(mapped_file&& source) noexcept
+{
+   if (this == &source) return *this;
+   this->close();
+   this->address = source.address;
+   this->length = source.length;
+   this->copy = std::move(source.copy);
+   source.address = nullptr;
+   source.length = 0;
+   source.copy.clear();
+   return *this;
+}
+
+/********************************************************************************
+* open: Mappar angiven fil i sin helhet, dr det mappade minnet alltid r
+*       justerat till minst en cache-line. Vid skrivbar mappning kan minnet
+*       modifieras via copy-on-write, utan att filen pverkas. Returnerar true
+*       om mappningen lyckades. Tomma filer kan inte mappas.
+*
+*       - filename: Skvg till filen som skall mappas.
+*       - writable: Indikerar ifall det mappade minnet skall vara skrivbart
+*                   (default = false).
+********************************************************************************/
+bool mapped_file::open(const std::string& filename,
+                       const bool writable)
+{
+   this->close();
+
+#ifdef MAPPED_FILE_MMAP
+   const auto fd = ::open(filename.c_str(), O_RDONLY);
+   if (fd < 0) return false;
+
+   struct stat info{};
+   if (fstat(fd, &info) != 0 || info.st_size <= 0)
+   {
+      ::close(fd);
+      return false;
+   }
+
+   const auto length = static_cast<std::size_t>(info.st_size);
+   const auto protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+   auto* address = mmap(nullptr, length, protection, MAP_PRIVATE, fd, 0);
+   ::close(fd);
+   if (address == MAP_FAILED) return false;
+
+   this->address = address;
+   this->length = length;
+#else
+   (void)writable;
+   std::ifstream file(filename, std::ios::binary | std::ios::ate);
+   if (!file) return false;
+
+   const auto length = static_cast<std::size_t>(file.tellg());
+   if (length == 0) return false;
+   this->copy.resize(length);
+   file.seekg(0);
+
+   if (!file.read(this->copy.data(), length))
+   {
+      this->copy.clear();
+      return false;
+   }
+
+   this->address = this->copy.data();
+   this->length = length;
+#endif
+   return true;
+}
+
+/********************************************************************************
+* close: Tar bort eventuell mappning.
+********************************************************************************/
+void mapped_file::close(void)
+{
+#ifdef MAPPED_FILE_MMAP
+   if (this->address) munmap(this->address, this->length);
+#endif
+   this->address = nullptr;
+   this->length = 0;
+   this->copy.clear();
+   return;
+}
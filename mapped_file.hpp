@@ -0,0 +1,47 @@
+/********************************************************************************
+* mapped_file.hpp: Implementering av minnesmappade filer, vars innehll kan
+*                  anvndas direkt frn operativsystemets sidcache utan
+*                  kopiering. Flera processer som mappar samma fil delar
+*                  drmed samma fysiska minnessidor. P system utan std fr
+*                  POSIX mmap lses filen i stllet in till ett justerat
+*                  minnesblock med samma grnssnitt.
+********************************************************************************/
+#ifndef MAPPED_FILE_HPP_
+#define MAPPED_FILE_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <string>
+#include "matrix.hpp"
+
+/********************************************************************************
+* mapped_file: Strukt fr en minnesmappad fil. Filen mappas privat, vilket
+*              innebr att eventuella skrivningar via copy-on-write endast
+*              pverkar den egna processen och aldrig skrivs tillbaka till
+*              filen. Mappningen tas bort nr objektet raderas.
+********************************************************************************/
+struct mapped_file
+{
+   /* Medlemmar: */
+   void* address = nullptr;                         /* Brjan av mappat minne. */
+   std::size_t length = 0;                          /* Filens storlek i byte. */
+   std::vector<char, aligned_allocator<char>> copy; /* Filens innehll d mmap saknas. */
+
+   /* Medlemsfunktioner: */
+   mapped_file(void) { }
+   mapped_file(const mapped_file&) = delete;
+   mapped_file(mapped_file&& source) noexcept;
+   mapped_file& operator=(const mapped_file&) = delete;
+   mapped_file& operator=(mapped_file&& source) noexcept;
+   ~mapped_file(void) { this->close(); }
+
+   bool is_open(void) const { return this->address != nullptr; }
+   std::size_t size(void) const { return this->length; }
+   char* data(void) { return static_cast<char*>(this->address); }
+   const char* data(void) const { return static_cast<const char*>(this->address); }
+
+   bool open(const std::string& filename,
+             const bool writable = false);
+   void close(void);
+};
+
+#endif /* MAPPED_FILE_HPP_ */
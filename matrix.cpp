@@ -0,0 +1,163 @@
+/********************************************************************************
+* matrix.cpp: Definition av funktionsmedlemmar tillhrande strukten matrix
+*             fr radvis lagrade matriser i ett sammanhngande minnesblock.
+********************************************************************************/
+#include "matrix.hpp"
+
+#include <utility>
+
+/********************************************************************************
+* matrix: Initierar ny matris med angivet antal rader och kolumner, dr
+*         samtliga element stts till 0.
+*
+*         - rows: Antalet rader i den nya matrisen.
+*         - cols: Antalet kolumner per rad i den nya matrisen.
+********************************************************************************/
+template <typename T>
+matrix<T>::matrix(const std::size_t rows,
+                  const std::size_t cols)
+{
+   this->resize(rows, cols);
+   return;
+}
+
+/********************************************************************************
+* matrix: Initierar ny matris som en kopia av angiven matris. Elementen
+*         kopieras till egen vektor, ven om kllan r kopplad till externt
+*         minne.
+*
+*         - source: Den matris som skall kopieras.
+********************************************************************************/
+template <typename T>
+matrix<T>::matrix(const matrix& source)
+{
+   *this = source;
+   return;
+}
+
+/********************************************************************************
+* matrix: Initierar ny matris genom att verta innehllet i angiven matris,
+*         inklusive eventuell koppling till externt minne.
+*
+*         - source: Den matris vars innehll vertas.
+********************************************************************************/
+template <typename T>
+matrix<T>::matrix(matrix&& source) noexcept
+{
+   *this = std::move(source);
+   return;
+}
+
+/********************************************************************************
+* operator=: Erstter innehllet i angiven matris med en kopia av angiven
+*            klla, vars element kopieras till egen vektor.
+*
+*            - source: Den matris som skall kopieras.
+********************************************************************************/
+template <typename T>
+matrix<T>& matrix<T>::operator=(const matrix& source)
+{
+   if (this == &source) return *this;
+   this->data.assign(source.elements(), source.elements() + source.size());
+   this->view = nullptr;
+   this->rows = source.rows;
+   this->cols = source.cols;
+   this->stride = source.stride;
+   return *this;
+}
+
+/********************************************************************************
+* operator=: Erstter innehllet i angiven matris genom att verta innehllet
+*            i angiven klla, som drefter r tom.
+*
+*            - source: Den matris vars innehll vertas.
+********************************************************************************/
+template <typename T>
+matrix<T>& matrix<T>::operator=(matrix&& source) noexcept
+{
+   if (this == &source) return *this;
+   this->data = std::move(source.data);
+   this->view = source.view;
+   this->rows = source.rows;
+   this->cols = source.cols;
+   this->stride = source.stride;
+   source.clear();
+   return *this;
+}
+
+/********************************************************************************
+* resize: Allokerar om angiven matris till angivet antal rader och kolumner,
+*         dr samtliga element inklusive utfyllnad stts till 0. Eventuellt
+*         tidigare innehll raderas innan omallokering genomfrs.
+*
+*         - rows: Nytt antal rader efter omallokering.
+*         - cols: Nytt antal kolumner per rad efter omallokering.
+********************************************************************************/
+template <typename T>
+void matrix<T>::resize(const std::size_t rows,
+                       const std::size_t cols)
+{
+   this->clear();
+   this->rows = rows;
+   this->cols = cols;
+   this->stride = padded(cols);
+   this->data.resize(rows * this->stride, 0);
+   return;
+}
+
+/********************************************************************************
+* attach: Kopplar angiven matris till externt minne innehllande angivet
+*         antal rader och kolumner, lagrade med samma layout som matrisens
+*         egen vektor, dvs. varje rad utfylld till en multipel av en
+*         cache-line. Minnet anvnds direkt utan kopiering och mste finnas
+*         kvar s lnge matrisen anvnds. Eventuellt tidigare innehll raderas.
+*
+*         - view: Pekare till det externa minnets frsta element, justerad
+*                 till en cache-line.
+*         - rows: Antalet rader i det externa minnet.
+*         - cols: Antalet anvnda kolumner per rad i det externa minnet.
+********************************************************************************/
+template <typename T>
+void matrix<T>::attach(T* view,
+                       const std::size_t rows,
+                       const std::size_t cols)
+{
+   this->clear();
+   this->view = view;
+   this->rows = rows;
+   this->cols = cols;
+   this->stride = padded(cols);
+   return;
+}
+
+/********************************************************************************
+* clear: Nollstller angiven matris, vilket innebr att matrisen sedan inte
+*        innehller ngra rader.
+********************************************************************************/
+template <typename T>
+void matrix<T>::clear(void)
+{
+   this->data.clear();
+   this->view = nullptr;
+   this->rows = 0;
+   this->cols = 0;
+   this->stride = 0;
+   return;
+}
+
+/********************************************************************************
+* padded: Returnerar antalet element per rad efter utfyllnad av angivet antal
+*         kolumner till nrmaste multipel av en cache-line (64 byte).
+*
+*         - cols: Antalet anvnda kolumner per rad.
+********************************************************************************/
+template <typename T>
+std::size_t matrix<T>::padded(const std::size_t cols)
+{
+   constexpr std::size_t line = 64 / sizeof(T);
+   return (cols + line - 1) / line * line;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template struct matrix<float>;
+template struct matrix<double>;
\ No newline at end of file
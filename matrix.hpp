@@ -0,0 +1,96 @@
+/********************************************************************************
+* matrix.hpp: Implementering av radvis lagrade matriser i ett enda
+*             sammanhngande minnesblock, dr varje rad r justerad till en
+*             egen cache-line. Anvnds fr lagring av vikter i dense-lager,
+*             s att samtliga rader kan lsas sekventiellt utan att flja
+*             pekare mellan separata heap-allokeringar.
+********************************************************************************/
+#ifndef MATRIX_HPP_
+#define MATRIX_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/********************************************************************************
+* aligned_allocator: Allokator fr std::vector, som justerar allokerat minne
+*                    till angiven grns (default = 64 byte, vilket motsvarar
+*                    en cache-line p vanliga x86- och ARM-processorer).
+********************************************************************************/
+template <typename T, std::size_t Alignment = 64>
+struct aligned_allocator
+{
+   using value_type = T;
+   template <typename U> struct rebind { using other = aligned_allocator<U, Alignment>; };
+
+   aligned_allocator(void) { }
+   template <typename U> aligned_allocator(const aligned_allocator<U, Alignment>&) { }
+
+   T* allocate(const std::size_t size)
+   {
+      return static_cast<T*>(::operator new(size * sizeof(T), std::align_val_t{ Alignment }));
+   }
+
+   void deallocate(T* data, const std::size_t)
+   {
+      ::operator delete(data, std::align_val_t{ Alignment });
+      return;
+   }
+
+   template <typename U> bool operator==(const aligned_allocator<U, Alignment>&) const { return true; }
+   template <typename U> bool operator!=(const aligned_allocator<U, Alignment>&) const { return false; }
+};
+
+/********************************************************************************
+* matrix: Strukt fr radvis lagrade matriser i ett enda sammanhngande och
+*         cache-linjejusterat minnesblock. Varje rad fylls ut med nollor till
+*         en multipel av en cache-line, vilket innebr att varje rad brjar
+*         p en justerad adress. Rad i ns via operator[], som returnerar en
+*         pekare till radens frsta element, s att element kan ns via
+*         matrix[i][j] precis som fr en tvdimensionell vektor. Elementen
+*         utgrs av flyttal av typen T (float eller double).
+*
+*         Elementen lagras normalt i matrisens egen vektor, men matrisen kan
+*         ven kopplas till externt minne med samma layout via attach,
+*         exempelvis en minnesmappad fil, som d anvnds direkt utan
+*         kopiering. Vid kopiering av en sdan matris kopieras elementen
+*         alltid till egen vektor.
+********************************************************************************/
+template <typename T = double>
+struct matrix
+{
+   /* Medlemmar: */
+   std::vector<T, aligned_allocator<T>> data; /* Matrisens element inklusive utfyllnad. */
+   T* view = nullptr;                         /* Pekare till externt minne, annars nullptr. */
+   std::size_t rows = 0;                      /* Antalet rader. */
+   std::size_t cols = 0;                      /* Antalet anvnda kolumner per rad. */
+   std::size_t stride = 0;                    /* Antalet element per rad inklusive utfyllnad. */
+
+   /* Medlemsfunktioner: */
+   matrix(void) { }
+   matrix(const std::size_t rows,
+          const std::size_t cols);
+   matrix(const matrix& source);
+   matrix(matrix&& source) noexcept;
+   matrix& operator=(const matrix& source);
+   matrix& operator=(matrix&& source) noexcept;
+
+   void resize(const std::size_t rows,
+               const std::size_t cols);
+   void attach(T* view,
+               const std::size_t rows,
+               const std::size_t cols);
+   void clear(void);
+   bool is_view(void) const { return this->view != nullptr; }
+   std::size_t size(void) const { return this->rows * this->stride; }
+
+   T* elements(void) { return this->view ? this->view : this->data.data(); }
+   const T* elements(void) const { return this->view ? this->view : this->data.data(); }
+   T* operator[](const std::size_t row) { return this->elements() + row * this->stride; }
+   const T* operator[](const std::size_t row) const { return this->elements() + row * this->stride; }
+
+   static std::size_t padded(const std::size_t cols);
+};
+
+#endif /* MATRIX_HPP_ */
\ No newline at end of file
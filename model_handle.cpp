@@ -0,0 +1,191 @@
+/********************************************************************************
+* model_handle.cpp: Definition av funktionsmedlemmar tillhrande strukten
+*                   model_handle fr utbyte av neurala ntverk medan
+*                   prediktion pgr.
+********************************************************************************/
+#include "model_handle.hpp"
+
+#include <thread>
+#include <utility>
+
+namespace
+{
+/********************************************************************************
+* copy_parameters: Kopierar bias samt vikter frn ett dense-lager till ett
+*                  annat, dr vikterna kopieras ven om kllan refererar till
+*                  externt minne. Optimerarens tillstnd kopieras inte.
+*
+*                  - source     : Det dense-lager som parametrarna kopieras
+*                                 frn.
+*                  - destination: Det dense-lager som parametrarna kopieras
+*                                 till.
+********************************************************************************/
+template <typename T>
+void copy_parameters(const dense_layer<T>& source,
+                     dense_layer<T>& destination)
+{
+   destination.output.assign(source.num_nodes(), 0);
+   destination.error.assign(source.num_nodes(), 0);
+   destination.bias = source.bias;
+   destination.weights = source.weights;
+   return;
+}
+}
+
+/********************************************************************************
+* reader: Hmtar en lsreferens till aktuell version av angivet handtag.
+*         Referensen rknas frst i rknaren fr den epok som lstes, varefter
+*         epoken lses igen. Om epoken har ndrats har en publicering hunnit
+*         byta rknare, varvid rkningen ngras och grs om i den nya epoken.
+*         Frst drefter hmtas pekaren till aktuell version, vilket medfr
+*         att en publicering som byter ut versionen alltid vntar p
+*         referensen innan versionen frigrs.
+*
+*         - handle: Det handtag som versionen hmtas frn.
+********************************************************************************/
+template <typename T>
+model_handle<T>::reader::reader(const model_handle& handle)
+   : handle(&handle)
+{
+   while (true)
+   {
+      const auto epoch = handle.epoch.load();
+      auto& counter = handle.readers(epoch & 1);
+      ++counter;
+
+      if (handle.epoch.load() == epoch)
+      {
+         this->parity = epoch & 1;
+         break;
+      }
+
+      --counter;
+   }
+
+   this->network = handle.current.load();
+   return;
+}
+
+/********************************************************************************
+* operator=: Slpper eventuell befintlig referens och vertar drefter
+*            angiven referens, som sedan r tom.
+*
+*            - source: Den referens som vertas.
+********************************************************************************/
+template <typename T>
+typename model_handle<T>::reader& model_handle<T>::reader::operator=(reader&& source) noexcept
+{
+   if (this == &source) return *this;
+   this->release();
+   this->handle = source.handle;
+   this->network = source.network;
+   this->parity = source.parity;
+   source.handle = nullptr;
+   source.network = nullptr;
+   return *this;
+}
+
+/********************************************************************************
+* release: Slpper referensen, varefter den refererade versionen kan frigras
+*          av en pgende eller kommande publicering.
+********************************************************************************/
+template <typename T>
+void model_handle<T>::reader::release(void)
+{
+   if (this->handle) --this->handle->readers(this->parity);
+   this->handle = nullptr;
+   this->network = nullptr;
+   return;
+}
+
+/********************************************************************************
+* model_handle: Initierar nytt handtag med angivet ntverk som frsta version.
+*
+*               - network: Det ntverk som publiceras.
+********************************************************************************/
+template <typename T>
+model_handle<T>::model_handle(std::unique_ptr<ann<T>> network)
+{
+   this->publish(std::move(network));
+   return;
+}
+
+/********************************************************************************
+* publish: Publicerar angivet ntverk som ny version och returnerar dess
+*          versionsnummer, dr den frsta versionen har nummer 1. Pekaren
+*          byts frst ut atomrt, s att nya lsare hmtar den nya versionen.
+*          Drefter rknas epoken upp och anropet vntar tills samtliga
+*          lsare i den tidigare epoken har slppt sina referenser, varefter
+*          den tidigare versionen frigrs. Lsare i den nya epoken kan endast
+*          ha hmtat den nya versionen och behver drmed inte invntas.
+*
+*          - network: Det ntverk som publiceras, som drefter gs av
+*                     handtaget och inte fr modifieras.
+********************************************************************************/
+template <typename T>
+std::uint64_t model_handle<T>::publish(std::unique_ptr<ann<T>> network)
+{
+   std::lock_guard<std::mutex> lock(this->writer);
+   const auto* previous = this->current.exchange(network.release());
+   const auto epoch = this->epoch.load();
+   this->epoch.store(epoch + 1);
+
+   while (this->readers(epoch & 1).load() > 0)
+   {
+      std::this_thread::yield();
+   }
+
+   delete previous;
+   return ++this->num_versions;
+}
+
+/********************************************************************************
+* publish: Publicerar en kopia av parametrarna i angivet ntverk som ny
+*          version och returnerar dess versionsnummer, se snapshot. Angivet
+*          ntverk kan drefter trnas vidare utan att publicerad version
+*          pverkas, exempelvis vid kontinuerlig trning i bakgrunden.
+*
+*          - network: Det ntverk vars parametrar publiceras.
+********************************************************************************/
+template <typename T>
+std::uint64_t model_handle<T>::publish(const ann<T>& network)
+{
+   return this->publish(snapshot(network));
+}
+
+/********************************************************************************
+* load: Lser in en modellfil sparad via ann::save och publicerar den som ny
+*       version. Returnerar false om filen inte kunde lsas in, varvid
+*       aktuell version behlls.
+*
+*       - filename: Skvg till modellfilen.
+********************************************************************************/
+template <typename T>
+bool model_handle<T>::load(const std::string& filename)
+{
+   auto network = std::make_unique<ann<T>>();
+   if (!network->load(filename)) return false;
+   this->publish(std::move(network));
+   return true;
+}
+
+/********************************************************************************
+* snapshot: Returnerar ett nytt ntverk innehllande en kopia av bias samt
+*           vikter fr respektive lager i angivet ntverk. Trningsdata,
+*           buffertar samt optimerarens tillstnd kopieras inte, s att
+*           kopian endast upptar det minne som krvs fr prediktion.
+*
+*           - network: Det ntverk vars parametrar kopieras.
+********************************************************************************/
+template <typename T>
+std::unique_ptr<ann<T>> model_handle<T>::snapshot(const ann<T>& network)
+{
+   auto copy = std::make_unique<ann<T>>();
+   copy_parameters(network.hidden_layer, copy->hidden_layer);
+   copy_parameters(network.output_layer, copy->output_layer);
+   return copy;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template struct model_handle<float>;
+template struct model_handle<double>;
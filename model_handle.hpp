@@ -0,0 +1,104 @@
+/********************************************************************************
+* model_handle.hpp: Handtag fr utbyte av ett neuralt ntverk av typen ann
+*                   medan prediktion pgr, enligt principen read-copy-update
+*                   (RCU). En ny uppsttning parametrar, exempelvis frn en
+*                   pgende trning eller en inlst modellfil, publiceras
+*                   atomrt via publish, medan prediktioner som redan har
+*                   pbrjats slutfrs med den tidigare versionen. Den
+*                   tidigare versionen frigrs frst nr samtliga lsare som
+*                   kan ha hmtat den har slppt sin referens.
+********************************************************************************/
+#ifndef MODEL_HANDLE_HPP_
+#define MODEL_HANDLE_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "ann.hpp"
+
+/********************************************************************************
+* model_handle: Handtag till den aktuella versionen av ett neuralt ntverk,
+*               som lses via acquire och byts ut via publish. Lsare rknas
+*               i en av tv rknare beroende p aktuell epok. Vid publicering
+*               byts pekaren till den nya versionen ut, varefter epoken rknas
+*               upp s att nya lsare rknas i den andra rknaren. Drefter
+*               vntar publish tills rknaren fr den tidigare epoken r noll,
+*               dvs. tills samtliga lsare som kan ha hmtat den tidigare
+*               versionen har slppt den, och frigr sedan denna.
+*
+*               Lsare anvnder endast atomra rknare och vntar aldrig p
+*               ls, varken vid hmtning eller vid utbyte. Samtidiga anrop av
+*               publish serialiseras via en mutex och vntar p lsarna,
+*               vilket sker i den trd som publicerar, exempelvis en trd
+*               fr trning i bakgrunden. Publicerade ntverk innehller
+*               endast parametrar och skall inte modifieras, utan anvnds
+*               fr prediktion via de konstanta varianterna av ann::predict.
+*               Samtliga versioner br ha lika mnga in- och utgngsnoder.
+********************************************************************************/
+template <typename T = double>
+struct model_handle
+{
+   /****************************************************************************
+   * reader: Lsreferens till en version av ntverket, som garanterat finns
+   *         kvar tills referensen slpps, antingen via release eller nr
+   *         referensen destrueras. Kan ven referera till ett ntverk utan
+   *         handtag, varvid inget rknas.
+   ****************************************************************************/
+   struct reader
+   {
+      /* Medlemmar: */
+      const model_handle* handle = nullptr; /* Handtag som referensen rknas i, annars nullptr. */
+      const ann<T>* network = nullptr;      /* Den version som refereras. */
+      std::size_t parity = 0;               /* Den rknare som referensen rknas i. */
+
+      /* Medlemsfunktioner: */
+      reader(void) { }
+      explicit reader(const ann<T>& network) : network(&network) { }
+      explicit reader(const model_handle& handle);
+      reader(const reader&) = delete;
+      reader& operator=(const reader&) = delete;
+      reader(reader&& source) noexcept { *this = std::move(source); }
+      reader& operator=(reader&& source) noexcept;
+      ~reader(void) { this->release(); }
+
+      const ann<T>* get(void) const { return this->network; }
+      const ann<T>& operator*(void) const { return *this->network; }
+      const ann<T>* operator->(void) const { return this->network; }
+      explicit operator bool(void) const { return this->network != nullptr; }
+      void release(void);
+   };
+
+   /* Medlemmar: */
+   std::atomic<const ann<T>*> current{ nullptr };                  /* Aktuell version, annars nullptr. */
+   std::atomic<std::uint64_t> epoch{ 0 };                          /* Aktuell epok, jmn eller udda. */
+   std::atomic<std::uint64_t> num_versions{ 0 };                   /* Antalet publicerade versioner. */
+   alignas(64) mutable std::atomic<std::size_t> readers_even{ 0 }; /* Lsare i jmna epoker. */
+   alignas(64) mutable std::atomic<std::size_t> readers_odd{ 0 };  /* Lsare i udda epoker. */
+   std::mutex writer;                                              /* Serialiserar publicering. */
+
+   /* Medlemsfunktioner: */
+   model_handle(void) { }
+   explicit model_handle(std::unique_ptr<ann<T>> network);
+   model_handle(const model_handle&) = delete;
+   model_handle& operator=(const model_handle&) = delete;
+   ~model_handle(void) { delete this->current.load(); }
+
+   std::uint64_t version(void) const { return this->num_versions.load(); }
+   reader acquire(void) const { return reader(*this); }
+   std::uint64_t publish(std::unique_ptr<ann<T>> network);
+   std::uint64_t publish(const ann<T>& network);
+   bool load(const std::string& filename);
+
+   static std::unique_ptr<ann<T>> snapshot(const ann<T>& network);
+
+private:
+   std::atomic<std::size_t>& readers(const std::size_t parity) const
+   {
+      return parity ? this->readers_odd : this->readers_even;
+   }
+};
+
+#endif /* MODEL_HANDLE_HPP_ */
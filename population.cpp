@@ -0,0 +1,481 @@
+/********************************************************************************
+* population.cpp: Definition av funktionsmedlemmar tillhrande strukterna
+*                 population_block samt population fr trning av mnga
+*                 neurala ntverk samtidigt.
+********************************************************************************/
+#include "population.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include "simd.hpp"
+
+namespace
+{
+/********************************************************************************
+* relu: Stter samtliga negativa element i angiven vektor till 0.
+*
+*       - data: Pekare till vektorns frsta element.
+*       - size: Antalet element i vektorn.
+********************************************************************************/
+template <typename T>
+void relu(T* data,
+          const std::size_t size)
+{
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      data[i] = data[i] > 0 ? data[i] : 0;
+   }
+
+   return;
+}
+}
+
+/********************************************************************************
+* resize: Allokerar parametrar samt buffertar fr en grupp ntverk med angivet
+*         antal noder i respektive lager, dr samtliga element stts till 0.
+*
+*         - num_inputs : Antalet noder i ingngslagret.
+*         - num_hidden : Antalet noder i det dolda lagret.
+*         - num_outputs: Antalet noder i utgngslagret.
+********************************************************************************/
+template <typename T>
+void population_block<T>::resize(const std::size_t num_inputs,
+                                 const std::size_t num_hidden,
+                                 const std::size_t num_outputs)
+{
+   this->hidden_bias.resize(num_hidden, lanes);
+   this->hidden_weights.resize(num_inputs * num_hidden, lanes);
+   this->output_bias.resize(num_outputs, lanes);
+   this->output_weights.resize(num_outputs * num_hidden, lanes);
+   this->hidden.resize(num_hidden, lanes);
+   this->output.resize(num_outputs, lanes);
+   this->hidden_error.resize(num_hidden, lanes);
+   this->output_error.resize(num_outputs, lanes);
+   this->output_step.resize(num_outputs, lanes);
+   this->rates.resize(2, lanes);
+   return;
+}
+
+/********************************************************************************
+* population: Initierar ny population bestende av ett ntverk per angiven
+*             medlem, dr samtliga ntverk har angivet antal noder i
+*             respektive lager. Varje ntverk tilldelas samma startvrden som
+*             ett ntverk av typen ann initierat med medlemmens startvrde.
+*             Oanvnda element i den sista gruppen har lrhastighet 0 och
+*             frblir drmed 0.
+*
+*             - num_inputs : Antalet noder i ingngslagret.
+*             - num_hidden : Antalet noder i det dolda lagret.
+*             - num_outputs: Antalet noder i utgngslagret.
+*             - members    : Instllningar fr respektive ntverk.
+*             - num_folds  : Antalet delar vid korsvalidering (default = 0,
+*                            vilket innebr att samtliga ntverk trnas p
+*                            samtliga trningsuppsttningar).
+*             - seed       : Startvrde fr ordningsfljden vid trning.
+********************************************************************************/
+template <typename T>
+population<T>::population(const std::size_t num_inputs,
+                          const std::size_t num_hidden,
+                          const std::size_t num_outputs,
+                          const std::vector<population_member<T>>& members,
+                          const std::size_t num_folds,
+                          const std::uint64_t seed)
+   : members(members), num_folds(num_folds), inputs(num_inputs), hidden_nodes(num_hidden),
+     output_nodes(num_outputs), generator(seed)
+{
+   constexpr auto lanes = population_block<T>::lanes;
+   this->blocks.resize((members.size() + lanes - 1) / lanes);
+
+   for (auto& i : this->blocks)
+   {
+      i.resize(num_inputs, num_hidden, num_outputs);
+   }
+
+   for (std::size_t m = 0; m < members.size(); ++m)
+   {
+      const ann<T> network(num_inputs, num_hidden, num_outputs, members[m].seed);
+      auto& block = this->blocks[m / lanes];
+      const auto lane = m % lanes;
+      block.rates[0][lane] = members[m].learning_rate;
+
+      for (std::size_t j = 0; j < num_hidden; ++j)
+      {
+         block.hidden_bias[j][lane] = network.hidden_layer.bias[j];
+
+         for (std::size_t i = 0; i < num_inputs; ++i)
+         {
+            block.hidden_weights[i * num_hidden + j][lane] = network.hidden_layer.weights[j][i];
+         }
+      }
+
+      for (std::size_t k = 0; k < num_outputs; ++k)
+      {
+         block.output_bias[k][lane] = network.output_layer.bias[k];
+
+         for (std::size_t j = 0; j < num_hidden; ++j)
+         {
+            block.output_weights[k * num_hidden + j][lane] = network.output_layer.weights[k][j];
+         }
+      }
+   }
+
+   return;
+}
+
+/********************************************************************************
+* train: Trnar samtliga ntverk i angiven population med angiven
+*        trningsdata under angivet antal epoker, dr ordningsfljden
+*        randomiseras i brjan av varje epok. Grupperna av ntverk frdelas
+*        jmnt ver angivet antal trdar, dr varje grupp genererar samma
+*        ordningsfljd frn ett gemensamt startvrde, som hmtas frn
+*        populationens slumptalsgenerator. Returnerar genomsnittlig kvadrerad
+*        avvikelse per utsignal under den sista epoken fr respektive
+*        ntverk, berknad ver de trningsuppsttningar som ntverket
+*        trnades p.
+*
+*        - data       : Trningsdata med lika mnga in- och utdata som
+*                       ntverken har noder i in- respektive utgngslagret.
+*        - num_epochs : Antalet epoker som trning skall genomfras.
+*        - num_threads: Antalet trdar, dr 0 innebr en trd per
+*                       processorkrna (default = 1).
+********************************************************************************/
+template <typename T>
+std::vector<double> population<T>::train(const dataset<T>& data,
+                                         const std::size_t num_epochs,
+                                         const std::size_t num_threads)
+{
+   std::vector<double> loss(this->size(), 0);
+   if (this->size() == 0 || data.num_inputs() != this->num_inputs() ||
+       data.num_outputs() != this->num_outputs()) return loss;
+
+   const auto num_blocks = this->blocks.size();
+   const auto hardware_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+   const auto thread_count = std::min(num_blocks, num_threads > 0 ? num_threads : hardware_threads);
+   const auto seed = this->generator();
+
+   auto train_blocks = [this, &data, &loss, num_epochs, seed](const std::size_t first, const std::size_t last)
+   {
+      for (auto b = first; b < last; ++b)
+      {
+         this->train_block(b, data, num_epochs, rng(seed), loss);
+      }
+   };
+
+   if (thread_count <= 1)
+   {
+      train_blocks(0, num_blocks);
+      return loss;
+   }
+
+   std::vector<std::thread> threads;
+
+   for (std::size_t t = 0; t < thread_count; ++t)
+   {
+      threads.emplace_back(train_blocks, num_blocks * t / thread_count, num_blocks * (t + 1) / thread_count);
+   }
+
+   for (auto& i : threads)
+   {
+      i.join();
+   }
+
+   return loss;
+}
+
+/********************************************************************************
+* train: Trnar samtliga ntverk i angiven population med trningsdata
+*        angiven via referenser till tvdimensionella vektorer, se ovan.
+*
+*        - train_in   : Indata, en vektor per trningsuppsttning.
+*        - train_out  : Referensdata, en vektor per trningsuppsttning.
+*        - num_epochs : Antalet epoker som trning skall genomfras.
+*        - num_threads: Antalet trdar (default = 1).
+********************************************************************************/
+template <typename T>
+std::vector<double> population<T>::train(const std::vector<std::vector<T>>& train_in,
+                                         const std::vector<std::vector<T>>& train_out,
+                                         const std::size_t num_epochs,
+                                         const std::size_t num_threads)
+{
+   return this->train(dataset<T>(train_in, train_out), num_epochs, num_threads);
+}
+
+/********************************************************************************
+* validate: Returnerar genomsnittlig kvadrerad avvikelse per utsignal fr
+*           respektive ntverk i angiven population, berknad ver angiven
+*           data. Vid korsvalidering berknas avvikelsen fr varje ntverk
+*           endast ver den del som ntverket inte trnades p.
+*
+*           - data: Data med lika mnga in- och utdata som ntverken har
+*                   noder i in- respektive utgngslagret.
+********************************************************************************/
+template <typename T>
+std::vector<double> population<T>::validate(const dataset<T>& data) const
+{
+   constexpr auto lanes = population_block<T>::lanes;
+   std::vector<double> loss(this->size(), 0);
+   if (this->size() == 0 || data.num_inputs() != this->num_inputs() ||
+       data.num_outputs() != this->num_outputs()) return loss;
+
+   matrix<T> hidden(this->num_hidden(), lanes);
+   matrix<T> output(this->num_outputs(), lanes);
+   std::vector<std::size_t> count(this->size(), 0);
+
+   for (std::size_t b = 0; b < this->blocks.size(); ++b)
+   {
+      const auto first = b * lanes;
+      const auto last = std::min(this->size(), first + lanes);
+
+      for (std::size_t s = 0; s < data.num_sets(); ++s)
+      {
+         this->feedforward(b, data.input(s), hidden, output);
+         const auto* reference = data.output(s);
+
+         for (auto m = first; m < last; ++m)
+         {
+            if (this->num_folds > 0 && this->members[m].fold != population_member<T>::no_fold &&
+                this->trains_on(m, s)) continue;
+            ++count[m];
+
+            for (std::size_t k = 0; k < this->num_outputs(); ++k)
+            {
+               const double deviation = reference[k] - output[k][m - first];
+               loss[m] += deviation * deviation;
+            }
+         }
+      }
+   }
+
+   for (std::size_t m = 0; m < this->size(); ++m)
+   {
+      if (count[m] > 0) loss[m] /= count[m] * this->num_outputs();
+   }
+
+   return loss;
+}
+
+/********************************************************************************
+* extract: Returnerar ett ntverk av typen ann innehllande en kopia av
+*          parametrarna fr angivet ntverk i angiven population, exempelvis
+*          fr prediktion eller fr att sparas via ann::save.
+*
+*          - member: Index fr det ntverk som skall kopieras.
+********************************************************************************/
+template <typename T>
+ann<T> population<T>::extract(const std::size_t member) const
+{
+   constexpr auto lanes = population_block<T>::lanes;
+   const auto& block = this->blocks[member / lanes];
+   const auto lane = member % lanes;
+   const auto num_hidden = this->num_hidden();
+   ann<T> network(this->num_inputs(), num_hidden, this->num_outputs(), this->members[member].seed);
+
+   for (std::size_t j = 0; j < num_hidden; ++j)
+   {
+      network.hidden_layer.bias[j] = block.hidden_bias[j][lane];
+
+      for (std::size_t i = 0; i < this->num_inputs(); ++i)
+      {
+         network.hidden_layer.weights[j][i] = block.hidden_weights[i * num_hidden + j][lane];
+      }
+   }
+
+   for (std::size_t k = 0; k < this->num_outputs(); ++k)
+   {
+      network.output_layer.bias[k] = block.output_bias[k][lane];
+
+      for (std::size_t j = 0; j < num_hidden; ++j)
+      {
+         network.output_layer.weights[k][j] = block.output_weights[k * num_hidden + j][lane];
+      }
+   }
+
+   return network;
+}
+
+/********************************************************************************
+* train_block: Trnar ntverken i angiven grupp under angivet antal epoker.
+*              Fr varje trningsuppsttning genomfrs feedforward, varefter
+*              avvikelserna i utgngslagret berknas och multipliceras med
+*              respektive ntverks lrhastighet. Drefter sprids avvikelserna
+*              bakt till det dolda lagret i samma passage som utgngslagrets
+*              vikter justeras, fljt av justering av det dolda lagret, dr
+*              samtliga vikter fr indata i justeras som en vektor med samma
+*              faktor fr samtliga ntverk. Vid korsvalidering stts
+*              lrhastigheten till 0 fr de ntverk som inte skall trnas p
+*              aktuell uppsttning. Genomsnittlig kvadrerad avvikelse per
+*              utsignal under sista epoken lagras per ntverk i loss.
+*
+*              - block     : Index fr gruppen som trnas.
+*              - data      : Trningsdata.
+*              - num_epochs: Antalet epoker som trning skall genomfras.
+*              - generator : Slumptalsgenerator fr ordningsfljden.
+*              - loss      : Vektor dr frlusten per ntverk lagras.
+********************************************************************************/
+template <typename T>
+void population<T>::train_block(const std::size_t block,
+                                const dataset<T>& data,
+                                const std::size_t num_epochs,
+                                rng generator,
+                                std::vector<double>& loss)
+{
+   constexpr auto lanes = population_block<T>::lanes;
+   auto& group = this->blocks[block];
+   const auto num_inputs = this->num_inputs();
+   const auto num_hidden = this->num_hidden();
+   const auto num_outputs = this->num_outputs();
+   const auto layer_size = num_hidden * lanes;
+   const auto first = block * lanes;
+   const auto size = std::min(this->size(), first + lanes) - first;
+   std::vector<std::size_t> order(data.num_sets());
+   std::vector<double> sum(lanes), count(lanes);
+   std::iota(order.begin(), order.end(), 0);
+
+   for (std::size_t epoch = 0; epoch < num_epochs; ++epoch)
+   {
+      generator.shuffle(order.data(), order.size());
+      std::fill(sum.begin(), sum.end(), 0);
+      std::fill(count.begin(), count.end(), 0);
+
+      for (const auto s : order)
+      {
+         const auto* input = data.input(s);
+         const auto* reference = data.output(s);
+         const T* rate = group.rates[0];
+
+         if (this->num_folds > 0)
+         {
+            for (std::size_t m = 0; m < size; ++m)
+            {
+               group.rates[1][m] = this->trains_on(first + m, s) ? rate[m] : 0;
+            }
+
+            rate = group.rates[1];
+         }
+
+         this->feedforward(block, input, group.hidden, group.output);
+
+         for (std::size_t k = 0; k < num_outputs; ++k)
+         {
+            const auto* output = group.output[k];
+            auto* error = group.output_error[k];
+            auto* step = group.output_step[k];
+            auto* bias = group.output_bias[k];
+
+            for (std::size_t m = 0; m < lanes; ++m)
+            {
+               const auto deviation = reference[k] - output[m];
+               error[m] = output[m] > 0 ? deviation : 0;
+               step[m] = rate[m] * error[m];
+               bias[m] += step[m];
+            }
+
+            for (std::size_t m = 0; m < size; ++m)
+            {
+               if (!this->trains_on(first + m, s)) continue;
+               const double deviation = reference[k] - output[m];
+               sum[m] += deviation * deviation;
+               ++count[m];
+            }
+         }
+
+         std::fill(group.hidden_error[0], group.hidden_error[0] + layer_size, 0);
+
+         for (std::size_t k = 0; k < num_outputs; ++k)
+         {
+            simd::multiply_add_update(group.output_error[k], group.output_weights[k * num_hidden],
+                                      group.hidden_error[0], group.output_step[k], group.hidden[0],
+                                      num_hidden, lanes, lanes);
+         }
+
+         for (std::size_t j = 0; j < num_hidden; ++j)
+         {
+            const auto* output = group.hidden[j];
+            auto* step = group.hidden_error[j];
+            auto* bias = group.hidden_bias[j];
+
+            for (std::size_t m = 0; m < lanes; ++m)
+            {
+               step[m] = output[m] > 0 ? rate[m] * step[m] : 0;
+               bias[m] += step[m];
+            }
+         }
+
+         simd::gemm_tn(num_inputs, layer_size, 1, input, num_inputs, group.hidden_error[0], layer_size,
+                       group.hidden_weights[0], layer_size);
+      }
+   }
+
+   for (std::size_t m = 0; m < size; ++m)
+   {
+      loss[first + m] = count[m] > 0 ? sum[m] / count[m] : 0;
+   }
+
+   return;
+}
+
+/********************************************************************************
+* feedforward: Genomfr feedforward fr ntverken i angiven grupp med
+*              angiven indata, som r gemensam fr samtliga ntverk. Det
+*              dolda lagret berknas som en matrisprodukt mellan indatan och
+*              vikterna, dr samtliga vikter fr indata i utgr en rad, medan
+*              utgngslagret berknas via elementvisa produkter mellan det
+*              dolda lagrets utdata och respektive viktrad, eftersom utdatan
+*              skiljer sig mellan ntverken.
+*
+*              - block : Index fr gruppen som berknas.
+*              - input : Pekare till indata, ett vrde per nod i ingngslagret.
+*              - hidden: Matris dr det dolda lagrets utdata lagras.
+*              - output: Matris dr utgngslagrets utdata lagras.
+********************************************************************************/
+template <typename T>
+void population<T>::feedforward(const std::size_t block,
+                                const T* input,
+                                matrix<T>& hidden,
+                                matrix<T>& output) const
+{
+   constexpr auto lanes = population_block<T>::lanes;
+   const auto& group = this->blocks[block];
+   const auto num_hidden = this->num_hidden();
+   const auto layer_size = num_hidden * lanes;
+
+   std::copy(group.hidden_bias[0], group.hidden_bias[0] + layer_size, hidden[0]);
+   simd::gemm_nn(1, layer_size, this->num_inputs(), input, this->num_inputs(), group.hidden_weights[0],
+                 layer_size, hidden[0], layer_size);
+   relu(hidden[0], layer_size);
+
+   for (std::size_t k = 0; k < this->num_outputs(); ++k)
+   {
+      auto* row = output[k];
+      std::copy(group.output_bias[k], group.output_bias[k] + lanes, row);
+      simd::multiply_add(hidden[0], group.output_weights[k * num_hidden], num_hidden, lanes, row, lanes);
+      relu(row, lanes);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* trains_on: Indikerar ifall angivet ntverk trnas p trningsuppsttningen
+*            med angivet index, vilket gller samtliga uppsttningar utom den
+*            del som ntverket utelmnar vid korsvalidering.
+*
+*            - member: Index fr ntverket.
+*            - set   : Index fr trningsuppsttningen.
+********************************************************************************/
+template <typename T>
+bool population<T>::trains_on(const std::size_t member,
+                              const std::size_t set) const
+{
+   const auto fold = this->members[member].fold;
+   return this->num_folds == 0 || fold == population_member<T>::no_fold || set % this->num_folds != fold;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template struct population_member<float>;
+template struct population_member<double>;
+template struct population_block<float>;
+template struct population_block<double>;
+template struct population<float>;
+template struct population<double>;
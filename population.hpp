@@ -0,0 +1,148 @@
+/********************************************************************************
+* population.hpp: Trning av mnga sm neurala ntverk med samma topologi
+*                 samtidigt, exempelvis vid skning efter hyperparametrar
+*                 eller vid korsvalidering. Ett enskilt litet ntverk r fr
+*                 litet fr att utnyttja processorns vektorenheter, men genom
+*                 att lagra parametrarna fr samtliga ntverk kolumnvis
+*                 (structure-of-arrays), dr varje kolumn motsvarar ett
+*                 ntverk, justeras samtliga ntverk i samma vektorinstruktioner
+*                 medan trningsdatan endast lses en gng.
+********************************************************************************/
+#ifndef POPULATION_HPP_
+#define POPULATION_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ann.hpp"
+#include "dataset.hpp"
+#include "matrix.hpp"
+#include "rng.hpp"
+
+/********************************************************************************
+* population_member: Instllningar fr ett enskilt ntverk i en population.
+*                    Vid korsvalidering med num_folds delar trnas ntverket
+*                    p samtliga trningsuppsttningar utom dem vars index
+*                    modulo num_folds r lika med fold, vilka i stllet
+*                    anvnds vid validering.
+********************************************************************************/
+template <typename T = double>
+struct population_member
+{
+   /* Konstanter: */
+   static constexpr std::size_t no_fold = static_cast<std::size_t>(-1);
+
+   /* Medlemmar: */
+   T learning_rate = static_cast<T>(0.01); /* Lrhastighet fr ntverket. */
+   std::uint64_t seed = rng::default_seed; /* Startvrde fr ntverkets parametrar. */
+   std::size_t fold = no_fold;             /* Utelmnad del vid korsvalidering, annars no_fold. */
+};
+
+/********************************************************************************
+* population_block: Parametrar samt buffertar fr en grupp ntverk i en
+*                   population, dr gruppen upptar en cache-line per
+*                   parameter, dvs. lanes ntverk. Varje parameter lagras som
+*                   en rad med ett element per ntverk, exempelvis lagras vikt
+*                   i fr nod j i det dolda lagret p rad i * num_hidden + j i
+*                   hidden_weights. Drmed ligger samtliga vikter fr indata i
+*                   efter varandra, s att de kan justeras som en enda vektor.
+********************************************************************************/
+template <typename T = double>
+struct population_block
+{
+   /* Konstanter: */
+   static constexpr std::size_t lanes = 64 / sizeof(T);
+
+   /* Medlemmar: */
+   matrix<T> hidden_bias;    /* Bias i det dolda lagret, en rad per nod. */
+   matrix<T> hidden_weights; /* Vikter i det dolda lagret, en rad per vikt. */
+   matrix<T> output_bias;    /* Bias i utgngslagret, en rad per nod. */
+   matrix<T> output_weights; /* Vikter i utgngslagret, en rad per vikt. */
+   matrix<T> hidden;         /* Utdata frn det dolda lagret. */
+   matrix<T> output;         /* Utdata frn utgngslagret. */
+   matrix<T> hidden_error;   /* Avvikelser i det dolda lagret. */
+   matrix<T> output_error;   /* Avvikelser i utgngslagret. */
+   matrix<T> output_step;    /* Avvikelser i utgngslagret gnger lrhastighet. */
+   matrix<T> rates;          /* Lrhastigheter samt lrhastigheter per uppsttning. */
+
+   /* Medlemsfunktioner: */
+   population_block(void) { }
+   void resize(const std::size_t num_inputs,
+               const std::size_t num_hidden,
+               const std::size_t num_outputs);
+};
+
+/********************************************************************************
+* population: Strukt fr ett antal neurala ntverk med samma antal noder i
+*             respektive lager, vilka trnas samtidigt p samma trningsdata
+*             i samma ordningsfljd. Ntverken delas upp i grupper om en
+*             cache-line, se population_block, dr varje steg i feedforward,
+*             backpropagation och justering genomfrs fr samtliga ntverk i
+*             gruppen via samma vektorinstruktioner och varje element i
+*             registren motsvarar ett ntverk. Varje grupp trnas under
+*             samtliga epoker innan nsta grupp trnas, s att gruppens
+*             parametrar fr sm ntverk kan ligga kvar i cacheminnet medan
+*             trningsdatan lses p nytt per grupp.
+*
+*             Varje ntverk har egen lrhastighet och egna startvrden, dr
+*             startvrdena r identiska med ann(num_inputs, num_hidden,
+*             num_outputs, seed). Parametrarna justeras via gradient descent
+*             efter varje trningsuppsttning, p samma stt som ann::train
+*             med batchstorlek 1, medan ordningsfljden genereras av
+*             populationens egen slumptalsgenerator och delas av samtliga
+*             ntverk. Vid flera trdar frdelas grupperna mellan trdarna,
+*             vilka drmed inte delar data som skrivs. Resultatet r drmed
+*             oberoende av antalet trdar. Trnade ntverk hmtas via extract.
+********************************************************************************/
+template <typename T = double>
+struct population
+{
+   /* Medlemmar: */
+   std::vector<population_member<T>> members; /* Instllningar per ntverk. */
+   std::size_t num_folds = 0;                 /* Antalet delar vid korsvalidering, 0 = ingen. */
+   std::size_t inputs = 0;                    /* Antalet noder i ingngslagret. */
+   std::size_t hidden_nodes = 0;              /* Antalet noder i det dolda lagret. */
+   std::size_t output_nodes = 0;              /* Antalet noder i utgngslagret. */
+   std::vector<population_block<T>> blocks;   /* Grupper om en cache-line ntverk. */
+   rng generator;                             /* Slumptalsgenerator fr ordningsfljden. */
+
+   /* Medlemsfunktioner: */
+   population(void) { }
+   population(const std::size_t num_inputs,
+              const std::size_t num_hidden,
+              const std::size_t num_outputs,
+              const std::vector<population_member<T>>& members,
+              const std::size_t num_folds = 0,
+              const std::uint64_t seed = rng::default_seed);
+
+   std::size_t size(void) const { return this->members.size(); }
+   std::size_t num_inputs(void) const { return this->inputs; }
+   std::size_t num_hidden(void) const { return this->hidden_nodes; }
+   std::size_t num_outputs(void) const { return this->output_nodes; }
+
+   std::vector<double> train(const dataset<T>& data,
+                             const std::size_t num_epochs,
+                             const std::size_t num_threads = 1);
+   std::vector<double> train(const std::vector<std::vector<T>>& train_in,
+                             const std::vector<std::vector<T>>& train_out,
+                             const std::size_t num_epochs,
+                             const std::size_t num_threads = 1);
+   std::vector<double> validate(const dataset<T>& data) const;
+   ann<T> extract(const std::size_t member) const;
+
+private:
+   void train_block(const std::size_t block,
+                    const dataset<T>& data,
+                    const std::size_t num_epochs,
+                    rng generator,
+                    std::vector<double>& loss);
+   void feedforward(const std::size_t block,
+                    const T* input,
+                    matrix<T>& hidden,
+                    matrix<T>& output) const;
+   bool trains_on(const std::size_t member,
+                  const std::size_t set) const;
+};
+
+#endif /* POPULATION_HPP_ */
@@ -0,0 +1,161 @@
+/********************************************************************************
+* profile.cpp: Definition av funktionsmedlemmar tillhrande strukten
+*              ann_profile fr mtning av tid samt rknare.
+********************************************************************************/
+#include "profile.hpp"
+
+#include <sstream>
+
+/********************************************************************************
+* operator=: Kopierar samtliga mtvrden frn angiven profil.
+*
+*            - source: Den profil vars mtvrden skall kopieras.
+********************************************************************************/
+ann_profile& ann_profile::operator=(const ann_profile& source)
+{
+   for (std::size_t i = 0; i < num_phases; ++i)
+   {
+      this->time_ns[i] = source.time_ns[i].load();
+   }
+
+   this->samples = source.samples.load();
+   this->predictions = source.predictions.load();
+   this->epochs = source.epochs.load();
+   this->loss_sum = source.loss_sum.load();
+   this->loss_count = source.loss_count.load();
+   this->epoch_loss = source.epoch_loss;
+   this->depth = source.depth;
+   return *this;
+}
+
+/********************************************************************************
+* clear: Nollstller samtliga mtvrden i angiven profil.
+********************************************************************************/
+void ann_profile::clear(void)
+{
+   for (auto& i : this->time_ns)
+   {
+      i = 0;
+   }
+
+   this->samples = 0;
+   this->predictions = 0;
+   this->epochs = 0;
+   this->loss_sum = 0;
+   this->loss_count = 0;
+   this->epoch_loss.clear();
+   this->depth = 0;
+   return;
+}
+
+/********************************************************************************
+* add_time: Adderar angiven tid till angiven fas.
+*
+*           - phase      : Den fas som tiden tillhr.
+*           - nanoseconds: Uppmtt tid i nanosekunder.
+********************************************************************************/
+void ann_profile::add_time(const profile_phase phase,
+                           const std::uint64_t nanoseconds)
+{
+   this->time_ns[static_cast<std::size_t>(phase)].fetch_add(nanoseconds, std::memory_order_relaxed);
+   return;
+}
+
+/********************************************************************************
+* add_loss: Adderar angivet summerat kvadratiskt fel till aktuell epok.
+*
+*           - squared_error: Summan av kvadrerade avvikelser.
+*           - num_values   : Antalet avvikelser i summan.
+********************************************************************************/
+void ann_profile::add_loss(const double squared_error,
+                           const std::size_t num_values)
+{
+   auto sum = this->loss_sum.load(std::memory_order_relaxed);
+   while (!this->loss_sum.compare_exchange_weak(sum, sum + squared_error, std::memory_order_relaxed)) { }
+   this->loss_count.fetch_add(num_values, std::memory_order_relaxed);
+   return;
+}
+
+/********************************************************************************
+* begin_epoch: Markerar brjan p en ny epok, varvid frlusten nollstlls.
+*              Anrop som sker under en redan pbrjad epok, exempelvis vid
+*              strmmad trning dr varje block trnas som en egen epok,
+*              rknas som en del av den yttre epoken.
+********************************************************************************/
+void ann_profile::begin_epoch(void)
+{
+   if (this->depth++ > 0) return;
+   this->loss_sum = 0;
+   this->loss_count = 0;
+   return;
+}
+
+/********************************************************************************
+* end_epoch: Markerar slutet p en epok, varvid antalet epoker rknas upp och
+*            epokens genomsnittliga kvadratiska fel lagras.
+********************************************************************************/
+void ann_profile::end_epoch(void)
+{
+   if (this->depth == 0 || --this->depth > 0) return;
+   const auto count = this->loss_count.load();
+   this->epochs++;
+   this->epoch_loss.push_back(count > 0 ? this->loss_sum.load() / count : 0.0);
+   return;
+}
+
+/********************************************************************************
+* write_json: Skriver samtliga mtvrden i JSON-format via angiven utstrm.
+*
+*             - ostream: Angiven utstrm (default = std::cout).
+********************************************************************************/
+void ann_profile::write_json(std::ostream& ostream) const
+{
+   ostream << "{\n  \"enabled\": " << (enabled() ? "true" : "false") << ",\n  \"time_ns\": {";
+
+   for (std::size_t i = 0; i < num_phases; ++i)
+   {
+      const auto phase = static_cast<profile_phase>(i);
+      ostream << (i > 0 ? ", " : " ") << "\"" << name(phase) << "\": " << this->nanoseconds(phase);
+   }
+
+   ostream << " },\n  \"samples\": " << this->samples << ",\n  \"predictions\": " << this->predictions
+           << ",\n  \"epochs\": " << this->epochs << ",\n  \"epoch_loss\": [";
+
+   for (std::size_t i = 0; i < this->epoch_loss.size(); ++i)
+   {
+      ostream << (i > 0 ? ", " : "") << this->epoch_loss[i];
+   }
+
+   ostream << "]\n}\n";
+   return;
+}
+
+/********************************************************************************
+* json: Returnerar samtliga mtvrden i JSON-format, se write_json.
+********************************************************************************/
+std::string ann_profile::json(void) const
+{
+   std::ostringstream stream;
+   this->write_json(stream);
+   return stream.str();
+}
+
+/********************************************************************************
+* name: Returnerar namnet p angiven fas, som anvnds i JSON-utskrift.
+*
+*       - phase: Den fas vars namn skall returneras.
+********************************************************************************/
+const char* ann_profile::name(const profile_phase phase)
+{
+   switch (phase)
+   {
+      case profile_phase::shuffle: return "shuffle";
+      case profile_phase::load: return "load";
+      case profile_phase::feedforward: return "feedforward";
+      case profile_phase::backpropagate: return "backpropagate";
+      case profile_phase::optimize: return "optimize";
+      case profile_phase::predict: return "predict";
+   }
+
+   return "unknown";
+}
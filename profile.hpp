@@ -0,0 +1,129 @@
+/********************************************************************************
+* profile.hpp: Mtning av tid samt rknare fr trning och prediktion i
+*              neurala ntverk, exempelvis fr att avgra ifall tiden vid
+*              trning gr t till feedforward, backpropagation, justering
+*              av parametrar eller randomisering av trningsdatan.
+*
+*              Mtningarna aktiveras genom att biblioteket kompileras med
+*              makrot ANN_PROFILING definierat, exempelvis via CMake-optionen
+*              med samma namn (cmake -DANN_PROFILING=ON). Annars expanderar
+*              makrona ANN_PROFILE_SCOPE samt ANN_PROFILE_RUN till ingenting,
+*              s att mtningarna inte medfr ngon kostnad alls.
+********************************************************************************/
+#ifndef PROFILE_HPP_
+#define PROFILE_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef ANN_PROFILING
+#define ANN_PROFILE_CONCAT_(a, b) a##b
+#define ANN_PROFILE_CONCAT(a, b) ANN_PROFILE_CONCAT_(a, b)
+#define ANN_PROFILE_SCOPE(profile, phase) \
+   const profile_timer ANN_PROFILE_CONCAT(profile_timer_, __LINE__)(profile, phase)
+#define ANN_PROFILE_RUN(statement) statement
+#else
+#define ANN_PROFILE_SCOPE(profile, phase)
+#define ANN_PROFILE_RUN(statement)
+#endif
+
+/********************************************************************************
+* profile_phase: Faser vars tid mts separat.
+*
+*                - shuffle      : Randomisering av trningsdatans ordning.
+*                - load         : Kopiering av trningsdata till minibatcher.
+*                - feedforward  : Feedforward vid trning.
+*                - backpropagate: Berkning av avvikelser och gradienter.
+*                - optimize     : Justering av parametrar.
+*                - predict      : Prediktion.
+********************************************************************************/
+enum class profile_phase { shuffle, load, feedforward, backpropagate, optimize, predict };
+
+/********************************************************************************
+* ann_profile: Strukt innehllande uppmtt tid per fas, antalet trnade samt
+*              predikterade uppsttningar, antalet epoker samt genomsnittligt
+*              kvadratiskt fel (MSE) per epok. Tid samt rknare uppdateras
+*              atomiskt, s att flera trdar kan rapportera samtidigt, vilket
+*              innebr att tiden per fas utgr summan ver samtliga trdar.
+*              Frlusten per epok berknas utifrn ntverkets utdata under
+*              trningen, dvs. fre respektive justering av parametrarna.
+********************************************************************************/
+struct ann_profile
+{
+   /* Medlemmar: */
+   static constexpr std::size_t num_phases = 6;                 /* Antalet faser. */
+   std::array<std::atomic<std::uint64_t>, num_phases> time_ns;  /* Uppmtt tid per fas i ns. */
+   std::atomic<std::uint64_t> samples{ 0 };                     /* Antalet trnade uppsttningar. */
+   std::atomic<std::uint64_t> predictions{ 0 };                 /* Antalet predikterade uppsttningar. */
+   std::atomic<std::uint64_t> epochs{ 0 };                      /* Antalet genomfrda epoker. */
+   std::atomic<double> loss_sum{ 0 };                           /* Summerat kvadratiskt fel fr aktuell epok. */
+   std::atomic<std::uint64_t> loss_count{ 0 };                  /* Antalet vrden i loss_sum. */
+   std::vector<double> epoch_loss;                              /* Genomsnittligt kvadratiskt fel per epok. */
+   std::size_t depth = 0;                                       /* Antalet pgende nstlade epoker. */
+
+   /* Medlemsfunktioner: */
+   ann_profile(void) { this->clear(); }
+   ann_profile(const ann_profile& source) { *this = source; }
+   ann_profile& operator=(const ann_profile& source);
+
+   static constexpr bool enabled(void)
+   {
+#ifdef ANN_PROFILING
+      return true;
+#else
+      return false;
+#endif
+   }
+
+   std::uint64_t nanoseconds(const profile_phase phase) const { return this->time_ns[static_cast<std::size_t>(phase)]; }
+
+   void clear(void);
+   void add_time(const profile_phase phase,
+                 const std::uint64_t nanoseconds);
+   void add_samples(const std::size_t num_samples) { this->samples.fetch_add(num_samples, std::memory_order_relaxed); }
+   void add_predictions(const std::size_t num_rows) { this->predictions.fetch_add(num_rows, std::memory_order_relaxed); }
+   void add_loss(const double squared_error,
+                 const std::size_t num_values);
+   void begin_epoch(void);
+   void end_epoch(void);
+
+   void write_json(std::ostream& ostream = std::cout) const;
+   std::string json(void) const;
+
+   static const char* name(const profile_phase phase);
+};
+
+/********************************************************************************
+* profile_timer: Mter tiden frn att objektet skapas till att det raderas
+*                och adderar tiden till angiven fas i angiven profil.
+*                Anvnds via makrot ANN_PROFILE_SCOPE.
+********************************************************************************/
+class profile_timer
+{
+public:
+   profile_timer(ann_profile& profile,
+                 const profile_phase phase)
+      : profile(profile), phase(phase), start(std::chrono::steady_clock::now()) { }
+
+   ~profile_timer(void)
+   {
+      const auto elapsed = std::chrono::steady_clock::now() - this->start;
+      this->profile.add_time(this->phase, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+   }
+
+   profile_timer(const profile_timer&) = delete;
+   profile_timer& operator=(const profile_timer&) = delete;
+
+private:
+   ann_profile& profile;
+   const profile_phase phase;
+   const std::chrono::steady_clock::time_point start;
+};
+
+#endif /* PROFILE_HPP_ */
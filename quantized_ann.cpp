@@ -0,0 +1,455 @@
+/********************************************************************************
+* quantized_ann.cpp: Definition av funktionsmedlemmar tillhrande strukterna
+*                    quantized_layer samt quantized_ann fr kvantiserad
+*                    prediktion med 8-bitars heltal.
+********************************************************************************/
+#include "quantized_ann.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+/********************************************************************************
+* to_int8: Avrundar angivet vrde till nrmaste heltal i intervallet
+*          [-127, 127], s att kvantiseringen blir symmetrisk kring noll.
+*
+*          - value: Det vrde som skall avrundas.
+********************************************************************************/
+std::int8_t to_int8(const float value)
+{
+   return static_cast<std::int8_t>(std::max(-127.0f, std::min(127.0f, std::nearbyint(value))));
+}
+
+/********************************************************************************
+* scale_for: Returnerar skalfaktorn som avbildar angivet strsta absoluta
+*            vrde p angivet strsta heltal, eller 1 om vrdet r noll.
+*
+*            - max_value: Strsta absoluta vrde som skall kunna representeras.
+*            - max_int  : Strsta heltal som vrdet avbildas p (default = 127).
+********************************************************************************/
+float scale_for(const double max_value,
+                const double max_int = 127.0)
+{
+   return max_value > 0 ? static_cast<float>(max_value / max_int) : 1.0f;
+}
+
+/********************************************************************************
+* argmax: Returnerar index fr det strsta elementet i angiven buffert.
+*
+*         - data: Pekare till buffertens frsta element.
+*         - size: Antalet element i bufferten.
+********************************************************************************/
+template <typename T>
+std::size_t argmax(const T* data,
+                   const std::size_t size)
+{
+   return static_cast<std::size_t>(std::max_element(data, data + size) - data);
+}
+}
+
+/********************************************************************************
+* memory_size: Returnerar antalet byte som upptas av lagrets parametrar.
+********************************************************************************/
+std::size_t quantized_layer::memory_size(void) const
+{
+   return this->weights.size() * sizeof(std::int8_t) + (this->multiplier.size() + this->offset.size()) * sizeof(float) +
+      this->correction.size() * sizeof(std::int32_t);
+}
+
+/********************************************************************************
+* quantize: Kvantiserar angivet dense-lager, dr varje viktrad skalas s att
+*           radens strsta absoluta vrde avbildas p 127. Multiplikatorn fr
+*           varje nod kombinerar indatans, radens samt utdatans skalfaktor,
+*           s att omvandlingen frn heltalssumma till utdata endast krver
+*           en multiplikation och en addition. Indatans nollpunkt bidrar med
+*           input_zero gnger radens viktsumma, vilket dras av via
+*           korrigeringen.
+*
+*           - layer       : Det dense-lager som skall kvantiseras.
+*           - input_scale : Skalfaktor fr lagrets kvantiserade indata.
+*           - input_zero  : Nollpunkt fr lagrets kvantiserade indata.
+*           - output_scale: Skalfaktor fr lagrets utdata, dr 1 innebr att
+*                           utdatan returneras som flyttal utan kvantisering.
+********************************************************************************/
+template <typename T>
+void quantized_layer::quantize(const dense_layer<T>& layer,
+                               const float input_scale,
+                               const std::int32_t input_zero,
+                               const float output_scale)
+{
+   this->num_weights = layer.num_weights();
+   this->stride = padded(this->num_weights);
+   this->weights.assign(layer.num_nodes() * this->stride, 0);
+   this->multiplier.resize(layer.num_nodes());
+   this->offset.resize(layer.num_nodes());
+   this->correction.resize(layer.num_nodes());
+
+   for (std::size_t i = 0; i < layer.num_nodes(); ++i)
+   {
+      const auto* row = layer.weights[i];
+      double max_weight = 0;
+
+      for (std::size_t j = 0; j < this->num_weights; ++j)
+      {
+         max_weight = std::max<double>(max_weight, std::fabs(row[j]));
+      }
+
+      const auto scale = scale_for(max_weight);
+      auto* weights = this->weights.data() + i * this->stride;
+      std::int32_t weight_sum = 0;
+
+      for (std::size_t j = 0; j < this->num_weights; ++j)
+      {
+         weights[j] = to_int8(static_cast<float>(row[j] / scale));
+         weight_sum += weights[j];
+      }
+
+      this->multiplier[i] = input_scale * scale / output_scale;
+      this->offset[i] = static_cast<float>(layer.bias[i] / output_scale);
+      this->correction[i] = -input_zero * weight_sum;
+   }
+
+   return;
+}
+
+/********************************************************************************
+* print: Skriver ut angiven jmfrelse via angiven utstrm.
+*
+*        - ostream: Angiven utstrm (default = std::cout).
+********************************************************************************/
+void quantization_report::print(std::ostream& ostream) const
+{
+   ostream << "--------------------------------------------------------------------------------\n";
+   ostream << "Compared rows: " << this->num_rows << "\n";
+   ostream << "Max error: " << this->max_error << "\n";
+   ostream << "Mean error: " << this->mean_error << "\n";
+   ostream << "Agreement: " << this->agreement * 100 << " %\n";
+   ostream << "Memory: " << this->float_bytes << " -> " << this->quantized_bytes << " bytes";
+   if (this->quantized_bytes > 0) ostream << " (" << static_cast<double>(this->float_bytes) / this->quantized_bytes << "x)";
+   ostream << "\n--------------------------------------------------------------------------------\n\n";
+   return;
+}
+
+/********************************************************************************
+* quantized_ann: Skapar en kvantiserad kopia av angivet trnat ntverk, dr
+*                skalfaktorerna kalibreras via ett urval av ntverkets
+*                trningsdata, se quantize.
+*
+*                - network        : Det trnade ntverk som skall kvantiseras.
+*                - num_calibration: Maximalt antal trningsuppsttningar som
+*                                   anvnds vid kalibrering (default = 1024).
+********************************************************************************/
+template <typename T>
+quantized_ann<T>::quantized_ann(const ann<T>& network,
+                                const std::size_t num_calibration)
+{
+   this->quantize(network, num_calibration);
+   return;
+}
+
+/********************************************************************************
+* quantize: Kvantiserar angivet trnat ntverk och kalibrerar skalfaktorerna
+*           via hgst num_calibration trningsuppsttningar, som vljs med
+*           jmna mellanrum ur ntverkets trningsdata.
+*
+*           - network        : Det trnade ntverk som skall kvantiseras.
+*           - num_calibration: Maximalt antal trningsuppsttningar som
+*                              anvnds vid kalibrering (default = 1024).
+********************************************************************************/
+template <typename T>
+void quantized_ann<T>::quantize(const ann<T>& network,
+                                const std::size_t num_calibration)
+{
+   const auto calibration = sample(network, num_calibration);
+   const auto num_inputs = network.train_data.num_inputs();
+   this->quantize(network, calibration.data(), num_inputs > 0 ? calibration.size() / num_inputs : 0, num_inputs);
+   return;
+}
+
+/********************************************************************************
+* quantize: Kvantiserar angivet trnat ntverk, dr skalfaktorn fr indata
+*           respektive utdata frn det dolda lagret stts s att strsta
+*           absoluta vrde bland angivna kalibreringsrader avbildas p 127
+*           respektive 255.
+*           Saknas kalibreringsrader antas indatan ligga inom [-1, 1], varvid
+*           det dolda lagrets strsta mjliga utdata anvnds.
+*
+*           - network    : Det trnade ntverk som skall kvantiseras.
+*           - calibration: Pekare till radvis lagrad kalibreringsdata, som
+*                          innehller num_rows x num_inputs element.
+*           - num_rows   : Antalet kalibreringsrader.
+*           - num_inputs : Antalet element per kalibreringsrad.
+********************************************************************************/
+template <typename T>
+void quantized_ann<T>::quantize(const ann<T>& network,
+                                const T* calibration,
+                                const std::size_t num_rows,
+                                const std::size_t num_inputs)
+{
+   const auto& hidden = network.hidden_layer;
+   std::vector<T> output(hidden.num_nodes());
+   double max_input = num_rows > 0 ? 0 : 1;
+   double max_hidden = 0;
+
+   for (std::size_t r = 0; r < num_rows; ++r)
+   {
+      const auto* row = calibration + r * num_inputs;
+      hidden.feedforward(row, num_inputs, output.data());
+
+      for (std::size_t j = 0; j < std::min(num_inputs, hidden.num_weights()); ++j)
+      {
+         max_input = std::max<double>(max_input, std::fabs(row[j]));
+      }
+
+      for (const auto i : output)
+      {
+         max_hidden = std::max<double>(max_hidden, i);
+      }
+   }
+
+   for (std::size_t i = 0; i < hidden.num_nodes() && num_rows == 0; ++i)
+   {
+      double sum = hidden.bias[i];
+
+      for (std::size_t j = 0; j < hidden.num_weights(); ++j)
+      {
+         sum += std::fabs(hidden.weights[i][j]);
+      }
+
+      max_hidden = std::max(max_hidden, sum);
+   }
+
+   this->input_scale = scale_for(max_input);
+   this->hidden_scale = scale_for(max_hidden, 255.0);
+   this->hidden_layer.quantize(hidden, this->input_scale, input_zero, this->hidden_scale);
+   this->output_layer.quantize(network.output_layer, this->hidden_scale, 0, 1.0f);
+   return;
+}
+
+/********************************************************************************
+* workspace: Returnerar en arbetsyta med buffertar anpassade fr angivet
+*            kvantiserat ntverk, dr utfyllnaden efter indatan samt det
+*            dolda lagrets utdata r nollstlld. Eftersom motsvarande vikter
+*            r noll pverkar utfyllnaden inte summorna.
+********************************************************************************/
+template <typename T>
+quantized_workspace quantized_ann<T>::workspace(void) const
+{
+   quantized_workspace workspace;
+   workspace.input.assign(this->hidden_layer.stride, 0);
+   workspace.hidden.assign(this->output_layer.stride, 0);
+   return workspace;
+}
+
+/********************************************************************************
+* predict: Genomfr kvantiserad prediktion fr angiven kombination av indata
+*          och returnerar predikterad utdata. En ny arbetsyta allokeras vid
+*          varje anrop, se vriga versioner fr prediktion utan allokering.
+*
+*          - input: Vektor innehllande den kombination av indata som
+*                   prediktion skall ske utefter.
+********************************************************************************/
+template <typename T>
+std::vector<T> quantized_ann<T>::predict(const std::vector<T>& input) const
+{
+   auto workspace = this->workspace();
+   std::vector<T> output(this->num_outputs());
+   this->predict(input.data(), input.size(), output.data(), workspace);
+   return output;
+}
+
+/********************************************************************************
+* predict: Genomfr kvantiserad prediktion fr angiven kombination av indata
+*          och skriver predikterad utdata till angiven buffert. Indatan
+*          kvantiseras till 8-bitars heltal, varefter varje nod i det dolda
+*          lagret berknas som en heltalsskalrprodukt som omvandlas,
+*          begrnsas till [0, 255] (ReLU) och lagras som 8-bitars heltal i
+*          ett och samma steg. Indata som saknas tolkas som noll.
+*          Utgngslagret berknas p samma stt men omvandlas till flyttal.
+*
+*          - input     : Pekare till den kombination av indata som
+*                        prediktion skall ske utefter.
+*          - num_inputs: Antalet element i indatan.
+*          - output    : Pekare till buffert med plats fr ett element per
+*                        nod i utgngslagret.
+*          - workspace : Arbetsyta fr kvantiserad indata samt utdata frn
+*                        det dolda lagret.
+********************************************************************************/
+template <typename T>
+void quantized_ann<T>::predict(const T* input,
+                               const std::size_t num_inputs,
+                               T* output,
+                               quantized_workspace& workspace) const
+{
+   if (workspace.input.size() != this->hidden_layer.stride || workspace.hidden.size() != this->output_layer.stride)
+   {
+      workspace = this->workspace();
+   }
+
+   const auto inverse_scale = 1.0f / this->input_scale;
+   const auto count = std::min(num_inputs, this->num_inputs());
+
+   for (std::size_t j = 0; j < count; ++j)
+   {
+      workspace.input[j] = static_cast<std::uint8_t>(to_int8(static_cast<float>(input[j]) * inverse_scale) + input_zero);
+   }
+
+   std::fill(workspace.input.begin() + count, workspace.input.begin() + this->num_inputs(), input_zero);
+
+   for (std::size_t i = 0; i < this->num_hidden(); ++i)
+   {
+      const auto sum = simd::dot_u8i8(workspace.input.data(), this->hidden_layer[i], this->hidden_layer.stride) +
+         this->hidden_layer.correction[i];
+      const auto value = sum * this->hidden_layer.multiplier[i] + this->hidden_layer.offset[i];
+      workspace.hidden[i] = value > 0 ? static_cast<std::uint8_t>(std::min(value + 0.5f, 255.0f)) : 0;
+   }
+
+   for (std::size_t i = 0; i < this->num_outputs(); ++i)
+   {
+      const auto sum = simd::dot_u8i8(workspace.hidden.data(), this->output_layer[i], this->output_layer.stride) +
+         this->output_layer.correction[i];
+      const auto value = sum * this->output_layer.multiplier[i] + this->output_layer.offset[i];
+      output[i] = value > 0 ? static_cast<T>(value) : 0;
+   }
+
+   return;
+}
+
+/********************************************************************************
+* predict: Genomfr kvantiserad prediktion fr samtliga rader i en radvis
+*          lagrad indatamatris och skriver predikterad utdata radvis till
+*          angiven utdatamatris. En arbetsyta allokeras en gng per anrop.
+*
+*          - input     : Pekare till indatamatrisen, som innehller
+*                        num_rows x num_inputs element.
+*          - num_rows  : Antalet rader i in- och utdatamatrisen.
+*          - num_inputs: Antalet element per rad i indatamatrisen.
+*          - output    : Pekare till utdatamatrisen, med plats fr
+*                        num_rows x num_outputs() element.
+********************************************************************************/
+template <typename T>
+void quantized_ann<T>::predict(const T* input,
+                               const std::size_t num_rows,
+                               const std::size_t num_inputs,
+                               T* output) const
+{
+   auto workspace = this->workspace();
+
+   for (std::size_t r = 0; r < num_rows; ++r)
+   {
+      this->predict(input + r * num_inputs, num_inputs, output + r * this->num_outputs(), workspace);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* compare: Jmfr kvantiserad prediktion mot angivet flyttalsntverk fr
+*          hgst num_rows trningsuppsttningar, som vljs med jmna
+*          mellanrum ur ntverkets trningsdata.
+*
+*          - network : Det flyttalsntverk som jmfrelsen sker mot.
+*          - num_rows: Maximalt antal uppsttningar (default = 1024).
+********************************************************************************/
+template <typename T>
+quantization_report quantized_ann<T>::compare(const ann<T>& network,
+                                              const std::size_t num_rows) const
+{
+   const auto input = sample(network, num_rows);
+   const auto num_inputs = network.train_data.num_inputs();
+   return this->compare(network, input.data(), num_inputs > 0 ? input.size() / num_inputs : 0, num_inputs);
+}
+
+/********************************************************************************
+* compare: Jmfr kvantiserad prediktion mot angivet flyttalsntverk fr
+*          samtliga rader i angiven indatamatris. Absolut avvikelse mts fr
+*          samtliga utdata. Klassificeringen anses densamma om strsta
+*          utsignal terfinns p samma nod, eller vid en enda utsignal, om
+*          bda ligger p samma sida om 0.5.
+*
+*          - network   : Det flyttalsntverk som jmfrelsen sker mot.
+*          - input     : Pekare till indatamatrisen, som innehller
+*                        num_rows x num_inputs element.
+*          - num_rows  : Antalet rader i indatamatrisen.
+*          - num_inputs: Antalet element per rad i indatamatrisen.
+********************************************************************************/
+template <typename T>
+quantization_report quantized_ann<T>::compare(const ann<T>& network,
+                                              const T* input,
+                                              const std::size_t num_rows,
+                                              const std::size_t num_inputs) const
+{
+   quantization_report report;
+   auto float_workspace = network.workspace();
+   auto workspace = this->workspace();
+   std::vector<T> expected(this->num_outputs()), actual(this->num_outputs());
+   std::size_t num_agreeing = 0;
+   double error_sum = 0;
+
+   for (std::size_t r = 0; r < num_rows; ++r)
+   {
+      network.predict(input + r * num_inputs, num_inputs, expected.data(), float_workspace);
+      this->predict(input + r * num_inputs, num_inputs, actual.data(), workspace);
+
+      for (std::size_t i = 0; i < this->num_outputs(); ++i)
+      {
+         const auto error = std::fabs(static_cast<double>(expected[i]) - actual[i]);
+         report.max_error = std::max(report.max_error, error);
+         error_sum += error;
+      }
+
+      if (this->num_outputs() == 1)
+      {
+         if ((expected[0] >= T(0.5)) == (actual[0] >= T(0.5))) num_agreeing++;
+      }
+      else if (argmax(expected.data(), expected.size()) == argmax(actual.data(), actual.size()))
+      {
+         num_agreeing++;
+      }
+   }
+
+   report.num_rows = num_rows;
+   report.mean_error = num_rows > 0 && this->num_outputs() > 0 ? error_sum / (num_rows * this->num_outputs()) : 0;
+   report.agreement = num_rows > 0 ? static_cast<double>(num_agreeing) / num_rows : 1;
+   report.quantized_bytes = this->memory_size();
+
+   for (const auto* layer : { &network.hidden_layer, &network.output_layer })
+   {
+      report.float_bytes += (layer->weights.size() + layer->bias.size()) * sizeof(T);
+   }
+
+   return report;
+}
+
+/********************************************************************************
+* sample: Returnerar indata fr hgst num_rows trningsuppsttningar ur
+*         angivet ntverks trningsdata, valda med jmna mellanrum och
+*         lagrade radvis i en sammanhngande vektor.
+*
+*         - network : Det ntverk vars trningsdata anvnds.
+*         - num_rows: Maximalt antal uppsttningar.
+********************************************************************************/
+template <typename T>
+std::vector<T> quantized_ann<T>::sample(const ann<T>& network,
+                                        const std::size_t num_rows)
+{
+   const auto& data = network.train_data;
+   const auto count = std::min(num_rows, data.num_sets());
+   std::vector<T> rows(count * data.num_inputs());
+
+   for (std::size_t r = 0; r < count; ++r)
+   {
+      const auto* input = data.input(r * data.num_sets() / count);
+      std::copy(input, input + data.num_inputs(), rows.begin() + r * data.num_inputs());
+   }
+
+   return rows;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template void quantized_layer::quantize<float>(const dense_layer<float>&, const float, const std::int32_t, const float);
+template void quantized_layer::quantize<double>(const dense_layer<double>&, const float, const std::int32_t, const float);
+template struct quantized_ann<float>;
+template struct quantized_ann<double>;
@@ -0,0 +1,154 @@
+/********************************************************************************
+* quantized_ann.hpp: Kvantiserad prediktion fr trnade neurala ntverk, dr
+*                    vikter samt indata och utdata frn det dolda lagret
+*                    lagras som 8-bitars heltal. Minnestgngen fr vikterna
+*                    blir drmed en fjrdedel jmfrt med float och en
+*                    ttondel jmfrt med double, och skalrprodukterna
+*                    berknas med heltalsinstruktioner (AVX-512 VNNI om
+*                    processorn stdjer det) som behandlar fyra till tta
+*                    gnger fler element per instruktion.
+********************************************************************************/
+#ifndef QUANTIZED_ANN_HPP_
+#define QUANTIZED_ANN_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <cstdint>
+#include "ann.hpp"
+
+/********************************************************************************
+* quantized_layer: Kvantiserat dense-lager, dr vikterna lagras radvis som
+*                  8-bitars heltal med en skalfaktor per rad (nod). Varje rad
+*                  fylls ut med nollor till en multipel av en cache-line.
+*                  Indatan lagras som 8-bitars heltal utan tecken med en
+*                  nollpunkt, vars bidrag till heltalssumman tas bort exakt
+*                  via correction[i]. Summan fr nod i omvandlas drefter
+*                  till lagrets utdata via
+*                  (sum + correction[i]) * multiplier[i] + offset[i], dr
+*                  multiplikatorn inkluderar skalfaktorerna fr bde indata
+*                  och vikter.
+********************************************************************************/
+struct quantized_layer
+{
+   /* Medlemmar: */
+   std::vector<std::int8_t, aligned_allocator<std::int8_t>> weights; /* Kvantiserade vikter inklusive utfyllnad. */
+   std::vector<float> multiplier;                                    /* Omvandlingsfaktor per nod. */
+   std::vector<float> offset;                                        /* Skalad bias per nod. */
+   std::vector<std::int32_t> correction;                             /* Korrigering fr indatans nollpunkt per nod. */
+   std::size_t num_weights = 0;                                      /* Antalet vikter per nod. */
+   std::size_t stride = 0;                                           /* Antalet element per rad inklusive utfyllnad. */
+
+   /* Medlemsfunktioner: */
+   quantized_layer(void) { }
+   std::size_t num_nodes(void) const { return this->multiplier.size(); }
+   const std::int8_t* operator[](const std::size_t row) const { return this->weights.data() + row * this->stride; }
+   std::size_t memory_size(void) const;
+
+   template <typename T>
+   void quantize(const dense_layer<T>& layer,
+                 const float input_scale,
+                 const std::int32_t input_zero,
+                 const float output_scale);
+
+   static std::size_t padded(const std::size_t size) { return (size + 63) / 64 * 64; }
+};
+
+/********************************************************************************
+* quantized_workspace: Buffertar fr kvantiserad indata samt utdata frn det
+*                      dolda lagret vid prediktion via quantized_ann. Varje
+*                      trd br ha en egen arbetsyta, som med frdel
+*                      allokeras en gng via quantized_ann::workspace.
+********************************************************************************/
+struct quantized_workspace
+{
+   /* Medlemmar: */
+   std::vector<std::uint8_t, aligned_allocator<std::uint8_t>> input;  /* Kvantiserad indata. */
+   std::vector<std::uint8_t, aligned_allocator<std::uint8_t>> hidden; /* Kvantiserad utdata frn det dolda lagret. */
+};
+
+/********************************************************************************
+* quantization_report: Jmfrelse mellan prediktion med ett kvantiserat
+*                      ntverk och motsvarande flyttalsntverk.
+********************************************************************************/
+struct quantization_report
+{
+   /* Medlemmar: */
+   std::size_t num_rows = 0;        /* Antalet jmfrda uppsttningar. */
+   double max_error = 0;            /* Strsta absoluta avvikelse. */
+   double mean_error = 0;           /* Genomsnittlig absolut avvikelse. */
+   double agreement = 1;            /* Andel uppsttningar med samma klassificering. */
+   std::size_t float_bytes = 0;     /* Minnestgng fr flyttalsntverkets parametrar. */
+   std::size_t quantized_bytes = 0; /* Minnestgng fr det kvantiserade ntverket. */
+
+   /* Medlemsfunktioner: */
+   void print(std::ostream& ostream = std::cout) const;
+};
+
+/********************************************************************************
+* quantized_ann: Kvantiserad kopia av ett trnat neuralt ntverk av typen ann,
+*                avsedd enbart fr prediktion. Vikterna kvantiseras
+*                symmetriskt med en skalfaktor per nod, medan skalfaktorerna
+*                fr indata samt utdata frn det dolda lagret kalibreras via
+*                strsta absoluta vrde fr ett urval av ntverkets
+*                trningsdata. Indatan kvantiseras symmetriskt till
+*                [-127, 127] och frskjuts med nollpunkten 128, s att den
+*                kan lagras utan tecken. ReLU i det dolda lagret utfrs i
+*                samma steg som omvandlingen till 8-bitars heltal, dr
+*                negativa summor avrundas till noll, vilket medfr att hela
+*                intervallet [0, 255] kan anvndas utan nollpunkt. Utdata
+*                frn utgngslagret returneras som flyttal av typen T.
+*
+*                Ntverket modifieras inte vid prediktion, vilket medfr att
+*                flera trdar kan anvnda samma ntverk samtidigt, s lnge
+*                var och en har en egen arbetsyta.
+********************************************************************************/
+template <typename T = double>
+struct quantized_ann
+{
+   /* Medlemmar: */
+   static constexpr std::int32_t input_zero = 128; /* Nollpunkt fr kvantiserad indata. */
+   quantized_layer hidden_layer;                   /* Kvantiserat dolt lager. */
+   quantized_layer output_layer;                   /* Kvantiserat utgngslager. */
+   float input_scale = 1;                          /* Skalfaktor fr indata. */
+   float hidden_scale = 1;                         /* Skalfaktor fr utdata frn det dolda lagret. */
+
+   /* Medlemsfunktioner: */
+   quantized_ann(void) { }
+   explicit quantized_ann(const ann<T>& network,
+                          const std::size_t num_calibration = 1024);
+
+   std::size_t num_inputs(void) const { return this->hidden_layer.num_weights; }
+   std::size_t num_hidden(void) const { return this->hidden_layer.num_nodes(); }
+   std::size_t num_outputs(void) const { return this->output_layer.num_nodes(); }
+   std::size_t memory_size(void) const { return this->hidden_layer.memory_size() + this->output_layer.memory_size(); }
+
+   void quantize(const ann<T>& network,
+                 const std::size_t num_calibration = 1024);
+   void quantize(const ann<T>& network,
+                 const T* calibration,
+                 const std::size_t num_rows,
+                 const std::size_t num_inputs);
+
+   quantized_workspace workspace(void) const;
+   std::vector<T> predict(const std::vector<T>& input) const;
+   void predict(const T* input,
+                const std::size_t num_inputs,
+                T* output,
+                quantized_workspace& workspace) const;
+   void predict(const T* input,
+                const std::size_t num_rows,
+                const std::size_t num_inputs,
+                T* output) const;
+
+   quantization_report compare(const ann<T>& network,
+                               const std::size_t num_rows = 1024) const;
+   quantization_report compare(const ann<T>& network,
+                               const T* input,
+                               const std::size_t num_rows,
+                               const std::size_t num_inputs) const;
+
+private:
+   static std::vector<T> sample(const ann<T>& network,
+                                const std::size_t num_rows);
+};
+
+#endif /* QUANTIZED_ANN_HPP_ */
@@ -0,0 +1,77 @@
+/********************************************************************************
+* rng.cpp: Definition av funktionsmedlemmar tillhrande strukten rng fr
+*          generering av slumptal.
+********************************************************************************/
+#include "rng.hpp"
+
+/********************************************************************************
+* bounded: Returnerar ett likformigt frdelat heltal i intervallet
+*          [0, bound - 1]. Tal under trskeln 2^64 mod bound frkastas, s att
+*          samtliga vrden blir exakt lika sannolika, till skillnad frn
+*          rand() % bound som gynnar lga vrden. Returnerar 0 om bound r 0.
+*
+*          - bound: vre grns (exklusive) fr det genererade talet.
+********************************************************************************/
+std::uint64_t rng::bounded(const std::uint64_t bound)
+{
+   if (bound == 0) return 0;
+   const auto threshold = (0 - bound) % bound;
+   auto value = this->next();
+
+   while (value < threshold)
+   {
+      value = this->next();
+   }
+
+   return value % bound;
+}
+
+/********************************************************************************
+* fill: Fyller angiven buffert med likformigt frdelade flyttal i intervallet
+*       [0, 1), vilket motsvarar size anrop av uniform. Eftersom varje tal
+*       berknas direkt ur sin rknare saknar loopen beroenden mellan
+*       iterationerna och kan vektoriseras.
+*
+*       - data: Pekare till buffertens frsta element.
+*       - size: Antalet element som skall tilldelas.
+********************************************************************************/
+template <typename T>
+void rng::fill(T* data,
+               const std::size_t size)
+{
+   const auto first = this->counter;
+
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      data[i] = to_unit<T>(this->at(first + i));
+   }
+
+   this->counter += size;
+   return;
+}
+
+/********************************************************************************
+* shuffle: Randomiserar ordningen p elementen i angiven buffert via
+*          Fisher-Yates, dr element i byts mot ett likformigt valt element
+*          p index [0, i]. Samtliga permutationer blir drmed lika sannolika.
+*
+*          - data: Pekare till buffertens frsta element.
+*          - size: Antalet element i bufferten.
+********************************************************************************/
+void rng::shuffle(std::size_t* data,
+                  const std::size_t size)
+{
+   for (std::size_t i = size; i > 1; --i)
+   {
+      const auto r = this->bounded(i);
+      const auto temp = data[i - 1];
+      data[i - 1] = data[r];
+      data[r] = temp;
+   }
+
+   return;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template void rng::fill<float>(float*, const std::size_t);
+template void rng::fill<double>(double*, const std::size_t);
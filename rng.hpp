@@ -0,0 +1,88 @@
+/********************************************************************************
+* rng.hpp: Rknarbaserad slumptalsgenerator fr initiering av parametrar samt
+*          randomisering av trningsdata i neurala ntverk. Till skillnad frn
+*          std::rand har varje ntverk en egen generator med eget startvrde,
+*          vilket medfr att krningar kan terskapas exakt oavsett plattform
+*          och att flera ntverk kan trnas i olika trdar samtidigt.
+********************************************************************************/
+#ifndef RNG_HPP_
+#define RNG_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <cstddef>
+#include <cstdint>
+
+/********************************************************************************
+* rng: Rknarbaserad slumptalsgenerator enligt SplitMix64, dr det n:e talet
+*      berknas direkt ur en nyckel samt rknaren n utan beroende till
+*      tidigare tal. Nyckeln hrleds ur angivet startvrde samt ett
+*      strmnummer, s att varje trd eller epok kan tilldelas en egen
+*      oberoende strm via split. Vid split hrleds barnets nyckel genom att
+*      frlderns nyckel blandas med barnets index, vilket medfr att olika
+*      vgar av split, exempelvis split(1) och split(0).split(0), ger olika
+*      strmmar. Eftersom varje tal berknas oberoende av vriga kan lngre
+*      sekvenser, exempelvis vid initiering av vikter via fill, vektoriseras
+*      av kompilatorn.
+********************************************************************************/
+struct rng
+{
+   /* Medlemmar: */
+   static constexpr std::uint64_t default_seed = 1; /* Startvrde som anvnds som default. */
+   std::uint64_t seed;                              /* Startvrde fr generatorn. */
+   std::uint64_t stream;                            /* Strmnummer, vid split index hos frldern. */
+   std::uint64_t key;                               /* Nyckel hrledd ur startvrde och strm. */
+   std::uint64_t counter;                           /* Antalet hittills genererade tal. */
+
+   /* Medlemsfunktioner: */
+   explicit rng(const std::uint64_t seed = default_seed,
+                const std::uint64_t stream = 0)
+      : seed(seed), stream(stream), key(mix(mix(seed) + stream * gamma)), counter(0) { }
+
+   rng split(const std::uint64_t stream) const
+   {
+      rng child(this->seed, stream);
+      child.key = mix(this->key ^ mix((stream + 1) * gamma));
+      return child;
+   }
+
+   std::uint64_t at(const std::uint64_t index) const { return mix(this->key + (index + 1) * gamma); }
+   std::uint64_t next(void) { return this->at(this->counter++); }
+   std::uint64_t operator()(void) { return this->next(); }
+
+   std::uint64_t bounded(const std::uint64_t bound);
+   template <typename T>
+   T uniform(void) { return to_unit<T>(this->next()); }
+   template <typename T>
+   void fill(T* data,
+             const std::size_t size);
+   void shuffle(std::size_t* data,
+                const std::size_t size);
+
+   /****************************************************************************
+   * to_unit: Omvandlar angivet 64-bitars slumptal till ett flyttal i
+   *          intervallet [0, 1) via de mest signifikanta bitarna, dvs. 53
+   *          bitar fr double och 24 bitar fr float.
+   ****************************************************************************/
+   template <typename T>
+   static T to_unit(const std::uint64_t value)
+   {
+      constexpr int bits = sizeof(T) == sizeof(float) ? 24 : 53;
+      return static_cast<T>(value >> (64 - bits)) * (static_cast<T>(1) / static_cast<T>(std::uint64_t(1) << bits));
+   }
+
+   /****************************************************************************
+   * mix: Blandar bitarna i angivet vrde via SplitMix64:s slutsteg, vilket r
+   *      en bijektion dr varje indatabit pverkar samtliga utdatabitar.
+   ****************************************************************************/
+   static std::uint64_t mix(std::uint64_t value)
+   {
+      value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+      value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+      return value ^ (value >> 31);
+   }
+
+private:
+   static constexpr std::uint64_t gamma = 0x9e3779b97f4a7c15ull; /* Steglngd (gyllene snittet). */
+};
+
+#endif /* RNG_HPP_ */
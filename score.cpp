@@ -0,0 +1,574 @@
+/********************************************************************************
+* score.cpp: Prediktion i stora batcher fr samtliga rader i en indatafil med
+*            ett trnat ntverk sparat via ann::save, dr resultatet skrivs
+*            som CSV med en rad per indatarad. Inlsning, prediktion samt
+*            formatering utfrs i var sitt steg i en pipeline, dr varje steg
+*            krs i en egen trd och arbetar p ett eget block av rader, s
+*            att tolkning av nsta block och formatering av fregende block
+*            verlappar med prediktionen. Ett fast antal block teranvnds
+*            mellan stegen, s att ingen minnesallokering sker nr blocken
+*            vl har ntt sin strsta storlek.
+*
+*            Text tolkas via std::from_chars och formateras via
+*            std::to_chars direkt i blockets buffert, utan strmmar eller
+*            locale, varefter hela blocket skrivs med ett enda anrop.
+*            Indata lses antingen som CSV, dr de frsta num_inputs vrdena
+*            p varje rad anvnds och vrden separeras med kommatecken,
+*            semikolon eller blanksteg, eller som binrfil skriven via
+*            dataset::save, som minnesmappas. Formatet avgrs av filens
+*            inledande signatur. Flyttalstypen avgrs av modellfilen.
+*            Tomma rader samt en inledande rubrikrad utan tolkningsbara
+*            vrden hoppas ver. Fr vriga rader dr ett vrde inte kan
+*            tolkas skrivs en rad med tomma flt, s att utdatan fortsatt
+*            motsvarar indatan rad fr rad, och radnumret redovisas. Vid
+*            avslut redovisas antalet rader per sekund, antalet felaktiga
+*            samt verhoppade rader och tiden som respektive steg har arbetat.
+*
+*            Bygg och kr via CMake enligt fljande:
+*            $ cmake -S . -B build
+*            $ cmake --build build --target score
+*            $ ./build/score --model model.bin --input data.csv --output out.csv
+*
+*            Tillgngliga argument:
+*            --model <fil>       : Modellfil sparad via ann::save.
+*            --input <fil>       : Indatafil som CSV eller binrfil.
+*            --output <fil>      : Utdatafil, annars skrivs resultatet till
+*                                  standardutenheten.
+*            --batch <antal>     : Antalet rader per block vid binr indata
+*                                  (default = 4096).
+*            --block <byte>      : Antalet byte text per block vid CSV
+*                                  (default = 4194304).
+*            --threads <antal>   : Antalet trdar vid prediktion, 0 = en per
+*                                  processorkrna (default = 1).
+*            --precision <antal> : Antalet signifikanta siffror, annars
+*                                  skrivs kortast mjliga exakta vrde.
+********************************************************************************/
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ann.hpp"
+
+namespace
+{
+/********************************************************************************
+* options: Instllningar angivna via kommandoraden.
+********************************************************************************/
+struct options
+{
+   std::string model;                /* Modellfil. */
+   std::string input;                /* Indatafil. */
+   std::string output;               /* Utdatafil, tom fr standardutenheten. */
+   std::size_t batch_size = 4096;    /* Antalet rader per block vid binr indata. */
+   std::size_t block_size = 1 << 22; /* Antalet byte text per block vid CSV. */
+   std::size_t num_threads = 1;      /* Antalet trdar vid prediktion. */
+   int precision = 0;                /* Antalet signifikanta siffror, 0 = kortast exakta. */
+};
+
+/********************************************************************************
+* chunk: Block av rader som passerar genom pipelinen, dr texten innehller
+*        inlst CSV vid tolkning och formaterad utdata vid skrivning.
+********************************************************************************/
+template <typename T>
+struct chunk
+{
+   /* Medlemmar: */
+   std::vector<char> text; /* Inlst eller formaterad text. */
+   std::vector<T> input;   /* Tolkad indata, num_inputs element per rad. */
+   std::vector<T> output;  /* Predikterad utdata, num_outputs element per rad. */
+   std::vector<char> bad;  /* Anger fr respektive rad om indatan inte kunde tolkas. */
+   std::size_t rows = 0;   /* Antalet rader i blocket. */
+};
+
+/********************************************************************************
+* csv_position: Position vid tolkning av CSV, som sparas mellan blocken.
+********************************************************************************/
+struct csv_position
+{
+   std::vector<char> carry;   /* Ofullstndig rad frn fregende block. */
+   std::size_t line = 0;      /* Antalet tolkade rader i filen, inklusive tomma. */
+   std::size_t skipped = 0;   /* Antalet verhoppade tomma rader samt rubrikrader. */
+   std::size_t malformed = 0; /* Antalet rader dr ett vrde inte kunde tolkas. */
+   bool has_data = false;     /* Indikerar ifall ngon rad med vrden har lsts. */
+};
+
+/********************************************************************************
+* channel: K av block mellan tv steg i pipelinen, dr en nollpekare
+*          signalerar att fregende steg r klart. Mottagaren vntar via en
+*          villkorsvariabel tills ett block finns tillgngligt.
+********************************************************************************/
+template <typename T>
+struct channel
+{
+   /* Medlemmar: */
+   std::deque<chunk<T>*> items;       /* Block som vntar p nsta steg. */
+   std::mutex mutex;                  /* Skyddar items. */
+   std::condition_variable condition; /* Signalerar nya block. */
+
+   /* Medlemsfunktioner: */
+   void push(chunk<T>* item)
+   {
+      {
+         std::lock_guard<std::mutex> lock(this->mutex);
+         this->items.push_back(item);
+      }
+
+      this->condition.notify_one();
+      return;
+   }
+
+   chunk<T>* pop(void)
+   {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->condition.wait(lock, [this] { return !this->items.empty(); });
+      auto* item = this->items.front();
+      this->items.pop_front();
+      return item;
+   }
+};
+
+/********************************************************************************
+* stopwatch: Summerar tiden som ett steg i pipelinen arbetar, exklusive
+*            vntan p block frn vriga steg.
+********************************************************************************/
+struct stopwatch
+{
+   /* Medlemmar: */
+   std::chrono::steady_clock::time_point start; /* Starttid fr pgende mtning. */
+   double seconds = 0;                          /* Summerad tid i sekunder. */
+
+   /* Medlemsfunktioner: */
+   void resume(void) { this->start = std::chrono::steady_clock::now(); }
+   void pause(void)
+   {
+      this->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+   }
+};
+
+/********************************************************************************
+* is_separator: Indikerar ifall angivet tecken separerar vrden i CSV.
+*
+*               - c: Tecknet som kontrolleras.
+********************************************************************************/
+bool is_separator(const char c)
+{
+   return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r';
+}
+
+/********************************************************************************
+* parse_csv: Tolkar samtliga hela rader i angiven text och lgger till dem i
+*            blockets indata, dr de frsta num_inputs vrdena p varje rad
+*            anvnds och saknade vrden stts till 0. Tomma rader samt en
+*            rubrikrad fre den frsta raden med vrden hoppas ver. En rad
+*            dr ett vrde inte kan tolkas lagras med nollor och markeras
+*            som felaktig, varvid radnumret redovisas fr de frsta
+*            max_reports raderna. Returnerar antalet lagrade rader.
+*
+*            - first     : Pekare till textens brjan.
+*            - last      : Pekare till textens slut.
+*            - num_inputs: Antalet element indata per rad.
+*            - position  : Position i filen, som rknas upp.
+*            - block     : Block dr tolkad indata lagras.
+********************************************************************************/
+template <typename T>
+std::size_t parse_csv(const char* first,
+                      const char* last,
+                      const std::size_t num_inputs,
+                      csv_position& position,
+                      chunk<T>& block)
+{
+   constexpr std::size_t max_reports = 10;
+   std::size_t rows = 0;
+
+   while (first < last)
+   {
+      const auto* end = static_cast<const char*>(std::memchr(first, '\n', last - first));
+      if (!end) end = last;
+      const auto offset = (block.rows + rows) * num_inputs;
+      if (block.input.size() < offset + num_inputs) block.input.resize(2 * (offset + num_inputs));
+      auto* row = block.input.data() + offset;
+      std::size_t num_values = 0;
+      bool bad = false;
+      ++position.line;
+
+      while (num_values < num_inputs)
+      {
+         while (first < end && is_separator(*first)) ++first;
+         if (first == end) break;
+         const auto result = std::from_chars(first, end, row[num_values]);
+
+         if (result.ec != std::errc() || (result.ptr < end && !is_separator(*result.ptr)))
+         {
+            bad = true;
+            break;
+         }
+
+         first = result.ptr;
+         ++num_values;
+      }
+
+      if (num_values == 0 && (!bad || !position.has_data))
+      {
+         position.skipped++;
+      }
+      else
+      {
+         if (bad && position.malformed++ < max_reports)
+         {
+            std::cerr << "Line " << position.line << ": could not parse value, writing an empty row.\n";
+         }
+
+         std::fill(bad ? row : row + num_values, row + num_inputs, 0);
+         block.bad.push_back(bad);
+         position.has_data = true;
+         ++rows;
+      }
+
+      first = end + 1;
+   }
+
+   return rows;
+}
+
+/********************************************************************************
+* read_csv: Lser in nsta block text frn angiven fil till angivet block och
+*           tolkar samtliga hela rader. En ofullstndig sista rad sparas i
+*           positionens carry och placeras frst i nsta block. Om en
+*           enskild rad inte ryms i blocket frdubblas blockets storlek.
+*           Returnerar false nr filen r slut och samtliga rader har
+*           tolkats.
+*
+*           - file      : Filen som lses.
+*           - block_size: Antalet byte text per block.
+*           - num_inputs: Antalet element indata per rad.
+*           - position  : Position i filen, inklusive ofullstndig rad frn
+*                         fregende block.
+*           - block     : Block dr tolkad indata lagras.
+********************************************************************************/
+template <typename T>
+bool read_csv(std::ifstream& file,
+              const std::size_t block_size,
+              const std::size_t num_inputs,
+              csv_position& position,
+              chunk<T>& block)
+{
+   auto& carry = position.carry;
+   block.rows = 0;
+   block.bad.clear();
+
+   while (block.rows == 0)
+   {
+      if (!file && carry.empty()) return false;
+      block.text.resize(std::max(block_size, 2 * carry.size()));
+      std::copy(carry.begin(), carry.end(), block.text.begin());
+      std::size_t size = carry.size();
+
+      if (file)
+      {
+         file.read(block.text.data() + size, block.text.size() - size);
+         size += static_cast<std::size_t>(file.gcount());
+      }
+
+      const auto* first = block.text.data();
+      const auto* last = first + size;
+
+      if (file)
+      {
+         const auto* end = first + size;
+         while (end > first && end[-1] != '\n') --end;
+         carry.assign(end, last);
+         last = end;
+      }
+      else
+      {
+         carry.clear();
+      }
+
+      block.rows += parse_csv(first, last, num_inputs, position, block);
+   }
+
+   return true;
+}
+
+/********************************************************************************
+* read_binary: Kopierar indatan fr nsta batch rader frn angiven
+*              minnesmappad datamngd till angivet block. Returnerar false
+*              nr samtliga rader har kopierats.
+*
+*              - data      : Minnesmappad datamngd.
+*              - next      : Index fr nsta rad, som rknas upp.
+*              - batch_size: Antalet rader per block.
+*              - num_inputs: Antalet element indata per rad i blocket.
+*              - block     : Block dr indatan lagras.
+********************************************************************************/
+template <typename T>
+bool read_binary(const dataset<T>& data,
+                 std::size_t& next,
+                 const std::size_t batch_size,
+                 const std::size_t num_inputs,
+                 chunk<T>& block)
+{
+   block.rows = std::min(batch_size, data.num_sets() - next);
+   if (block.rows == 0) return false;
+   block.bad.assign(block.rows, 0);
+   if (block.input.size() < block.rows * num_inputs) block.input.resize(block.rows * num_inputs);
+
+   for (std::size_t r = 0; r < block.rows; ++r)
+   {
+      const auto* source = data.input(next + r);
+      std::copy(source, source + num_inputs, block.input.data() + r * num_inputs);
+   }
+
+   next += block.rows;
+   return true;
+}
+
+/********************************************************************************
+* format: Formaterar blockets predikterade utdata som CSV i blockets
+*         textbuffert via std::to_chars, med en rad per indatarad och vrden
+*         separerade med kommatecken. Fr felaktiga rader skrivs tomma flt.
+*         Returnerar antalet skrivna tecken.
+*
+*         - block      : Block innehllande predikterad utdata.
+*         - num_outputs: Antalet element utdata per rad.
+*         - precision  : Antalet signifikanta siffror, 0 = kortast exakta.
+********************************************************************************/
+template <typename T>
+std::size_t format(chunk<T>& block,
+                   const std::size_t num_outputs,
+                   const int precision)
+{
+   const std::size_t max_chars = 32 + static_cast<std::size_t>(precision);
+   block.text.resize(std::max(block.text.size(), block.rows * num_outputs * max_chars + 1));
+   auto* first = block.text.data();
+   auto* const last = first + block.text.size();
+   const auto* value = block.output.data();
+
+   for (std::size_t r = 0; r < block.rows; ++r)
+   {
+      if (block.bad[r])
+      {
+         for (std::size_t k = 0; k < num_outputs; ++k)
+         {
+            *first++ = k + 1 < num_outputs ? ',' : '\n';
+         }
+
+         value += num_outputs;
+         continue;
+      }
+
+      for (std::size_t k = 0; k < num_outputs; ++k, ++value)
+      {
+         const auto result = precision > 0 ? std::to_chars(first, last, *value, std::chars_format::general, precision)
+                                           : std::to_chars(first, last, *value);
+         first = result.ptr;
+         *first++ = k + 1 < num_outputs ? ',' : '\n';
+      }
+   }
+
+   return static_cast<std::size_t>(first - block.text.data());
+}
+
+/********************************************************************************
+* run: Lser in ntverket samt indatafilen och kr pipelinen, dr inlsning
+*      och tolkning sker i en trd, prediktion i en annan och formatering
+*      samt skrivning i anropande trd. Fyra block cirkulerar mellan stegen,
+*      s att varje steg kan arbeta p ett block medan nsta steg arbetar p
+*      fregende. Redovisar drefter antalet rader per sekund samt
+*      antalet felaktiga och verhoppade rader i CSV.
+*
+*      - settings: Instllningar angivna via kommandoraden.
+********************************************************************************/
+template <typename T>
+int run(const options& settings)
+{
+   ann<T> network;
+
+   if (!network.load(settings.model))
+   {
+      std::cerr << "Could not load " << settings.model << "!\n";
+      return 1;
+   }
+
+   const auto num_inputs = network.num_inputs();
+   const auto num_outputs = network.num_outputs();
+   dataset<T> data;
+   std::ifstream file;
+   char magic[8] = {};
+   file.open(settings.input, std::ios::binary);
+   file.read(magic, sizeof(magic));
+   const bool binary = file.gcount() == static_cast<std::streamsize>(sizeof(magic)) && std::memcmp(magic, "ANNDATA", 8) == 0;
+   file.clear();
+   file.seekg(0);
+
+   if (!file || (binary && (!data.load(settings.input) || data.num_inputs() < num_inputs)))
+   {
+      std::cerr << "Could not read " << settings.input << " as input for a network with "
+                << num_inputs << " inputs!\n";
+      return 1;
+   }
+
+   std::ofstream output_file;
+
+   if (!settings.output.empty())
+   {
+      output_file.open(settings.output, std::ios::binary);
+
+      if (!output_file)
+      {
+         std::cerr << "Could not open " << settings.output << "!\n";
+         return 1;
+      }
+   }
+
+   std::ios::sync_with_stdio(false);
+   auto& ostream = settings.output.empty() ? std::cout : static_cast<std::ostream&>(output_file);
+   std::vector<chunk<T>> blocks(4);
+   channel<T> available, parsed, predicted;
+   stopwatch parse_time, predict_time, format_time;
+   std::size_t num_rows = 0;
+
+   for (auto& i : blocks)
+   {
+      available.push(&i);
+   }
+
+   const auto start = std::chrono::steady_clock::now();
+
+   csv_position position;
+
+   std::thread parser([&]
+   {
+      std::size_t next = 0;
+
+      while (auto* block = available.pop())
+      {
+         parse_time.resume();
+         const bool more = binary ? read_binary(data, next, settings.batch_size, num_inputs, *block)
+                                  : read_csv(file, settings.block_size, num_inputs, position, *block);
+         parse_time.pause();
+
+         if (!more)
+         {
+            parsed.push(nullptr);
+            break;
+         }
+
+         parsed.push(block);
+      }
+   });
+
+   std::thread predictor([&]
+   {
+      while (auto* block = parsed.pop())
+      {
+         predict_time.resume();
+         if (block->output.size() < block->rows * num_outputs) block->output.resize(block->rows * num_outputs);
+         network.predict(block->input.data(), block->rows, num_inputs, block->output.data(), settings.num_threads);
+         predict_time.pause();
+         predicted.push(block);
+      }
+
+      predicted.push(nullptr);
+   });
+
+   while (auto* block = predicted.pop())
+   {
+      format_time.resume();
+      const auto size = format(*block, num_outputs, settings.precision);
+      ostream.write(block->text.data(), static_cast<std::streamsize>(size));
+      num_rows += block->rows;
+      format_time.pause();
+      available.push(block);
+   }
+
+   ostream.flush();
+   const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   available.push(nullptr);
+   parser.join();
+   predictor.join();
+
+   std::cerr << "Rows: " << num_rows << ", malformed: " << position.malformed << ", skipped: "
+             << position.skipped << ", seconds: " << seconds << ", rows/s: "
+             << (seconds > 0 ? num_rows / seconds : 0) << "\n"
+             << "Busy seconds - parse: " << parse_time.seconds << ", predict: " << predict_time.seconds
+             << ", format and write: " << format_time.seconds << "\n";
+   return ostream ? 0 : 1;
+}
+
+/********************************************************************************
+* value_size: Returnerar antalet byte per parameter i angiven modellfil
+*             enligt dess huvud, eller 0 om huvudet inte kunde lsas.
+*
+*             - filename: Skvg till modellfilen.
+********************************************************************************/
+std::uint32_t value_size(const std::string& filename)
+{
+   std::ifstream file(filename, std::ios::binary);
+   model_header header{};
+   if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return 0;
+   return header.value_size;
+}
+
+/********************************************************************************
+* parse: Lser in instllningar frn kommandoraden. Returnerar false vid
+*        oknt eller ofullstndigt argument.
+*
+*        - argc    : Antalet argument.
+*        - argv    : Argumenten.
+*        - settings: Struktur dr instllningarna lagras.
+********************************************************************************/
+bool parse(const int argc,
+           char** argv,
+           options& settings)
+{
+   for (int i = 1; i < argc; ++i)
+   {
+      const std::string arg = argv[i];
+      const bool has_value = i + 1 < argc;
+
+      if (arg == "--model" && has_value) settings.model = argv[++i];
+      else if (arg == "--input" && has_value) settings.input = argv[++i];
+      else if (arg == "--output" && has_value) settings.output = argv[++i];
+      else if (arg == "--batch" && has_value) settings.batch_size = std::strtoul(argv[++i], nullptr, 10);
+      else if (arg == "--block" && has_value) settings.block_size = std::strtoul(argv[++i], nullptr, 10);
+      else if (arg == "--threads" && has_value) settings.num_threads = std::strtoul(argv[++i], nullptr, 10);
+      else if (arg == "--precision" && has_value) settings.precision = std::atoi(argv[++i]);
+      else return false;
+   }
+
+   return !settings.model.empty() && !settings.input.empty() && settings.batch_size > 0 &&
+          settings.block_size > 0 && settings.precision >= 0;
+}
+}
+
+/********************************************************************************
+* main: Lser in instllningar frn kommandoraden och kr pipelinen med den
+*       flyttalstyp som modellfilen har sparats med.
+********************************************************************************/
+int main(int argc, char** argv)
+{
+   options settings;
+
+   if (!parse(argc, argv, settings))
+   {
+      std::cerr << "Usage: " << argv[0] << " --model <file> --input <file> [--output <file>] [--batch <n>]"
+                << " [--block <bytes>] [--threads <n>] [--precision <digits>]\n";
+      return 1;
+   }
+
+   const auto size = value_size(settings.model);
+   if (size == sizeof(float)) return run<float>(settings);
+   if (size == sizeof(double)) return run<double>(settings);
+   std::cerr << "Could not load " << settings.model << "!\n";
+   return 1;
+}
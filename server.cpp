@@ -0,0 +1,387 @@
+/********************************************************************************
+* server.cpp: Tjnst fr prediktion via en lokal Unix-socket, dr
+*             frfrgningar frn samtliga anslutningar samlas i mikrobatcher
+*             enligt inference_server.hpp. Kan ven kras som benchmark, dr
+*             ett antal klienttrdar skickar frfrgningar via socketen i tur
+*             och ordning och antalet besvarade frfrgningar per sekund,
+*             svarstider samt genomsnittlig batchstorlek redovisas, bde med
+*             angivna instllningar och utan batchning som jmfrelse.
+*             Ntverket ns via en model_handle, s att en ny version kan
+*             publiceras medan tjnsten krs, antingen genom att modellfilen
+*             lses in p nytt eller, vid benchmark, genom att en kopia av
+*             ntverket publiceras med jmna mellanrum.
+*
+*             Bygg och kr via CMake enligt fljande:
+*             $ cmake -S . -B build
+*             $ cmake --build build --target server
+*             $ ./build/server --bench 16 2000
+*
+*             Tillgngliga argument:
+*             --socket <skvg>       : Skvg till socketen
+*                                       (default = /tmp/ann_server.sock).
+*             --model <fil>           : Modellfil sparad via ann::save,
+*                                       annars anvnds ett slumpmssigt
+*                                       initierat ntverk.
+*             --width <antal>         : Antalet in-, dolda och utgngsnoder
+*                                       i det slumpmssiga ntverket
+*                                       (default = 256).
+*             --type float|double     : Flyttalstyp (default = double).
+*             --threads <antal>       : Antalet arbetstrdar, 0 = en per
+*                                       processorkrna (default = 1).
+*             --max-batch <antal>     : Strsta batchstorlek (default = 32).
+*             --max-delay <us>        : Lngsta vntan p fler frfrgningar
+*                                       i mikrosekunder (default = 200).
+*             --bench <klienter> <antal>: Kr benchmark med angivet antal
+*                                       klienter och frfrgningar per klient.
+*             --swap <ms>             : Publicerar en ny version av
+*                                       ntverket med angivet intervall
+*                                       under benchmark (default = 0, av).
+*
+*             Vid krning som tjnst lses modellfilen in och publiceras p
+*             nytt nr reload anges, medan en tom rad stoppar tjnsten.
+********************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "inference_server.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define SERVER_SOCKET 1
+#endif
+
+namespace
+{
+/********************************************************************************
+* options: Instllningar angivna via kommandoraden.
+********************************************************************************/
+struct options
+{
+   std::string path = "/tmp/ann_server.sock"; /* Skvg till socketen. */
+   std::string model;                         /* Modellfil, tom fr slumpmssigt ntverk. */
+   std::string type = "double";               /* Flyttalstyp. */
+   std::size_t width = 256;                   /* Bredd fr slumpmssigt ntverk. */
+   server_options server;                     /* Instllningar fr tjnsten. */
+   std::size_t num_clients = 0;               /* Antalet klienter vid benchmark, 0 = ingen. */
+   std::size_t num_requests = 0;              /* Antalet frfrgningar per klient. */
+   std::size_t swap_interval = 0;             /* Intervall fr utbyte av ntverket i ms, 0 = av. */
+};
+
+/********************************************************************************
+* latency: Resultat frn en benchmarkkrning.
+********************************************************************************/
+struct latency
+{
+   double rows_per_second = 0; /* Antalet besvarade frfrgningar per sekund. */
+   double p50 = 0;             /* Median fr svarstiden i mikrosekunder. */
+   double p99 = 0;             /* 99:e percentilen fr svarstiden i mikrosekunder. */
+   double mean_batch_size = 0; /* Genomsnittligt antal frfrgningar per mikrobatch. */
+   std::uint64_t versions = 0; /* Antalet publicerade versioner av ntverket. */
+};
+
+#ifdef SERVER_SOCKET
+/********************************************************************************
+* transfer: Lser eller skriver angivet antal byte via angiven socket i sin
+*           helhet. Returnerar false om anslutningen stngdes eller ett fel
+*           uppstod.
+*
+*           - connection: Ansluten socket.
+*           - data      : Pekare till bufferten.
+*           - size      : Antalet byte.
+*           - write     : Indikerar skrivning, annars lsning.
+********************************************************************************/
+bool transfer(const int connection,
+              void* data,
+              std::size_t size,
+              const bool write)
+{
+   auto* buffer = static_cast<char*>(data);
+
+   while (size > 0)
+   {
+      const auto count = write ? ::write(connection, buffer, size) : ::read(connection, buffer, size);
+      if (count <= 0) return false;
+      buffer += count;
+      size -= static_cast<std::size_t>(count);
+   }
+
+   return true;
+}
+
+/********************************************************************************
+* client: Ansluter till socketen p angiven skvg och skickar angivet antal
+*         frfrgningar i tur och ordning, dr svarstiden fr varje frfrgan
+*         lagras i mikrosekunder. Returnerar false om anslutningen eller ngon
+*         frfrgan misslyckades.
+*
+*         - path        : Skvg till socketen.
+*         - num_requests: Antalet frfrgningar som skall skickas.
+*         - generator   : Slumptalsgenerator fr slumpmssig indata, med en
+*                         egen strm per klient via rng::split.
+*         - latencies   : Vektor dr svarstiderna lagras.
+********************************************************************************/
+template <typename T>
+bool client(const std::string& path,
+            const std::size_t num_requests,
+            rng generator,
+            std::vector<double>& latencies)
+{
+   sockaddr_un address{};
+   address.sun_family = AF_UNIX;
+   std::copy(path.begin(), path.end(), address.sun_path);
+   const auto connection = ::socket(AF_UNIX, SOCK_STREAM, 0);
+   socket_header header{};
+
+   if (connection < 0) return false;
+
+   if (::connect(connection, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+       !transfer(connection, &header, sizeof(header), false) || header.value_size != sizeof(T))
+   {
+      ::close(connection);
+      return false;
+   }
+
+   std::vector<T> input(header.num_inputs), output(header.num_outputs);
+   bool success = true;
+
+   for (std::size_t i = 0; i < num_requests && success; ++i)
+   {
+      for (auto& j : input)
+      {
+         j = generator.uniform<T>();
+      }
+
+      const auto start = std::chrono::steady_clock::now();
+      success = transfer(connection, input.data(), input.size() * sizeof(T), true) &&
+                transfer(connection, output.data(), output.size() * sizeof(T), false);
+      latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+   }
+
+   ::close(connection);
+   return success;
+}
+
+/********************************************************************************
+* bench: Startar en tjnst med angivna instllningar, lter num_clients
+*        klienttrdar skicka frfrgningar via socketen och returnerar
+*        uppmtt genomstrmning, svarstider samt genomsnittlig batchstorlek.
+*        Om ett intervall fr utbyte har angivits publiceras en kopia av
+*        ntverket med detta intervall i en egen trd medan klienterna krs.
+*
+*        - network : Ntverk som anvnds fr prediktion.
+*        - settings: Instllningar fr benchmarken.
+*        - server  : Instllningar fr tjnsten.
+*        - result  : Struktur dr resultatet lagras.
+********************************************************************************/
+template <typename T>
+bool bench(const ann<T>& network,
+           const options& settings,
+           const server_options& server,
+           latency& result)
+{
+   model_handle<T> handle(model_handle<T>::snapshot(network));
+   inference_server<T> service(handle, server);
+   socket_frontend<T> frontend(service);
+   if (!frontend.open(settings.path)) return false;
+
+   std::atomic<bool> done{ false };
+   std::thread publisher([&]
+   {
+      while (settings.swap_interval > 0 && !done)
+      {
+         std::this_thread::sleep_for(std::chrono::milliseconds(settings.swap_interval));
+         handle.publish(network);
+      }
+   });
+
+   std::vector<std::vector<double>> latencies(settings.num_clients);
+   std::vector<char> success(settings.num_clients, 0);
+   std::vector<std::thread> clients;
+   const auto start = std::chrono::steady_clock::now();
+
+   for (std::size_t i = 0; i < settings.num_clients; ++i)
+   {
+      latencies[i].reserve(settings.num_requests);
+      clients.emplace_back([&, i] { success[i] = client<T>(settings.path, settings.num_requests, rng().split(i), latencies[i]); });
+   }
+
+   for (auto& i : clients)
+   {
+      i.join();
+   }
+
+   const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   done = true;
+   publisher.join();
+   frontend.close();
+   service.stop();
+
+   if (std::find(success.begin(), success.end(), 0) != success.end()) return false;
+
+   std::vector<double> all;
+
+   for (const auto& i : latencies)
+   {
+      all.insert(all.end(), i.begin(), i.end());
+   }
+
+   if (all.empty()) return false;
+   std::sort(all.begin(), all.end());
+   result.rows_per_second = all.size() / seconds;
+   result.p50 = all[all.size() / 2];
+   result.p99 = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+   result.mean_batch_size = service.stats().mean_batch_size();
+   result.versions = handle.version();
+   return true;
+}
+#endif /* SERVER_SOCKET */
+
+/********************************************************************************
+* run: Lser in eller skapar ntverket och kr drefter antingen benchmark,
+*      med angivna instllningar samt med batchstorlek 1 som jmfrelse,
+*      eller tjnsten tills anvndaren anger en tom rad, dr modellfilen lses
+*      in och publiceras p nytt nr anvndaren anger reload.
+*
+*      - settings: Instllningar angivna via kommandoraden.
+********************************************************************************/
+template <typename T>
+int run(const options& settings)
+{
+#ifdef SERVER_SOCKET
+   ann<T> network(settings.width, settings.width, settings.width);
+
+   if (!settings.model.empty() && !network.load(settings.model))
+   {
+      std::cerr << "Could not load " << settings.model << "!\n";
+      return 1;
+   }
+
+   std::cout << "Network: " << network.num_inputs() << "-" << network.num_hidden() << "-"
+             << network.num_outputs() << ", type: " << settings.type << "\n";
+
+   if (settings.num_clients == 0)
+   {
+      model_handle<T> handle(model_handle<T>::snapshot(network));
+      inference_server<T> service(handle, settings.server);
+      socket_frontend<T> frontend(service);
+
+      if (!frontend.open(settings.path))
+      {
+         std::cerr << "Could not open " << settings.path << "!\n";
+         return 1;
+      }
+
+      std::cout << "Listening on " << settings.path << ", enter reload to reload the model or an empty line to stop.\n";
+      std::string line;
+
+      while (std::getline(std::cin, line) && !line.empty())
+      {
+         if (line != "reload") std::cerr << "Unknown command " << line << "!\n";
+         else if (settings.model.empty()) std::cerr << "No model file given!\n";
+         else if (handle.load(settings.model)) std::cout << "Published version " << handle.version() << ".\n";
+         else std::cerr << "Could not load " << settings.model << "!\n";
+      }
+
+      frontend.close();
+      service.stop();
+      const auto stats = service.stats();
+      std::cout << "Requests: " << stats.num_requests << ", mean batch size: " << stats.mean_batch_size() << "\n";
+      return 0;
+   }
+
+   auto unbatched = settings.server;
+   unbatched.max_batch = 1;
+   latency batched_result, unbatched_result;
+
+   if (!bench(network, settings, unbatched, unbatched_result) ||
+       !bench(network, settings, settings.server, batched_result))
+   {
+      std::cerr << "Benchmark via " << settings.path << " failed!\n";
+      return 1;
+   }
+
+   std::cout << "Clients: " << settings.num_clients << ", requests per client: " << settings.num_requests << "\n\n"
+             << std::left << std::setw(12) << "max_batch" << std::right << std::setw(14) << "rows/s"
+             << std::setw(12) << "p50 [us]" << std::setw(12) << "p99 [us]" << std::setw(12) << "batch"
+             << std::setw(10) << "versions" << "\n";
+
+   for (const auto* i : { &unbatched_result, &batched_result })
+   {
+      std::cout << std::left << std::setw(12) << (i == &unbatched_result ? 1 : settings.server.max_batch)
+                << std::right << std::fixed << std::setprecision(0) << std::setw(14) << i->rows_per_second
+                << std::setprecision(1) << std::setw(12) << i->p50 << std::setw(12) << i->p99
+                << std::setprecision(2) << std::setw(12) << i->mean_batch_size
+                << std::setw(10) << i->versions << "\n";
+   }
+
+   return 0;
+#else
+   (void)settings;
+   std::cerr << "Unix sockets are not supported on this platform!\n";
+   return 1;
+#endif /* SERVER_SOCKET */
+}
+
+/********************************************************************************
+* parse: Lser in instllningar frn kommandoraden. Returnerar false vid
+*        oknt eller ofullstndigt argument.
+*
+*        - argc    : Antalet argument.
+*        - argv    : Argumenten.
+*        - settings: Struktur dr instllningarna lagras.
+********************************************************************************/
+bool parse(const int argc,
+           char** argv,
+           options& settings)
+{
+   for (int i = 1; i < argc; ++i)
+   {
+      const std::string arg = argv[i];
+      const bool has_value = i + 1 < argc;
+
+      if (arg == "--socket" && has_value) settings.path = argv[++i];
+      else if (arg == "--model" && has_value) settings.model = argv[++i];
+      else if (arg == "--type" && has_value) settings.type = argv[++i];
+      else if (arg == "--width" && has_value) settings.width = std::strtoul(argv[++i], nullptr, 10);
+      else if (arg == "--threads" && has_value) settings.server.num_threads = std::strtoul(argv[++i], nullptr, 10);
+      else if (arg == "--max-batch" && has_value) settings.server.max_batch = std::strtoul(argv[++i], nullptr, 10);
+      else if (arg == "--max-delay" && has_value) settings.server.max_delay = std::chrono::microseconds(std::atol(argv[++i]));
+      else if (arg == "--swap" && has_value) settings.swap_interval = std::strtoul(argv[++i], nullptr, 10);
+      else if (arg == "--bench" && i + 2 < argc)
+      {
+         settings.num_clients = std::strtoul(argv[++i], nullptr, 10);
+         settings.num_requests = std::strtoul(argv[++i], nullptr, 10);
+      }
+      else return false;
+   }
+
+   return settings.width > 0 && settings.server.max_batch > 0 && (settings.type == "float" || settings.type == "double");
+}
+}
+
+/********************************************************************************
+* main: Lser in instllningar frn kommandoraden och startar tjnsten eller
+*       benchmarken med angiven flyttalstyp.
+********************************************************************************/
+int main(int argc, char** argv)
+{
+   options settings;
+
+   if (!parse(argc, argv, settings))
+   {
+      std::cerr << "Usage: " << argv[0] << " [--socket <path>] [--model <file>] [--width <n>] [--type float|double]"
+                << " [--threads <n>] [--max-batch <n>] [--max-delay <us>] [--bench <clients> <requests>]"
+                << " [--swap <ms>]\n";
+      return 1;
+   }
+
+   return settings.type == "float" ? run<float>(settings) : run<double>(settings);
+}
@@ -0,0 +1,1609 @@
+/********************************************************************************
+* simd.cpp: Definition av vektoriserade berkningskrnor. Varje krna finns
+*           i en skalr variant samt, fr x86-processorer med GCC eller Clang,
+*           i varianter fr AVX2 och AVX-512. Varianterna kompileras via
+*           target-attribut och vljs en gng per flyttalstyp vid frsta
+*           anrop. Krnorna skrivs en gng per instruktionsuppsttning som
+*           mallar, dr registertyper och instruktioner fr float respektive
+*           double hmtas frn strukterna avx2 samt avx512.
+********************************************************************************/
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#define SIMD_AVX2 __attribute__((target("avx2,fma")))
+#define SIMD_AVX512 __attribute__((target("avx512f")))
+#define SIMD_AVX512BW __attribute__((target("avx512f,avx512bw")))
+#define SIMD_AVX512VNNI __attribute__((target("avx512f,avx512bw,avx512vnni")))
+#include <immintrin.h>
+#endif
+
+namespace
+{
+/********************************************************************************
+* kernels: Strukt innehllande pekare till de krnor som anvnds vid krning
+*          fr flyttalstypen T.
+********************************************************************************/
+template <typename T>
+struct kernels
+{
+   T (*dot)(const T*, const T*, const std::size_t);
+   void (*axpy)(const T, const T*, T*, const std::size_t);
+   void (*dot4)(const T*, const T*, const std::size_t, const std::size_t, T*);
+   void (*axpy4)(const T*, const T*, const std::size_t, T*, const std::size_t);
+   void (*axpy_update)(const T, T*, T*, const T, const T*, const std::size_t);
+   void (*multiply_add)(const T*, const T*, const std::size_t, const std::size_t, T*, const std::size_t);
+   void (*multiply_add_update)(const T*, T*, T*, const T*, const T*, const std::size_t, const std::size_t,
+                               const std::size_t);
+   void (*momentum_update)(const T, const T*, T*, T*, const T, const T, const std::size_t);
+   void (*rmsprop_update)(const T, const T*, T*, T*, const T, const T, const T, const std::size_t);
+   void (*adam_update)(const T, const T*, T*, T*, T*, const T, const T, const T, const T, const std::size_t);
+   const char* isa;
+};
+
+/********************************************************************************
+* Skalra krnor, vilka anvnds p processorer utan std fr AVX2.
+********************************************************************************/
+template <typename T>
+T dot_scalar(const T* x,
+             const T* y,
+             const std::size_t size)
+{
+   T sum = 0;
+
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      sum += x[i] * y[i];
+   }
+
+   return sum;
+}
+
+template <typename T>
+void axpy_scalar(const T a,
+                 const T* x,
+                 T* y,
+                 const std::size_t size)
+{
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      y[i] += a * x[i];
+   }
+
+   return;
+}
+
+template <typename T>
+void axpy_update_scalar(const T a,
+                        T* w,
+                        T* y,
+                        const T b,
+                        const T* x,
+                        const std::size_t size)
+{
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      y[i] += a * w[i];
+      w[i] += b * x[i];
+   }
+
+   return;
+}
+
+/********************************************************************************
+* Krnor fr elementvisa produkter mellan rader, dr varje element i motsvarar
+* en egen modell, se simd::multiply_add. Raderna ligger p avstndet stride
+* frn varandra.
+********************************************************************************/
+template <typename T>
+void multiply_add_scalar(const T* x,
+                         const T* w,
+                         const std::size_t rows,
+                         const std::size_t stride,
+                         T* y,
+                         const std::size_t size)
+{
+   for (std::size_t r = 0; r < rows; ++r)
+   {
+      for (std::size_t i = 0; i < size; ++i)
+      {
+         y[i] += x[r * stride + i] * w[r * stride + i];
+      }
+   }
+
+   return;
+}
+
+template <typename T>
+void multiply_add_update_scalar(const T* a,
+                                T* w,
+                                T* y,
+                                const T* b,
+                                const T* x,
+                                const std::size_t rows,
+                                const std::size_t stride,
+                                const std::size_t size)
+{
+   for (std::size_t r = 0; r < rows; ++r)
+   {
+      for (std::size_t i = 0; i < size; ++i)
+      {
+         y[r * stride + i] += a[i] * w[r * stride + i];
+         w[r * stride + i] += b[i] * x[r * stride + i];
+      }
+   }
+
+   return;
+}
+
+/********************************************************************************
+* Krnor fr optimerare, dr gradienten fr element i utgrs av a * x[i].
+* Optimerarens tillstnd och vikterna w justeras i samma passage, s att
+* varje element endast lses och skrivs en gng per justering.
+********************************************************************************/
+template <typename T>
+void momentum_update_scalar(const T a,
+                            const T* x,
+                            T* w,
+                            T* v,
+                            const T momentum,
+                            const T rate,
+                            const std::size_t size)
+{
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      v[i] = momentum * v[i] + a * x[i];
+      w[i] += rate * v[i];
+   }
+
+   return;
+}
+
+template <typename T>
+void rmsprop_update_scalar(const T a,
+                           const T* x,
+                           T* w,
+                           T* s,
+                           const T decay,
+                           const T rate,
+                           const T epsilon,
+                           const std::size_t size)
+{
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      const auto gradient = a * x[i];
+      s[i] = decay * s[i] + (1 - decay) * gradient * gradient;
+      w[i] += rate * gradient / (std::sqrt(s[i]) + epsilon);
+   }
+
+   return;
+}
+
+template <typename T>
+void adam_update_scalar(const T a,
+                        const T* x,
+                        T* w,
+                        T* m,
+                        T* v,
+                        const T beta1,
+                        const T beta2,
+                        const T rate,
+                        const T epsilon,
+                        const std::size_t size)
+{
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      const auto gradient = a * x[i];
+      m[i] = beta1 * m[i] + (1 - beta1) * gradient;
+      v[i] = beta2 * v[i] + (1 - beta2) * gradient * gradient;
+      w[i] += rate * m[i] / (std::sqrt(v[i]) + epsilon);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* Mikrokrnor fr matrismultiplikation. dot4 berknar skalrprodukten mellan
+* vektorn x och fyra rader i y (med radavstndet ldy) och lagrar resultatet i
+* result[0] - result[3]. axpy4 adderar fyra rader i x (med radavstndet ldx)
+* skalade med a[0] - a[3] till vektorn y, vilket medfr att y endast behver
+* lsas och skrivas en gng per fyra rader.
+********************************************************************************/
+template <typename T>
+void dot4_scalar(const T* x,
+                 const T* y,
+                 const std::size_t ldy,
+                 const std::size_t size,
+                 T* result)
+{
+   for (std::size_t r = 0; r < 4; ++r)
+   {
+      result[r] = dot_scalar(x, y + r * ldy, size);
+   }
+
+   return;
+}
+
+template <typename T>
+void axpy4_scalar(const T* a,
+                  const T* x,
+                  const std::size_t ldx,
+                  T* y,
+                  const std::size_t size)
+{
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      y[i] += a[0] * x[i] + a[1] * x[i + ldx] + a[2] * x[i + 2 * ldx] + a[3] * x[i + 3 * ldx];
+   }
+
+   return;
+}
+
+#ifdef SIMD_X86
+/********************************************************************************
+* avx2: Registertyp samt instruktioner fr AVX2 med FMA, dr ett register
+*       rymmer fyra flyttal av typen double eller tta av typen float.
+********************************************************************************/
+template <typename T> struct avx2;
+
+template <>
+struct avx2<double>
+{
+   using type = __m256d;
+   static constexpr std::size_t width = 4;
+
+   SIMD_AVX2 static type zero(void) { return _mm256_setzero_pd(); }
+   SIMD_AVX2 static type set1(const double a) { return _mm256_set1_pd(a); }
+   SIMD_AVX2 static type load(const double* x) { return _mm256_loadu_pd(x); }
+   SIMD_AVX2 static void store(double* y, const type v) { _mm256_storeu_pd(y, v); }
+   SIMD_AVX2 static type add(const type a, const type b) { return _mm256_add_pd(a, b); }
+   SIMD_AVX2 static type fmadd(const type a, const type b, const type c) { return _mm256_fmadd_pd(a, b, c); }
+   SIMD_AVX2 static type mul(const type a, const type b) { return _mm256_mul_pd(a, b); }
+   SIMD_AVX2 static type div(const type a, const type b) { return _mm256_div_pd(a, b); }
+   SIMD_AVX2 static type sqrt(const type a) { return _mm256_sqrt_pd(a); }
+
+   SIMD_AVX2 static double hsum(const type v)
+   {
+      const auto half = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+      return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+   }
+};
+
+template <>
+struct avx2<float>
+{
+   using type = __m256;
+   static constexpr std::size_t width = 8;
+
+   SIMD_AVX2 static type zero(void) { return _mm256_setzero_ps(); }
+   SIMD_AVX2 static type set1(const float a) { return _mm256_set1_ps(a); }
+   SIMD_AVX2 static type load(const float* x) { return _mm256_loadu_ps(x); }
+   SIMD_AVX2 static void store(float* y, const type v) { _mm256_storeu_ps(y, v); }
+   SIMD_AVX2 static type add(const type a, const type b) { return _mm256_add_ps(a, b); }
+   SIMD_AVX2 static type fmadd(const type a, const type b, const type c) { return _mm256_fmadd_ps(a, b, c); }
+   SIMD_AVX2 static type mul(const type a, const type b) { return _mm256_mul_ps(a, b); }
+   SIMD_AVX2 static type div(const type a, const type b) { return _mm256_div_ps(a, b); }
+   SIMD_AVX2 static type sqrt(const type a) { return _mm256_sqrt_ps(a); }
+
+   SIMD_AVX2 static float hsum(const type v)
+   {
+      auto half = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+      half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+      return _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+   }
+};
+
+/********************************************************************************
+* Krnor fr AVX2. Skalrprodukten anvnder tv oberoende ackumulatorer fr
+* att dlja latensen hos FMA-instruktionerna. Resterande element hanteras
+* skalrt.
+********************************************************************************/
+template <typename T>
+SIMD_AVX2 T dot_avx2(const T* x,
+                     const T* y,
+                     const std::size_t size)
+{
+   using V = avx2<T>;
+   auto sum0 = V::zero();
+   auto sum1 = V::zero();
+   std::size_t i = 0;
+
+   for (; i + 2 * V::width <= size; i += 2 * V::width)
+   {
+      sum0 = V::fmadd(V::load(x + i), V::load(y + i), sum0);
+      sum1 = V::fmadd(V::load(x + i + V::width), V::load(y + i + V::width), sum1);
+   }
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      sum0 = V::fmadd(V::load(x + i), V::load(y + i), sum0);
+   }
+
+   auto result = V::hsum(V::add(sum0, sum1));
+
+   for (; i < size; ++i)
+   {
+      result += x[i] * y[i];
+   }
+
+   return result;
+}
+
+template <typename T>
+SIMD_AVX2 void axpy_avx2(const T a,
+                         const T* x,
+                         T* y,
+                         const std::size_t size)
+{
+   using V = avx2<T>;
+   const auto factor = V::set1(a);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      V::store(y + i, V::fmadd(factor, V::load(x + i), V::load(y + i)));
+   }
+
+   for (; i < size; ++i)
+   {
+      y[i] += a * x[i];
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX2 void axpy_update_avx2(const T a,
+                                T* w,
+                                T* y,
+                                const T b,
+                                const T* x,
+                                const std::size_t size)
+{
+   using V = avx2<T>;
+   const auto factor_a = V::set1(a);
+   const auto factor_b = V::set1(b);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto weights = V::load(w + i);
+      V::store(y + i, V::fmadd(factor_a, weights, V::load(y + i)));
+      V::store(w + i, V::fmadd(factor_b, V::load(x + i), weights));
+   }
+
+   for (; i < size; ++i)
+   {
+      y[i] += a * w[i];
+      w[i] += b * x[i];
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX2 void multiply_add_avx2(const T* x,
+                                 const T* w,
+                                 const std::size_t rows,
+                                 const std::size_t stride,
+                                 T* y,
+                                 const std::size_t size)
+{
+   using V = avx2<T>;
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      auto sum = V::load(y + i);
+
+      for (std::size_t r = 0; r < rows; ++r)
+      {
+         sum = V::fmadd(V::load(x + r * stride + i), V::load(w + r * stride + i), sum);
+      }
+
+      V::store(y + i, sum);
+   }
+
+   for (; i < size; ++i)
+   {
+      for (std::size_t r = 0; r < rows; ++r)
+      {
+         y[i] += x[r * stride + i] * w[r * stride + i];
+      }
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX2 void multiply_add_update_avx2(const T* a,
+                                        T* w,
+                                        T* y,
+                                        const T* b,
+                                        const T* x,
+                                        const std::size_t rows,
+                                        const std::size_t stride,
+                                        const std::size_t size)
+{
+   using V = avx2<T>;
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto factor_a = V::load(a + i);
+      const auto factor_b = V::load(b + i);
+
+      for (std::size_t r = 0; r < rows; ++r)
+      {
+         const auto offset = r * stride + i;
+         const auto weights = V::load(w + offset);
+         V::store(y + offset, V::fmadd(factor_a, weights, V::load(y + offset)));
+         V::store(w + offset, V::fmadd(factor_b, V::load(x + offset), weights));
+      }
+   }
+
+   for (; i < size; ++i)
+   {
+      for (std::size_t r = 0; r < rows; ++r)
+      {
+         y[r * stride + i] += a[i] * w[r * stride + i];
+         w[r * stride + i] += b[i] * x[r * stride + i];
+      }
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX2 void momentum_update_avx2(const T a,
+                                    const T* x,
+                                    T* w,
+                                    T* v,
+                                    const T momentum,
+                                    const T rate,
+                                    const std::size_t size)
+{
+   using V = avx2<T>;
+   const auto factor = V::set1(a);
+   const auto momentum_v = V::set1(momentum);
+   const auto rate_v = V::set1(rate);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto velocity = V::fmadd(momentum_v, V::load(v + i), V::mul(factor, V::load(x + i)));
+      V::store(v + i, velocity);
+      V::store(w + i, V::fmadd(rate_v, velocity, V::load(w + i)));
+   }
+
+   momentum_update_scalar(a, x + i, w + i, v + i, momentum, rate, size - i);
+   return;
+}
+
+template <typename T>
+SIMD_AVX2 void rmsprop_update_avx2(const T a,
+                                   const T* x,
+                                   T* w,
+                                   T* s,
+                                   const T decay,
+                                   const T rate,
+                                   const T epsilon,
+                                   const std::size_t size)
+{
+   using V = avx2<T>;
+   const auto factor = V::set1(a);
+   const auto decay_v = V::set1(decay);
+   const auto complement = V::set1(1 - decay);
+   const auto rate_v = V::set1(rate);
+   const auto epsilon_v = V::set1(epsilon);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto gradient = V::mul(factor, V::load(x + i));
+      const auto square = V::fmadd(V::mul(complement, gradient), gradient, V::mul(decay_v, V::load(s + i)));
+      V::store(s + i, square);
+      V::store(w + i, V::fmadd(rate_v, V::div(gradient, V::add(V::sqrt(square), epsilon_v)), V::load(w + i)));
+   }
+
+   rmsprop_update_scalar(a, x + i, w + i, s + i, decay, rate, epsilon, size - i);
+   return;
+}
+
+template <typename T>
+SIMD_AVX2 void adam_update_avx2(const T a,
+                                const T* x,
+                                T* w,
+                                T* m,
+                                T* v,
+                                const T beta1,
+                                const T beta2,
+                                const T rate,
+                                const T epsilon,
+                                const std::size_t size)
+{
+   using V = avx2<T>;
+   const auto factor = V::set1(a);
+   const auto beta1_v = V::set1(beta1);
+   const auto beta2_v = V::set1(beta2);
+   const auto complement1 = V::set1(1 - beta1);
+   const auto complement2 = V::set1(1 - beta2);
+   const auto rate_v = V::set1(rate);
+   const auto epsilon_v = V::set1(epsilon);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto gradient = V::mul(factor, V::load(x + i));
+      const auto mean = V::fmadd(beta1_v, V::load(m + i), V::mul(complement1, gradient));
+      const auto square = V::fmadd(V::mul(complement2, gradient), gradient, V::mul(beta2_v, V::load(v + i)));
+      V::store(m + i, mean);
+      V::store(v + i, square);
+      V::store(w + i, V::fmadd(rate_v, V::div(mean, V::add(V::sqrt(square), epsilon_v)), V::load(w + i)));
+   }
+
+   adam_update_scalar(a, x + i, w + i, m + i, v + i, beta1, beta2, rate, epsilon, size - i);
+   return;
+}
+
+template <typename T>
+SIMD_AVX2 void dot4_avx2(const T* x,
+                         const T* y,
+                         const std::size_t ldy,
+                         const std::size_t size,
+                         T* result)
+{
+   using V = avx2<T>;
+   const auto* y0 = y;
+   const auto* y1 = y + ldy;
+   const auto* y2 = y + 2 * ldy;
+   const auto* y3 = y + 3 * ldy;
+   auto sum0 = V::zero();
+   auto sum1 = V::zero();
+   auto sum2 = V::zero();
+   auto sum3 = V::zero();
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto xi = V::load(x + i);
+      sum0 = V::fmadd(xi, V::load(y0 + i), sum0);
+      sum1 = V::fmadd(xi, V::load(y1 + i), sum1);
+      sum2 = V::fmadd(xi, V::load(y2 + i), sum2);
+      sum3 = V::fmadd(xi, V::load(y3 + i), sum3);
+   }
+
+   result[0] = V::hsum(sum0);
+   result[1] = V::hsum(sum1);
+   result[2] = V::hsum(sum2);
+   result[3] = V::hsum(sum3);
+
+   for (; i < size; ++i)
+   {
+      result[0] += x[i] * y0[i];
+      result[1] += x[i] * y1[i];
+      result[2] += x[i] * y2[i];
+      result[3] += x[i] * y3[i];
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX2 void axpy4_avx2(const T* a,
+                          const T* x,
+                          const std::size_t ldx,
+                          T* y,
+                          const std::size_t size)
+{
+   using V = avx2<T>;
+   const auto a0 = V::set1(a[0]);
+   const auto a1 = V::set1(a[1]);
+   const auto a2 = V::set1(a[2]);
+   const auto a3 = V::set1(a[3]);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      auto yi = V::load(y + i);
+      yi = V::fmadd(a0, V::load(x + i), yi);
+      yi = V::fmadd(a1, V::load(x + i + ldx), yi);
+      yi = V::fmadd(a2, V::load(x + i + 2 * ldx), yi);
+      yi = V::fmadd(a3, V::load(x + i + 3 * ldx), yi);
+      V::store(y + i, yi);
+   }
+
+   for (; i < size; ++i)
+   {
+      y[i] += a[0] * x[i] + a[1] * x[i + ldx] + a[2] * x[i + 2 * ldx] + a[3] * x[i + 3 * ldx];
+   }
+
+   return;
+}
+
+/********************************************************************************
+* avx512: Registertyp samt instruktioner fr AVX-512, dr ett register rymmer
+*         tta flyttal av typen double eller sexton av typen float.
+*         Resterande element hanteras via maskade laddningar och skrivningar.
+*         Roten berknas via den maskade instruktionen med full mask, vilket
+*         undviker GCC:s varning fr det odefinierade kllregistret.
+********************************************************************************/
+template <typename T> struct avx512;
+
+template <>
+struct avx512<double>
+{
+   using type = __m512d;
+   using mask_type = __mmask8;
+   static constexpr std::size_t width = 8;
+
+   SIMD_AVX512 static type zero(void) { return _mm512_setzero_pd(); }
+   SIMD_AVX512 static type set1(const double a) { return _mm512_set1_pd(a); }
+   SIMD_AVX512 static type load(const double* x) { return _mm512_loadu_pd(x); }
+   SIMD_AVX512 static type load(const double* x, const mask_type m) { return _mm512_maskz_loadu_pd(m, x); }
+   SIMD_AVX512 static void store(double* y, const type v) { _mm512_storeu_pd(y, v); }
+   SIMD_AVX512 static void store(double* y, const type v, const mask_type m) { _mm512_mask_storeu_pd(y, m, v); }
+   SIMD_AVX512 static void store_aligned(double* y, const type v) { _mm512_store_pd(y, v); }
+   SIMD_AVX512 static type add(const type a, const type b) { return _mm512_add_pd(a, b); }
+   SIMD_AVX512 static type fmadd(const type a, const type b, const type c) { return _mm512_fmadd_pd(a, b, c); }
+   SIMD_AVX512 static type mul(const type a, const type b) { return _mm512_mul_pd(a, b); }
+   SIMD_AVX512 static type div(const type a, const type b) { return _mm512_div_pd(a, b); }
+   SIMD_AVX512 static type sqrt(const type a) { return _mm512_mask_sqrt_pd(a, static_cast<mask_type>(-1), a); }
+   static mask_type mask(const std::size_t remaining) { return static_cast<mask_type>((1u << remaining) - 1); }
+};
+
+template <>
+struct avx512<float>
+{
+   using type = __m512;
+   using mask_type = __mmask16;
+   static constexpr std::size_t width = 16;
+
+   SIMD_AVX512 static type zero(void) { return _mm512_setzero_ps(); }
+   SIMD_AVX512 static type set1(const float a) { return _mm512_set1_ps(a); }
+   SIMD_AVX512 static type load(const float* x) { return _mm512_loadu_ps(x); }
+   SIMD_AVX512 static type load(const float* x, const mask_type m) { return _mm512_maskz_loadu_ps(m, x); }
+   SIMD_AVX512 static void store(float* y, const type v) { _mm512_storeu_ps(y, v); }
+   SIMD_AVX512 static void store(float* y, const type v, const mask_type m) { _mm512_mask_storeu_ps(y, m, v); }
+   SIMD_AVX512 static void store_aligned(float* y, const type v) { _mm512_store_ps(y, v); }
+   SIMD_AVX512 static type add(const type a, const type b) { return _mm512_add_ps(a, b); }
+   SIMD_AVX512 static type fmadd(const type a, const type b, const type c) { return _mm512_fmadd_ps(a, b, c); }
+   SIMD_AVX512 static type mul(const type a, const type b) { return _mm512_mul_ps(a, b); }
+   SIMD_AVX512 static type div(const type a, const type b) { return _mm512_div_ps(a, b); }
+   SIMD_AVX512 static type sqrt(const type a) { return _mm512_mask_sqrt_ps(a, static_cast<mask_type>(-1), a); }
+   static mask_type mask(const std::size_t remaining) { return static_cast<mask_type>((1u << remaining) - 1); }
+};
+
+/********************************************************************************
+* hsum_avx512: Returnerar summan av samtliga element i angivet register, dr
+*              elementen summeras parvis fr att minska avrundningsfel.
+********************************************************************************/
+template <typename T>
+SIMD_AVX512 T hsum_avx512(const typename avx512<T>::type v)
+{
+   using V = avx512<T>;
+   alignas(64) T lanes[V::width];
+   V::store_aligned(lanes, v);
+
+   for (auto n = V::width / 2; n > 0; n /= 2)
+   {
+      for (std::size_t i = 0; i < n; ++i)
+      {
+         lanes[i] += lanes[i + n];
+      }
+   }
+
+   return lanes[0];
+}
+
+/********************************************************************************
+* Krnor fr AVX-512.
+********************************************************************************/
+template <typename T>
+SIMD_AVX512 T dot_avx512(const T* x,
+                         const T* y,
+                         const std::size_t size)
+{
+   using V = avx512<T>;
+   auto sum0 = V::zero();
+   auto sum1 = V::zero();
+   std::size_t i = 0;
+
+   for (; i + 2 * V::width <= size; i += 2 * V::width)
+   {
+      sum0 = V::fmadd(V::load(x + i), V::load(y + i), sum0);
+      sum1 = V::fmadd(V::load(x + i + V::width), V::load(y + i + V::width), sum1);
+   }
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      sum0 = V::fmadd(V::load(x + i), V::load(y + i), sum0);
+   }
+
+   if (i < size)
+   {
+      const auto mask = V::mask(size - i);
+      sum1 = V::fmadd(V::load(x + i, mask), V::load(y + i, mask), sum1);
+   }
+
+   return hsum_avx512<T>(V::add(sum0, sum1));
+}
+
+template <typename T>
+SIMD_AVX512 void axpy_avx512(const T a,
+                             const T* x,
+                             T* y,
+                             const std::size_t size)
+{
+   using V = avx512<T>;
+   const auto factor = V::set1(a);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      V::store(y + i, V::fmadd(factor, V::load(x + i), V::load(y + i)));
+   }
+
+   if (i < size)
+   {
+      const auto mask = V::mask(size - i);
+      V::store(y + i, V::fmadd(factor, V::load(x + i, mask), V::load(y + i, mask)), mask);
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX512 void axpy_update_avx512(const T a,
+                                    T* w,
+                                    T* y,
+                                    const T b,
+                                    const T* x,
+                                    const std::size_t size)
+{
+   using V = avx512<T>;
+   const auto factor_a = V::set1(a);
+   const auto factor_b = V::set1(b);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto weights = V::load(w + i);
+      V::store(y + i, V::fmadd(factor_a, weights, V::load(y + i)));
+      V::store(w + i, V::fmadd(factor_b, V::load(x + i), weights));
+   }
+
+   if (i < size)
+   {
+      const auto mask = V::mask(size - i);
+      const auto weights = V::load(w + i, mask);
+      V::store(y + i, V::fmadd(factor_a, weights, V::load(y + i, mask)), mask);
+      V::store(w + i, V::fmadd(factor_b, V::load(x + i, mask), weights), mask);
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX512 void multiply_add_avx512(const T* x,
+                                     const T* w,
+                                     const std::size_t rows,
+                                     const std::size_t stride,
+                                     T* y,
+                                     const std::size_t size)
+{
+   using V = avx512<T>;
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      auto sum = V::load(y + i);
+
+      for (std::size_t r = 0; r < rows; ++r)
+      {
+         sum = V::fmadd(V::load(x + r * stride + i), V::load(w + r * stride + i), sum);
+      }
+
+      V::store(y + i, sum);
+   }
+
+   if (i < size)
+   {
+      const auto mask = V::mask(size - i);
+      auto sum = V::load(y + i, mask);
+
+      for (std::size_t r = 0; r < rows; ++r)
+      {
+         sum = V::fmadd(V::load(x + r * stride + i, mask), V::load(w + r * stride + i, mask), sum);
+      }
+
+      V::store(y + i, sum, mask);
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX512 void multiply_add_update_avx512(const T* a,
+                                            T* w,
+                                            T* y,
+                                            const T* b,
+                                            const T* x,
+                                            const std::size_t rows,
+                                            const std::size_t stride,
+                                            const std::size_t size)
+{
+   using V = avx512<T>;
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto factor_a = V::load(a + i);
+      const auto factor_b = V::load(b + i);
+
+      for (std::size_t r = 0; r < rows; ++r)
+      {
+         const auto offset = r * stride + i;
+         const auto weights = V::load(w + offset);
+         V::store(y + offset, V::fmadd(factor_a, weights, V::load(y + offset)));
+         V::store(w + offset, V::fmadd(factor_b, V::load(x + offset), weights));
+      }
+   }
+
+   if (i < size)
+   {
+      const auto mask = V::mask(size - i);
+      const auto factor_a = V::load(a + i, mask);
+      const auto factor_b = V::load(b + i, mask);
+
+      for (std::size_t r = 0; r < rows; ++r)
+      {
+         const auto offset = r * stride + i;
+         const auto weights = V::load(w + offset, mask);
+         V::store(y + offset, V::fmadd(factor_a, weights, V::load(y + offset, mask)), mask);
+         V::store(w + offset, V::fmadd(factor_b, V::load(x + offset, mask), weights), mask);
+      }
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX512 void momentum_update_avx512(const T a,
+                                        const T* x,
+                                        T* w,
+                                        T* v,
+                                        const T momentum,
+                                        const T rate,
+                                        const std::size_t size)
+{
+   using V = avx512<T>;
+   const auto factor = V::set1(a);
+   const auto momentum_v = V::set1(momentum);
+   const auto rate_v = V::set1(rate);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto velocity = V::fmadd(momentum_v, V::load(v + i), V::mul(factor, V::load(x + i)));
+      V::store(v + i, velocity);
+      V::store(w + i, V::fmadd(rate_v, velocity, V::load(w + i)));
+   }
+
+   if (i < size)
+   {
+      const auto mask = V::mask(size - i);
+      const auto velocity = V::fmadd(momentum_v, V::load(v + i, mask), V::mul(factor, V::load(x + i, mask)));
+      V::store(v + i, velocity, mask);
+      V::store(w + i, V::fmadd(rate_v, velocity, V::load(w + i, mask)), mask);
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX512 void rmsprop_update_avx512(const T a,
+                                       const T* x,
+                                       T* w,
+                                       T* s,
+                                       const T decay,
+                                       const T rate,
+                                       const T epsilon,
+                                       const std::size_t size)
+{
+   using V = avx512<T>;
+   const auto factor = V::set1(a);
+   const auto decay_v = V::set1(decay);
+   const auto complement = V::set1(1 - decay);
+   const auto rate_v = V::set1(rate);
+   const auto epsilon_v = V::set1(epsilon);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto gradient = V::mul(factor, V::load(x + i));
+      const auto square = V::fmadd(V::mul(complement, gradient), gradient, V::mul(decay_v, V::load(s + i)));
+      V::store(s + i, square);
+      V::store(w + i, V::fmadd(rate_v, V::div(gradient, V::add(V::sqrt(square), epsilon_v)), V::load(w + i)));
+   }
+
+   if (i < size)
+   {
+      const auto mask = V::mask(size - i);
+      const auto gradient = V::mul(factor, V::load(x + i, mask));
+      const auto square = V::fmadd(V::mul(complement, gradient), gradient, V::mul(decay_v, V::load(s + i, mask)));
+      V::store(s + i, square, mask);
+      V::store(w + i, V::fmadd(rate_v, V::div(gradient, V::add(V::sqrt(square), epsilon_v)), V::load(w + i, mask)), mask);
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX512 void adam_update_avx512(const T a,
+                                    const T* x,
+                                    T* w,
+                                    T* m,
+                                    T* v,
+                                    const T beta1,
+                                    const T beta2,
+                                    const T rate,
+                                    const T epsilon,
+                                    const std::size_t size)
+{
+   using V = avx512<T>;
+   const auto factor = V::set1(a);
+   const auto beta1_v = V::set1(beta1);
+   const auto beta2_v = V::set1(beta2);
+   const auto complement1 = V::set1(1 - beta1);
+   const auto complement2 = V::set1(1 - beta2);
+   const auto rate_v = V::set1(rate);
+   const auto epsilon_v = V::set1(epsilon);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto gradient = V::mul(factor, V::load(x + i));
+      const auto mean = V::fmadd(beta1_v, V::load(m + i), V::mul(complement1, gradient));
+      const auto square = V::fmadd(V::mul(complement2, gradient), gradient, V::mul(beta2_v, V::load(v + i)));
+      V::store(m + i, mean);
+      V::store(v + i, square);
+      V::store(w + i, V::fmadd(rate_v, V::div(mean, V::add(V::sqrt(square), epsilon_v)), V::load(w + i)));
+   }
+
+   if (i < size)
+   {
+      const auto mask = V::mask(size - i);
+      const auto gradient = V::mul(factor, V::load(x + i, mask));
+      const auto mean = V::fmadd(beta1_v, V::load(m + i, mask), V::mul(complement1, gradient));
+      const auto square = V::fmadd(V::mul(complement2, gradient), gradient, V::mul(beta2_v, V::load(v + i, mask)));
+      V::store(m + i, mean, mask);
+      V::store(v + i, square, mask);
+      V::store(w + i, V::fmadd(rate_v, V::div(mean, V::add(V::sqrt(square), epsilon_v)), V::load(w + i, mask)), mask);
+   }
+
+   return;
+}
+
+template <typename T>
+SIMD_AVX512 void dot4_avx512(const T* x,
+                             const T* y,
+                             const std::size_t ldy,
+                             const std::size_t size,
+                             T* result)
+{
+   using V = avx512<T>;
+   const auto* y0 = y;
+   const auto* y1 = y + ldy;
+   const auto* y2 = y + 2 * ldy;
+   const auto* y3 = y + 3 * ldy;
+   auto sum0 = V::zero();
+   auto sum1 = V::zero();
+   auto sum2 = V::zero();
+   auto sum3 = V::zero();
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      const auto xi = V::load(x + i);
+      sum0 = V::fmadd(xi, V::load(y0 + i), sum0);
+      sum1 = V::fmadd(xi, V::load(y1 + i), sum1);
+      sum2 = V::fmadd(xi, V::load(y2 + i), sum2);
+      sum3 = V::fmadd(xi, V::load(y3 + i), sum3);
+   }
+
+   if (i < size)
+   {
+      const auto mask = V::mask(size - i);
+      const auto xi = V::load(x + i, mask);
+      sum0 = V::fmadd(xi, V::load(y0 + i, mask), sum0);
+      sum1 = V::fmadd(xi, V::load(y1 + i, mask), sum1);
+      sum2 = V::fmadd(xi, V::load(y2 + i, mask), sum2);
+      sum3 = V::fmadd(xi, V::load(y3 + i, mask), sum3);
+   }
+
+   result[0] = hsum_avx512<T>(sum0);
+   result[1] = hsum_avx512<T>(sum1);
+   result[2] = hsum_avx512<T>(sum2);
+   result[3] = hsum_avx512<T>(sum3);
+   return;
+}
+
+template <typename T>
+SIMD_AVX512 void axpy4_avx512(const T* a,
+                              const T* x,
+                              const std::size_t ldx,
+                              T* y,
+                              const std::size_t size)
+{
+   using V = avx512<T>;
+   const auto a0 = V::set1(a[0]);
+   const auto a1 = V::set1(a[1]);
+   const auto a2 = V::set1(a[2]);
+   const auto a3 = V::set1(a[3]);
+   std::size_t i = 0;
+
+   for (; i + V::width <= size; i += V::width)
+   {
+      auto yi = V::load(y + i);
+      yi = V::fmadd(a0, V::load(x + i), yi);
+      yi = V::fmadd(a1, V::load(x + i + ldx), yi);
+      yi = V::fmadd(a2, V::load(x + i + 2 * ldx), yi);
+      yi = V::fmadd(a3, V::load(x + i + 3 * ldx), yi);
+      V::store(y + i, yi);
+   }
+
+   if (i < size)
+   {
+      const auto mask = V::mask(size - i);
+      auto yi = V::load(y + i, mask);
+      yi = V::fmadd(a0, V::load(x + i, mask), yi);
+      yi = V::fmadd(a1, V::load(x + i + ldx, mask), yi);
+      yi = V::fmadd(a2, V::load(x + i + 2 * ldx, mask), yi);
+      yi = V::fmadd(a3, V::load(x + i + 3 * ldx, mask), yi);
+      V::store(y + i, yi, mask);
+   }
+
+   return;
+}
+#endif /* SIMD_X86 */
+
+/********************************************************************************
+* detect: Vljer den snabbaste uppsttningen krnor som processorn stdjer.
+********************************************************************************/
+template <typename T>
+kernels<T> detect(void)
+{
+#ifdef SIMD_X86
+   __builtin_cpu_init();
+
+   if (__builtin_cpu_supports("avx512f"))
+   {
+      return { dot_avx512<T>, axpy_avx512<T>, dot4_avx512<T>, axpy4_avx512<T>, axpy_update_avx512<T>,
+               multiply_add_avx512<T>, multiply_add_update_avx512<T>, momentum_update_avx512<T>, rmsprop_update_avx512<T>, adam_update_avx512<T>, "avx512" };
+   }
+   else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+   {
+      return { dot_avx2<T>, axpy_avx2<T>, dot4_avx2<T>, axpy4_avx2<T>, axpy_update_avx2<T>,
+               multiply_add_avx2<T>, multiply_add_update_avx2<T>, momentum_update_avx2<T>, rmsprop_update_avx2<T>, adam_update_avx2<T>, "avx2" };
+   }
+#endif /* SIMD_X86 */
+   return { dot_scalar<T>, axpy_scalar<T>, dot4_scalar<T>, axpy4_scalar<T>, axpy_update_scalar<T>,
+            multiply_add_scalar<T>, multiply_add_update_scalar<T>, momentum_update_scalar<T>, rmsprop_update_scalar<T>, adam_update_scalar<T>, "scalar" };
+}
+
+/********************************************************************************
+* Krnor fr skalrprodukter mellan 8-bitars heltal utan tecken (x) och med
+* tecken (y). Utan VNNI utvidgas elementen till 16 bitar, varefter
+* intilliggande produkter summeras parvis till 32 bitar via madd, vilket
+* inte kan ge verslag. Med VNNI multipliceras och summeras 64 par per
+* instruktion direkt till 32 bitar.
+********************************************************************************/
+std::int32_t dot_u8i8_scalar(const std::uint8_t* x,
+                             const std::int8_t* y,
+                             const std::size_t size)
+{
+   std::int32_t sum = 0;
+
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      sum += static_cast<std::int32_t>(x[i]) * y[i];
+   }
+
+   return sum;
+}
+
+#ifdef SIMD_X86
+SIMD_AVX2 std::int32_t dot_u8i8_avx2(const std::uint8_t* x,
+                                     const std::int8_t* y,
+                                     const std::size_t size)
+{
+   auto sum = _mm256_setzero_si256();
+   std::size_t i = 0;
+
+   for (; i + 16 <= size; i += 16)
+   {
+      const auto a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)));
+      const auto b = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i)));
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, b));
+   }
+
+   auto half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+   half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4e));
+   half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xb1));
+   auto result = _mm_cvtsi128_si32(half);
+
+   for (; i < size; ++i)
+   {
+      result += static_cast<std::int32_t>(x[i]) * y[i];
+   }
+
+   return result;
+}
+
+/********************************************************************************
+* hsum_epi32: Returnerar summan av samtliga 32-bitars heltal i angivet
+*             AVX-512-register.
+********************************************************************************/
+SIMD_AVX512 std::int32_t hsum_epi32(const __m512i v)
+{
+   alignas(64) std::int32_t lanes[16];
+   _mm512_store_si512(lanes, v);
+   std::int32_t result = 0;
+
+   for (const auto lane : lanes)
+   {
+      result += lane;
+   }
+
+   return result;
+}
+
+SIMD_AVX512BW std::int32_t dot_u8i8_avx512(const std::uint8_t* x,
+                                           const std::int8_t* y,
+                                           const std::size_t size)
+{
+   auto sum = _mm512_setzero_si512();
+   std::size_t i = 0;
+
+   for (; i + 32 <= size; i += 32)
+   {
+      const auto a = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)));
+      const auto b = _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i)));
+      sum = _mm512_add_epi32(sum, _mm512_madd_epi16(a, b));
+   }
+
+   auto result = hsum_epi32(sum);
+
+   for (; i < size; ++i)
+   {
+      result += static_cast<std::int32_t>(x[i]) * y[i];
+   }
+
+   return result;
+}
+
+SIMD_AVX512VNNI std::int32_t dot_u8i8_vnni(const std::uint8_t* x,
+                                           const std::int8_t* y,
+                                           const std::size_t size)
+{
+   auto sum0 = _mm512_setzero_si512();
+   auto sum1 = _mm512_setzero_si512();
+   std::size_t i = 0;
+
+   for (; i + 128 <= size; i += 128)
+   {
+      sum0 = _mm512_dpbusd_epi32(sum0, _mm512_loadu_si512(x + i), _mm512_loadu_si512(y + i));
+      sum1 = _mm512_dpbusd_epi32(sum1, _mm512_loadu_si512(x + i + 64), _mm512_loadu_si512(y + i + 64));
+   }
+
+   for (; i + 64 <= size; i += 64)
+   {
+      sum0 = _mm512_dpbusd_epi32(sum0, _mm512_loadu_si512(x + i), _mm512_loadu_si512(y + i));
+   }
+
+   if (i < size)
+   {
+      const auto mask = static_cast<__mmask64>(~0ull >> (64 - (size - i)));
+      sum1 = _mm512_dpbusd_epi32(sum1, _mm512_maskz_loadu_epi8(mask, x + i), _mm512_maskz_loadu_epi8(mask, y + i));
+   }
+
+   return hsum_epi32(_mm512_add_epi32(sum0, sum1));
+}
+#endif /* SIMD_X86 */
+
+/********************************************************************************
+* detect_u8i8: Vljer den snabbaste krnan fr 8-bitars heltal som
+*              processorn stdjer.
+********************************************************************************/
+using dot_u8i8_kernel = std::int32_t (*)(const std::uint8_t*, const std::int8_t*, const std::size_t);
+
+dot_u8i8_kernel detect_u8i8(void)
+{
+#ifdef SIMD_X86
+   __builtin_cpu_init();
+
+   if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw"))
+   {
+      return dot_u8i8_vnni;
+   }
+   else if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+   {
+      return dot_u8i8_avx512;
+   }
+   else if (__builtin_cpu_supports("avx2"))
+   {
+      return dot_u8i8_avx2;
+   }
+#endif /* SIMD_X86 */
+   return dot_u8i8_scalar;
+}
+
+/********************************************************************************
+* selected: Returnerar de krnor som valts fr aktuell processor. Valet
+*           genomfrs endast vid frsta anrop.
+********************************************************************************/
+template <typename T>
+const kernels<T>& selected(void)
+{
+   static const kernels<T> instance = detect<T>();
+   return instance;
+}
+
+/********************************************************************************
+* block_rows: Returnerar antalet rader med angiven lngd som ryms i ett block
+*             om cirka 128 kB, vilket avgr hur matrisprodukterna delas upp
+*             fr att hlla teranvnd data kvar i cacheminnet. Antalet rader
+*             avrundas nedt till en multipel av fyra, dock minst fyra.
+*
+*             - row_size: Antalet element per rad.
+********************************************************************************/
+template <typename T>
+std::size_t block_rows(const std::size_t row_size)
+{
+   constexpr std::size_t block_size = 128 * 1024 / sizeof(T);
+   const auto rows = block_size / std::max<std::size_t>(row_size, 1);
+   return std::max<std::size_t>(rows / 4 * 4, 4);
+}
+}
+
+/********************************************************************************
+* dot: Returnerar skalrprodukten av angivna vektorer x och y.
+********************************************************************************/
+template <typename T>
+T simd::dot(const T* x,
+            const T* y,
+            const std::size_t size)
+{
+   return selected<T>().dot(x, y, size);
+}
+
+/********************************************************************************
+* axpy: Adderar angiven vektor x skalad med faktorn a till vektorn y.
+********************************************************************************/
+template <typename T>
+void simd::axpy(const T a,
+                const T* x,
+                T* y,
+                const std::size_t size)
+{
+   selected<T>().axpy(a, x, y, size);
+   return;
+}
+
+/********************************************************************************
+* axpy_update: Adderar angiven vektor w skalad med faktorn a till vektorn y och
+*              justerar drefter w med vektorn x skalad med faktorn b.
+********************************************************************************/
+template <typename T>
+void simd::axpy_update(const T a,
+                       T* w,
+                       T* y,
+                       const T b,
+                       const T* x,
+                       const std::size_t size)
+{
+   selected<T>().axpy_update(a, w, y, b, x, size);
+   return;
+}
+
+/********************************************************************************
+* multiply_add: Adderar de elementvisa produkterna av angivet antal rader i x
+*               och w till vektorn y.
+********************************************************************************/
+template <typename T>
+void simd::multiply_add(const T* x,
+                        const T* w,
+                        const std::size_t rows,
+                        const std::size_t stride,
+                        T* y,
+                        const std::size_t size)
+{
+   selected<T>().multiply_add(x, w, rows, stride, y, size);
+   return;
+}
+
+/********************************************************************************
+* multiply_add_update: Adderar a multiplicerat elementvis med varje rad i w
+*                      till motsvarande rad i y och justerar drefter raden i
+*                      w med motsvarande rad i x multiplicerad med b.
+********************************************************************************/
+template <typename T>
+void simd::multiply_add_update(const T* a,
+                               T* w,
+                               T* y,
+                               const T* b,
+                               const T* x,
+                               const std::size_t rows,
+                               const std::size_t stride,
+                               const std::size_t size)
+{
+   selected<T>().multiply_add_update(a, w, y, b, x, rows, stride, size);
+   return;
+}
+
+/********************************************************************************
+* momentum_update: Justerar angivna vikter w via gradienten a * x med momentum,
+*                  dr hastigheten v uppdateras i samma passage.
+********************************************************************************/
+template <typename T>
+void simd::momentum_update(const T a,
+                           const T* x,
+                           T* w,
+                           T* v,
+                           const T momentum,
+                           const T rate,
+                           const std::size_t size)
+{
+   selected<T>().momentum_update(a, x, w, v, momentum, rate, size);
+   return;
+}
+
+/********************************************************************************
+* rmsprop_update: Justerar angivna vikter w via gradienten a * x enligt
+*                 RMSProp, dr medelvrdet s uppdateras i samma passage.
+********************************************************************************/
+template <typename T>
+void simd::rmsprop_update(const T a,
+                          const T* x,
+                          T* w,
+                          T* s,
+                          const T decay,
+                          const T rate,
+                          const T epsilon,
+                          const std::size_t size)
+{
+   selected<T>().rmsprop_update(a, x, w, s, decay, rate, epsilon, size);
+   return;
+}
+
+/********************************************************************************
+* adam_update: Justerar angivna vikter w via gradienten a * x enligt Adam,
+*              dr momenten m och v uppdateras i samma passage.
+********************************************************************************/
+template <typename T>
+void simd::adam_update(const T a,
+                       const T* x,
+                       T* w,
+                       T* m,
+                       T* v,
+                       const T beta1,
+                       const T beta2,
+                       const T rate,
+                       const T epsilon,
+                       const std::size_t size)
+{
+   selected<T>().adam_update(a, x, w, m, v, beta1, beta2, rate, epsilon, size);
+   return;
+}
+
+/********************************************************************************
+* dot_u8i8: Returnerar skalrprodukten av angivna vektorer x och y bestende
+*           av 8-bitars heltal. Krnan vljs vid frsta anrop.
+********************************************************************************/
+std::int32_t simd::dot_u8i8(const std::uint8_t* x,
+                            const std::int8_t* y,
+                            const std::size_t size)
+{
+   static const auto kernel = detect_u8i8();
+   return kernel(x, y, size);
+}
+
+/********************************************************************************
+* isa: Returnerar namnet p den instruktionsuppsttning som valts vid krning.
+********************************************************************************/
+const char* simd::isa(void)
+{
+   return selected<double>().isa;
+}
+
+/********************************************************************************
+* gemm_nt: Adderar matrisprodukten A * B^T till matrisen C. Raderna i B delas
+*          upp i block som ryms i cacheminnet, varefter samtliga rader i A
+*          multipliceras med blockets rader fyra i taget.
+********************************************************************************/
+template <typename T>
+void simd::gemm_nt(const std::size_t m,
+                   const std::size_t n,
+                   const std::size_t k,
+                   const T* a,
+                   const std::size_t lda,
+                   const T* b,
+                   const std::size_t ldb,
+                   T* c,
+                   const std::size_t ldc)
+{
+   const auto& kernel = selected<T>();
+   const auto block = block_rows<T>(k);
+
+   for (std::size_t j0 = 0; j0 < n; j0 += block)
+   {
+      const auto j1 = std::min(n, j0 + block);
+
+      for (std::size_t i = 0; i < m; ++i)
+      {
+         const auto* x = a + i * lda;
+         auto* y = c + i * ldc;
+         auto j = j0;
+
+         for (; j + 4 <= j1; j += 4)
+         {
+            T result[4];
+            kernel.dot4(x, b + j * ldb, ldb, k, result);
+            y[j] += result[0];
+            y[j + 1] += result[1];
+            y[j + 2] += result[2];
+            y[j + 3] += result[3];
+         }
+
+         for (; j < j1; ++j)
+         {
+            y[j] += kernel.dot(x, b + j * ldb, k);
+         }
+      }
+   }
+
+   return;
+}
+
+/********************************************************************************
+* gemm_nn: Adderar matrisprodukten A * B till matrisen C. Raderna i B delas
+*          upp i block som ryms i cacheminnet, varefter varje rad i C
+*          uppdateras med fyra rader i blocket i taget. Grupper av rader
+*          vars koefficienter samtliga r noll hoppas ver.
+********************************************************************************/
+template <typename T>
+void simd::gemm_nn(const std::size_t m,
+                   const std::size_t n,
+                   const std::size_t k,
+                   const T* a,
+                   const std::size_t lda,
+                   const T* b,
+                   const std::size_t ldb,
+                   T* c,
+                   const std::size_t ldc)
+{
+   const auto& kernel = selected<T>();
+   const auto block = block_rows<T>(n);
+
+   for (std::size_t p0 = 0; p0 < k; p0 += block)
+   {
+      const auto p1 = std::min(k, p0 + block);
+
+      for (std::size_t i = 0; i < m; ++i)
+      {
+         const auto* x = a + i * lda;
+         auto* y = c + i * ldc;
+         auto p = p0;
+
+         for (; p + 4 <= p1; p += 4)
+         {
+            if (x[p] != 0 || x[p + 1] != 0 || x[p + 2] != 0 || x[p + 3] != 0)
+            {
+               kernel.axpy4(x + p, b + p * ldb, ldb, y, n);
+            }
+         }
+
+         for (; p < p1; ++p)
+         {
+            if (x[p] != 0) kernel.axpy(x[p], b + p * ldb, y, n);
+         }
+      }
+   }
+
+   return;
+}
+
+/********************************************************************************
+* gemm_tn: Adderar matrisprodukten A^T * B till matrisen C. Raderna i B delas
+*          upp i block som ryms i cacheminnet, varefter varje rad i C
+*          uppdateras med fyra rader i blocket i taget, dr koefficienterna
+*          hmtas kolumnvis ur A. Grupper av rader vars koefficienter samtliga
+*          r noll hoppas ver.
+********************************************************************************/
+template <typename T>
+void simd::gemm_tn(const std::size_t m,
+                   const std::size_t n,
+                   const std::size_t k,
+                   const T* a,
+                   const std::size_t lda,
+                   const T* b,
+                   const std::size_t ldb,
+                   T* c,
+                   const std::size_t ldc)
+{
+   const auto& kernel = selected<T>();
+   const auto block = block_rows<T>(n);
+
+   for (std::size_t p0 = 0; p0 < k; p0 += block)
+   {
+      const auto p1 = std::min(k, p0 + block);
+
+      for (std::size_t i = 0; i < m; ++i)
+      {
+         auto* y = c + i * ldc;
+         auto p = p0;
+
+         for (; p + 4 <= p1; p += 4)
+         {
+            const T x[4] = { a[p * lda + i], a[(p + 1) * lda + i], a[(p + 2) * lda + i], a[(p + 3) * lda + i] };
+
+            if (x[0] != 0 || x[1] != 0 || x[2] != 0 || x[3] != 0)
+            {
+               kernel.axpy4(x, b + p * ldb, ldb, y, n);
+            }
+         }
+
+         for (; p < p1; ++p)
+         {
+            if (a[p * lda + i] != 0) kernel.axpy(a[p * lda + i], b + p * ldb, y, n);
+         }
+      }
+   }
+
+   return;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template float simd::dot<float>(const float*, const float*, const std::size_t);
+template double simd::dot<double>(const double*, const double*, const std::size_t);
+template void simd::axpy<float>(const float, const float*, float*, const std::size_t);
+template void simd::axpy<double>(const double, const double*, double*, const std::size_t);
+template void simd::axpy_update<float>(const float, float*, float*, const float, const float*, const std::size_t);
+template void simd::axpy_update<double>(const double, double*, double*, const double, const double*,
+                                        const std::size_t);
+template void simd::multiply_add<float>(const float*, const float*, const std::size_t, const std::size_t, float*,
+                                       const std::size_t);
+template void simd::multiply_add<double>(const double*, const double*, const std::size_t, const std::size_t, double*,
+                                        const std::size_t);
+template void simd::multiply_add_update<float>(const float*, float*, float*, const float*, const float*,
+                                              const std::size_t, const std::size_t, const std::size_t);
+template void simd::multiply_add_update<double>(const double*, double*, double*, const double*, const double*,
+                                               const std::size_t, const std::size_t, const std::size_t);
+template void simd::momentum_update<float>(const float, const float*, float*, float*, const float, const float,
+                                          const std::size_t);
+template void simd::momentum_update<double>(const double, const double*, double*, double*, const double,
+                                           const double, const std::size_t);
+template void simd::rmsprop_update<float>(const float, const float*, float*, float*, const float, const float,
+                                         const float, const std::size_t);
+template void simd::rmsprop_update<double>(const double, const double*, double*, double*, const double,
+                                          const double, const double, const std::size_t);
+template void simd::adam_update<float>(const float, const float*, float*, float*, float*, const float, const float,
+                                      const float, const float, const std::size_t);
+template void simd::adam_update<double>(const double, const double*, double*, double*, double*, const double,
+                                       const double, const double, const double, const std::size_t);
+template void simd::gemm_nt<float>(const std::size_t, const std::size_t, const std::size_t, const float*,
+                                   const std::size_t, const float*, const std::size_t, float*, const std::size_t);
+template void simd::gemm_nt<double>(const std::size_t, const std::size_t, const std::size_t, const double*,
+                                    const std::size_t, const double*, const std::size_t, double*, const std::size_t);
+template void simd::gemm_nn<float>(const std::size_t, const std::size_t, const std::size_t, const float*,
+                                   const std::size_t, const float*, const std::size_t, float*, const std::size_t);
+template void simd::gemm_nn<double>(const std::size_t, const std::size_t, const std::size_t, const double*,
+                                    const std::size_t, const double*, const std::size_t, double*, const std::size_t);
+template void simd::gemm_tn<float>(const std::size_t, const std::size_t, const std::size_t, const float*,
+                                   const std::size_t, const float*, const std::size_t, float*, const std::size_t);
+template void simd::gemm_tn<double>(const std::size_t, const std::size_t, const std::size_t, const double*,
+                                    const std::size_t, const double*, const std::size_t, double*, const std::size_t);
\ No newline at end of file
@@ -0,0 +1,285 @@
+/********************************************************************************
+* simd.hpp: Vektoriserade berkningskrnor fr de inre looparna i dense-lager.
+*           Lmplig implementering (AVX-512, AVX2 eller skalr) vljs vid
+*           krning utefter vad processorn stdjer, s att programmet kan
+*           kompileras utan srskilda kompilatorflaggor och nd utnyttja
+*           processorns vektorenheter. Samtliga flyttalskrnor finns fr
+*           typen float samt double. Dessutom finns en krna fr 8-bitars
+*           heltal, som anvnds vid kvantiserad prediktion.
+********************************************************************************/
+#ifndef SIMD_HPP_
+#define SIMD_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <cstddef>
+#include <cstdint>
+
+namespace simd
+{
+/********************************************************************************
+* dot: Returnerar skalrprodukten av angivna vektorer x och y.
+*
+*      - x   : Pekare till den frsta vektorn.
+*      - y   : Pekare till den andra vektorn.
+*      - size: Antalet element som skalrprodukten berknas ver.
+********************************************************************************/
+template <typename T>
+T dot(const T* x,
+      const T* y,
+      const std::size_t size);
+
+/********************************************************************************
+* axpy: Adderar angiven vektor x skalad med faktorn a till vektorn y, dvs.
+*       y = y + a * x.
+*
+*       - a   : Skalfaktor fr vektorn x.
+*       - x   : Pekare till den vektor som skall adderas.
+*       - y   : Pekare till den vektor som uppdateras.
+*       - size: Antalet element som skall uppdateras.
+********************************************************************************/
+template <typename T>
+void axpy(const T a,
+          const T* x,
+          T* y,
+          const std::size_t size);
+
+/********************************************************************************
+* axpy_update: Adderar angiven vektor w skalad med faktorn a till vektorn y
+*              och justerar drefter w med vektorn x skalad med faktorn b, dvs.
+*              y = y + a * w fljt av w = w + b * x. Anvnds fr att sprida
+*              avvikelser bakt via en viktrad och justera samma rad i en
+*              enda passage, s att raden endast lses frn minnet en gng.
+*
+*              - a   : Skalfaktor fr vektorn w vid summering till y.
+*              - w   : Pekare till den vektor som summeras och sedan justeras.
+*              - y   : Pekare till den vektor som summan adderas till.
+*              - b   : Skalfaktor fr vektorn x vid justering av w.
+*              - x   : Pekare till den vektor som w justeras med.
+*              - size: Antalet element som skall uppdateras.
+********************************************************************************/
+template <typename T>
+void axpy_update(const T a,
+                 T* w,
+                 T* y,
+                 const T b,
+                 const T* x,
+                 const std::size_t size);
+
+/********************************************************************************
+* multiply_add: Adderar de elementvisa produkterna av angivet antal rader i x
+*               och w till vektorn y, dvs. y = y + x[r] * w[r] summerat ver
+*               samtliga rader r. Anvnds nr varje element i motsvarar en
+*               egen modell, exempelvis vid trning av en population.
+*
+*               - x     : Pekare till den frsta raden i x.
+*               - w     : Pekare till den frsta raden i w.
+*               - rows  : Antalet rader i x och w.
+*               - stride: Avstndet mellan raderna i x och w.
+*               - y     : Pekare till den vektor som uppdateras.
+*               - size  : Antalet element per rad.
+********************************************************************************/
+template <typename T>
+void multiply_add(const T* x,
+                  const T* w,
+                  const std::size_t rows,
+                  const std::size_t stride,
+                  T* y,
+                  const std::size_t size);
+
+/********************************************************************************
+* multiply_add_update: Elementvis motsvarighet till axpy_update fr angivet
+*                      antal rader, dvs. y[r] = y[r] + a * w[r] fljt av
+*                      w[r] = w[r] + b * x[r] fr varje rad r, dr samtliga
+*                      produkter r elementvisa. Anvnds fr att sprida
+*                      avvikelser bakt och justera vikterna fr mnga
+*                      modeller i en enda passage.
+*
+*                      - a     : Pekare till faktorerna fr w vid summering.
+*                      - w     : Pekare till den frsta raden i w.
+*                      - y     : Pekare till den frsta raden i y.
+*                      - b     : Pekare till faktorerna fr x vid justering.
+*                      - x     : Pekare till den frsta raden i x.
+*                      - rows  : Antalet rader i w, y och x.
+*                      - stride: Avstndet mellan raderna i w, y och x.
+*                      - size  : Antalet element per rad.
+********************************************************************************/
+template <typename T>
+void multiply_add_update(const T* a,
+                         T* w,
+                         T* y,
+                         const T* b,
+                         const T* x,
+                         const std::size_t rows,
+                         const std::size_t stride,
+                         const std::size_t size);
+
+/********************************************************************************
+* momentum_update: Justerar vektorn w med gradienten a * x via momentum, dr
+*                  hastigheten v frst uppdateras enligt
+*                  v = momentum * v + a * x, varefter w = w + rate * v.
+*                  Hastigheten och vikterna justeras i en enda passage.
+*
+*                  - a       : Skalfaktor fr vektorn x.
+*                  - x       : Pekare till den vektor som utgr gradienten.
+*                  - w       : Pekare till de vikter som justeras.
+*                  - v       : Pekare till hastigheten fr respektive vikt.
+*                  - momentum: Andel av hastigheten som behlls.
+*                  - rate    : Lrhastigheten.
+*                  - size    : Antalet element som skall uppdateras.
+********************************************************************************/
+template <typename T>
+void momentum_update(const T a,
+                     const T* x,
+                     T* w,
+                     T* v,
+                     const T momentum,
+                     const T rate,
+                     const std::size_t size);
+
+/********************************************************************************
+* rmsprop_update: Justerar vektorn w med gradienten g = a * x enligt RMSProp,
+*                 dr det glidande medelvrdet av kvadrerade gradienter frst
+*                 uppdateras enligt s = decay * s + (1 - decay) * g^2,
+*                 varefter w = w + rate * g / (sqrt(s) + epsilon). Medelvrdet
+*                 och vikterna justeras i en enda passage.
+*
+*                 - a      : Skalfaktor fr vektorn x.
+*                 - x      : Pekare till den vektor som utgr gradienten.
+*                 - w      : Pekare till de vikter som justeras.
+*                 - s      : Pekare till medelvrdet fr respektive vikt.
+*                 - decay  : Andel av medelvrdet som behlls.
+*                 - rate   : Lrhastigheten.
+*                 - epsilon: Litet tal som frhindrar division med noll.
+*                 - size   : Antalet element som skall uppdateras.
+********************************************************************************/
+template <typename T>
+void rmsprop_update(const T a,
+                    const T* x,
+                    T* w,
+                    T* s,
+                    const T decay,
+                    const T rate,
+                    const T epsilon,
+                    const std::size_t size);
+
+/********************************************************************************
+* adam_update: Justerar vektorn w med gradienten g = a * x enligt Adam, dr
+*              momenten frst uppdateras enligt m = beta1 * m + (1 - beta1) * g
+*              samt v = beta2 * v + (1 - beta2) * g^2, varefter
+*              w = w + rate * m / (sqrt(v) + epsilon). Biaskorrigeringen av
+*              momenten frutstts ing i rate. Momenten och vikterna
+*              justeras i en enda passage.
+*
+*              - a      : Skalfaktor fr vektorn x.
+*              - x      : Pekare till den vektor som utgr gradienten.
+*              - w      : Pekare till de vikter som justeras.
+*              - m      : Pekare till frsta momentet fr respektive vikt.
+*              - v      : Pekare till andra momentet fr respektive vikt.
+*              - beta1  : Andel av frsta momentet som behlls.
+*              - beta2  : Andel av andra momentet som behlls.
+*              - rate   : Biaskorrigerad lrhastighet.
+*              - epsilon: Litet tal som frhindrar division med noll.
+*              - size   : Antalet element som skall uppdateras.
+********************************************************************************/
+template <typename T>
+void adam_update(const T a,
+                 const T* x,
+                 T* w,
+                 T* m,
+                 T* v,
+                 const T beta1,
+                 const T beta2,
+                 const T rate,
+                 const T epsilon,
+                 const std::size_t size);
+
+/********************************************************************************
+* gemm_nt: Adderar matrisprodukten A * B^T till matrisen C, dr A har m rader
+*          och k kolumner, B har n rader och k kolumner och C har m rader och
+*          n kolumner. Samtliga matriser lagras radvis med angivet radavstnd.
+*          Anvnds fr feedforward i minibatcher, dr A utgrs av indata och
+*          B av lagrets vikter.
+*
+*          - m, n, k: Matrisernas dimensioner enligt ovan.
+*          - a, lda : Pekare till matrisen A samt avstndet mellan dess rader.
+*          - b, ldb : Pekare till matrisen B samt avstndet mellan dess rader.
+*          - c, ldc : Pekare till matrisen C samt avstndet mellan dess rader.
+********************************************************************************/
+template <typename T>
+void gemm_nt(const std::size_t m,
+             const std::size_t n,
+             const std::size_t k,
+             const T* a,
+             const std::size_t lda,
+             const T* b,
+             const std::size_t ldb,
+             T* c,
+             const std::size_t ldc);
+
+/********************************************************************************
+* gemm_nn: Adderar matrisprodukten A * B till matrisen C, dr A har m rader
+*          och k kolumner, B har k rader och n kolumner och C har m rader och
+*          n kolumner. Anvnds fr backpropagation i minibatcher, dr A utgrs
+*          av nsta lagers avvikelser och B av nsta lagers vikter.
+*
+*          - m, n, k: Matrisernas dimensioner enligt ovan.
+*          - a, lda : Pekare till matrisen A samt avstndet mellan dess rader.
+*          - b, ldb : Pekare till matrisen B samt avstndet mellan dess rader.
+*          - c, ldc : Pekare till matrisen C samt avstndet mellan dess rader.
+********************************************************************************/
+template <typename T>
+void gemm_nn(const std::size_t m,
+             const std::size_t n,
+             const std::size_t k,
+             const T* a,
+             const std::size_t lda,
+             const T* b,
+             const std::size_t ldb,
+             T* c,
+             const std::size_t ldc);
+
+/********************************************************************************
+* gemm_tn: Adderar matrisprodukten A^T * B till matrisen C, dr A har k rader
+*          och m kolumner, B har k rader och n kolumner och C har m rader och
+*          n kolumner. Anvnds fr att ackumulera viktgradienter ver en
+*          minibatch, dr A utgrs av lagrets avvikelser och B av dess indata.
+*
+*          - m, n, k: Matrisernas dimensioner enligt ovan.
+*          - a, lda : Pekare till matrisen A samt avstndet mellan dess rader.
+*          - b, ldb : Pekare till matrisen B samt avstndet mellan dess rader.
+*          - c, ldc : Pekare till matrisen C samt avstndet mellan dess rader.
+********************************************************************************/
+template <typename T>
+void gemm_tn(const std::size_t m,
+             const std::size_t n,
+             const std::size_t k,
+             const T* a,
+             const std::size_t lda,
+             const T* b,
+             const std::size_t ldb,
+             T* c,
+             const std::size_t ldc);
+
+/********************************************************************************
+* dot_u8i8: Returnerar skalrprodukten av angivna vektorer x, bestende av
+*           8-bitars heltal utan tecken, och y, bestende av 8-bitars heltal
+*           med tecken, dr produkterna summeras i ett 32-bitars heltal.
+*           AVX-512 VNNI anvnds om processorn stdjer det, annars AVX-512BW
+*           eller AVX2.
+*
+*           - x   : Pekare till vektorn med heltal utan tecken.
+*           - y   : Pekare till vektorn med heltal med tecken.
+*           - size: Antalet element som skalrprodukten berknas ver.
+********************************************************************************/
+std::int32_t dot_u8i8(const std::uint8_t* x,
+                      const std::int8_t* y,
+                      const std::size_t size);
+
+/********************************************************************************
+* isa: Returnerar namnet p den instruktionsuppsttning som valts vid krning,
+*      exempelvis "avx512", "avx2" eller "scalar".
+********************************************************************************/
+const char* isa(void);
+}
+
+#endif /* SIMD_HPP_ */
\ No newline at end of file
@@ -0,0 +1,104 @@
+/********************************************************************************
+* sparse.cpp: Definition av funktionsmedlemmar tillhrande strukten
+*             sparse_matrix fr glesa matriser i CSR-format.
+********************************************************************************/
+#include "sparse.hpp"
+
+#include <algorithm>
+
+/********************************************************************************
+* sparse_matrix: Initierar ny gles matris via angivna tta rader, dr
+*                endast element skilda frn noll lagras. Antalet kolumner
+*                stts till bredden p den bredaste raden.
+*
+*                - dense: Tta rader som skall lagras glest.
+********************************************************************************/
+template <typename T>
+sparse_matrix<T>::sparse_matrix(const std::vector<std::vector<T>>& dense)
+   : offsets(1, 0)
+{
+   this->offsets.reserve(dense.size() + 1);
+
+   for (const auto& i : dense)
+   {
+      this->append(i.data(), i.size());
+   }
+
+   return;
+}
+
+/********************************************************************************
+* append: Lgger till en ny rad via angiven tt rad, dr endast element
+*         skilda frn noll lagras.
+*
+*         - dense: Pekare till den tta radens frsta element.
+*         - size : Antalet element i den tta raden.
+********************************************************************************/
+template <typename T>
+void sparse_matrix<T>::append(const T* dense,
+                              const std::size_t size)
+{
+   for (std::size_t j = 0; j < size; ++j)
+   {
+      if (dense[j] == 0) continue;
+      this->indices.push_back(static_cast<std::uint32_t>(j));
+      this->values.push_back(dense[j]);
+   }
+
+   this->offsets.push_back(this->values.size());
+   this->cols = std::max(this->cols, size);
+   return;
+}
+
+/********************************************************************************
+* append: Lgger till en ny rad bestende av angivna par av index och vrde,
+*         vilka lagras i angiven ordning.
+*
+*         - index: Pekare till kolumnindex fr respektive vrde.
+*         - value: Pekare till de vrden som skall lagras.
+*         - size : Antalet par av index och vrde.
+********************************************************************************/
+template <typename T>
+void sparse_matrix<T>::append(const std::uint32_t* index,
+                              const T* value,
+                              const std::size_t size)
+{
+   this->indices.insert(this->indices.end(), index, index + size);
+   this->values.insert(this->values.end(), value, value + size);
+   this->offsets.push_back(this->values.size());
+
+   for (std::size_t k = 0; k < size; ++k)
+   {
+      this->cols = std::max<std::size_t>(this->cols, index[k] + std::size_t(1));
+   }
+
+   return;
+}
+
+/********************************************************************************
+* clear: Tmmer angiven matris p samtliga rader.
+********************************************************************************/
+template <typename T>
+void sparse_matrix<T>::clear(void)
+{
+   this->offsets.assign(1, 0);
+   this->indices.clear();
+   this->values.clear();
+   this->cols = 0;
+   return;
+}
+
+/********************************************************************************
+* density: Returnerar andelen lagrade element i frhllande till motsvarande
+*          tta matris, eller 0 om matrisen r tom.
+********************************************************************************/
+template <typename T>
+double sparse_matrix<T>::density(void) const
+{
+   const auto size = static_cast<double>(this->num_rows()) * this->cols;
+   return size > 0 ? this->num_nonzeros() / size : 0;
+}
+
+/* Explicita instansieringar fr float samt double: */
+template struct sparse_matrix<float>;
+template struct sparse_matrix<double>;
@@ -0,0 +1,76 @@
+/********************************************************************************
+* sparse.hpp: Implementering av glesa indata, dr endast element skilda frn
+*             noll lagras som par av index och vrde. Anvnds fr indata som
+*             till strsta delen bestr av nollor, exempelvis one-hot-kodade
+*             kategorier eller bag-of-features, s att ingngslagret endast
+*             behver lsa och justera vikterna fr de element som r satta.
+********************************************************************************/
+#ifndef SPARSE_HPP_
+#define SPARSE_HPP_
+
+/* Inkluderingsdirektiv: */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/********************************************************************************
+* sparse_row: Vy ver en gles rad bestende av size par av index och vrde,
+*             dr index[k] anger kolumnen fr vrdet value[k]. Vyn ger inte
+*             datan, utan pekar exempelvis in i en sparse_matrix.
+********************************************************************************/
+template <typename T = double>
+struct sparse_row
+{
+   /* Medlemmar: */
+   const std::uint32_t* index = nullptr; /* Kolumnindex fr respektive vrde. */
+   const T* value = nullptr;             /* Vrden skilda frn noll. */
+   std::size_t size = 0;                 /* Antalet lagrade vrden. */
+
+   /* Medlemsfunktioner: */
+   sparse_row(void) { }
+   sparse_row(const std::uint32_t* index,
+              const T* value,
+              const std::size_t size)
+      : index(index), value(value), size(size) { }
+};
+
+/********************************************************************************
+* sparse_matrix: Strukt fr glesa matriser lagrade radvis i CSR-format
+*                (Compressed Sparse Row), dr index och vrden fr samtliga
+*                rader lagras efter varandra i tv sammanhngande vektorer.
+*                Rad i bestr av elementen p index [offsets[i], offsets[i + 1])
+*                och ns som en sparse_row via operator[]. Antalet kolumner
+*                motsvarar det strsta lagrade index plus ett, eller bredden
+*                p tillagda tta rader om den r strre.
+********************************************************************************/
+template <typename T = double>
+struct sparse_matrix
+{
+   /* Medlemmar: */
+   std::vector<std::size_t> offsets;   /* Start fr respektive rad samt slut fr sista raden. */
+   std::vector<std::uint32_t> indices; /* Kolumnindex fr samtliga lagrade vrden. */
+   std::vector<T> values;              /* Samtliga lagrade vrden. */
+   std::size_t cols = 0;               /* Antalet kolumner. */
+
+   /* Medlemsfunktioner: */
+   sparse_matrix(void) : offsets(1, 0) { }
+   explicit sparse_matrix(const std::vector<std::vector<T>>& dense);
+
+   std::size_t num_rows(void) const { return this->offsets.size() - 1; }
+   std::size_t num_nonzeros(void) const { return this->values.size(); }
+   sparse_row<T> operator[](const std::size_t row) const
+   {
+      const auto first = this->offsets[row];
+      return sparse_row<T>(this->indices.data() + first, this->values.data() + first, this->offsets[row + 1] - first);
+   }
+
+   void append(const T* dense,
+               const std::size_t size);
+   void append(const std::uint32_t* index,
+               const T* value,
+               const std::size_t size);
+   void clear(void);
+   double density(void) const;
+};
+
+#endif /* SPARSE_HPP_ */
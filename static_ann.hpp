@@ -0,0 +1,405 @@
+/********************************************************************************
+* static_ann.hpp: Neurala ntverk med fast topologi, dr antalet noder i
+*                 respektive lager anges som mallparametrar vid kompilering.
+*                 Samtliga parametrar lagras i std::array, vilket medfr att
+*                 ntverket inte krver ngra minnesallokeringar vid
+*                 prediktion och att samtliga loopar kan vecklas ut helt av
+*                 kompilatorn. Lmpligt fr sm ntverk som anvnds i
+*                 tidskritiska loopar, exempelvis static_ann<2, 3, 1>.
+********************************************************************************/
+#ifndef STATIC_ANN_HPP_
+#define STATIC_ANN_HPP_
+
+/* Inkluderingsdirektiv: */
+#include "ann.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+/********************************************************************************
+* static_ann: Strukt fr neurala ntverk med fast topologi innehllande ett
+*             ingngslager med NumInputs noder, ett dolt lager med NumHidden
+*             noder samt ett utgngslager med NumOutputs noder. Trning samt
+*             prediktion fungerar p samma stt som fr strukten ann, och
+*             ntverk kan konverteras mellan static_ann och ann med samma
+*             topologi. Initieras ntverket med samma startvrde fr
+*             slumptalsgeneratorn som ett motsvarande ann erhlls identiska
+*             parametrar.
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T = double>
+struct static_ann
+{
+   /* Medlemmar: */
+   std::array<T, NumHidden> hidden_bias{};                          /* Vilovrden i det dolda lagret. */
+   std::array<std::array<T, NumInputs>, NumHidden> hidden_weights{}; /* Vikter i det dolda lagret. */
+   std::array<T, NumHidden> hidden_output{};                        /* Utdata frn det dolda lagret. */
+   std::array<T, NumHidden> hidden_error{};                         /* Avvikelser i det dolda lagret. */
+   std::array<T, NumOutputs> output_bias{};                         /* Vilovrden i utgngslagret. */
+   std::array<std::array<T, NumHidden>, NumOutputs> output_weights{}; /* Vikter i utgngslagret. */
+   std::array<T, NumOutputs> output_output{};                       /* Utdata frn utgngslagret. */
+   std::array<T, NumOutputs> output_error{};                        /* Avvikelser i utgngslagret. */
+   std::vector<std::array<T, NumInputs>> train_in;                  /* Indata fr trningsuppsttningar. */
+   std::vector<std::array<T, NumOutputs>> train_out;                /* Utdata fr trningsuppsttningar. */
+   std::vector<std::size_t> train_order;                            /* Ordningsfljd fr trningsuppsttningar. */
+   rng generator;                                                   /* Slumptalsgenerator fr startvrden och ordningsfljd. */
+
+   /* Medlemsfunktioner: */
+   explicit static_ann(const std::uint64_t seed = rng::default_seed);
+   explicit static_ann(const ann<T>& network);
+
+   static constexpr std::size_t num_inputs(void) { return NumInputs; }
+   static constexpr std::size_t num_hidden(void) { return NumHidden; }
+   static constexpr std::size_t num_outputs(void) { return NumOutputs; }
+   std::size_t num_sets(void) const { return this->train_order.size(); }
+   std::array<T, NumOutputs>& output(void) { return this->output_output; }
+   void seed(const std::uint64_t seed) { this->generator = rng(seed); }
+
+   void set_training_data(const std::vector<std::vector<T>>& train_in,
+                          const std::vector<std::vector<T>>& train_out);
+   void train(const std::size_t num_epochs,
+              const T learning_rate);
+   const std::array<T, NumOutputs>& predict(const std::array<T, NumInputs>& input);
+   void predict(const std::array<T, NumInputs>& input,
+                std::array<T, NumOutputs>& output) const;
+   void predict(std::ostream& ostream = std::cout,
+                const double threshold = 0.001);
+
+   ann<T> to_ann(void) const;
+   explicit operator ann<T>(void) const { return this->to_ann(); }
+
+private:
+   void shuffle(void);
+   void optimize(const std::array<T, NumInputs>& input,
+                 const std::array<T, NumOutputs>& reference,
+                 const T learning_rate);
+   void feedforward(const std::array<T, NumInputs>& input,
+                    std::array<T, NumHidden>& hidden,
+                    std::array<T, NumOutputs>& output) const;
+
+   static T relu(const T sum) { return sum > 0 ? sum : 0; }
+   static T delta_relu(const T output) { return output > 0 ? 1 : 0; }
+
+   /****************************************************************************
+   * unroll: Anropar angiven funktion f en gng fr varje index 0 - (N - 1),
+   *         dr indexet passeras som en kompileringstidskonstant. Anropen
+   *         expanderas vid kompilering, vilket medfr att loopen vecklas ut
+   *         helt oavsett kompilatorns optimeringsniv.
+   ****************************************************************************/
+   template <std::size_t N, typename F>
+   static void unroll(F&& f) { unroll(std::forward<F>(f), std::make_index_sequence<N>{}); }
+
+   template <typename F, std::size_t... I>
+   static void unroll(F&& f, std::index_sequence<I...>) { (f(std::integral_constant<std::size_t, I>{}), ...); }
+};
+
+/********************************************************************************
+* static_ann: Initierar nytt neuralt ntverk med fast topologi, dr bias och
+*             vikter tilldelas randomiserade flyttal mellan 0 - 1 i samma
+*             ordning som fr strukten ann.
+*
+*             - seed: Startvrde fr ntverkets slumptalsgenerator
+*                     (default = rng::default_seed).
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T>
+static_ann<NumInputs, NumHidden, NumOutputs, T>::static_ann(const std::uint64_t seed)
+   : generator(seed)
+{
+   for (std::size_t i = 0; i < NumHidden; ++i)
+   {
+      this->hidden_bias[i] = this->generator.template uniform<T>();
+      this->generator.fill(this->hidden_weights[i].data(), NumInputs);
+   }
+
+   for (std::size_t i = 0; i < NumOutputs; ++i)
+   {
+      this->output_bias[i] = this->generator.template uniform<T>();
+      this->generator.fill(this->output_weights[i].data(), NumHidden);
+   }
+
+   return;
+}
+
+/********************************************************************************
+* static_ann: Initierar nytt neuralt ntverk med fast topologi via kopiering
+*             av parametrarna samt slumptalsgeneratorn i angivet ntverk.
+*             Trningsdata kopieras inte.
+*             Ett undantag av typen std::invalid_argument kastas om angivet
+*             ntverk har en annan topologi.
+*
+*             - network: Det ntverk vars parametrar skall kopieras.
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T>
+static_ann<NumInputs, NumHidden, NumOutputs, T>::static_ann(const ann<T>& network)
+{
+   const auto& hidden = network.hidden_layer;
+   const auto& output = network.output_layer;
+
+   if (hidden.num_nodes() != NumHidden || hidden.num_weights() != NumInputs ||
+       output.num_nodes() != NumOutputs || output.num_weights() != NumHidden)
+   {
+      throw std::invalid_argument("static_ann: Network topology does not match!");
+   }
+
+   this->generator = network.generator;
+
+   for (std::size_t i = 0; i < NumHidden; ++i)
+   {
+      this->hidden_bias[i] = hidden.bias[i];
+      std::copy(hidden.weights[i], hidden.weights[i] + NumInputs, this->hidden_weights[i].begin());
+   }
+
+   for (std::size_t i = 0; i < NumOutputs; ++i)
+   {
+      this->output_bias[i] = output.bias[i];
+      std::copy(output.weights[i], output.weights[i] + NumHidden, this->output_weights[i].begin());
+   }
+
+   return;
+}
+
+/********************************************************************************
+* set_training_data: Lser in trningsdata fr angivet neuralt ntverk via
+*                    passerade in- och utsignaler. Rader kortare n antalet
+*                    noder i in- respektive utgngslagret fylls ut med nollor.
+*
+*                    - train_in : Innehller indata fr trningsuppsttningar.
+*                    - train_out: Innehller utdata fr trningsuppsttningar.
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T>
+void static_ann<NumInputs, NumHidden, NumOutputs, T>::set_training_data(const std::vector<std::vector<T>>& train_in,
+                                                                        const std::vector<std::vector<T>>& train_out)
+{
+   const auto num_sets = train_in.size() <= train_out.size() ? train_in.size() : train_out.size();
+
+   this->train_in.assign(num_sets, std::array<T, NumInputs>{});
+   this->train_out.assign(num_sets, std::array<T, NumOutputs>{});
+   this->train_order.resize(num_sets);
+
+   for (std::size_t i = 0; i < num_sets; ++i)
+   {
+      std::copy_n(train_in[i].begin(), std::min(train_in[i].size(), NumInputs), this->train_in[i].begin());
+      std::copy_n(train_out[i].begin(), std::min(train_out[i].size(), NumOutputs), this->train_out[i].begin());
+      this->train_order[i] = i;
+   }
+
+   return;
+}
+
+/********************************************************************************
+* train: Trnar angivet neuralt ntverk med befintlig trningsdata under angivet
+*        antal epoker med angiven lrhastighet, dr parametrarna justeras
+*        efter varje trningsuppsttning p samma stt som fr strukten ann.
+*
+*        - num_epochs   : Antalet epoker/omgngar som trning skall genomfras.
+*        - learning_rate: Lrhastigheten, som avgr hur stor andel av uppmtt
+*                         avvikelse som ntverkets parametrar justeras med.
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T>
+void static_ann<NumInputs, NumHidden, NumOutputs, T>::train(const std::size_t num_epochs,
+                                                            const T learning_rate)
+{
+   for (std::size_t i = 0; i < num_epochs; ++i)
+   {
+      this->shuffle();
+
+      for (std::size_t j = 0; j < this->num_sets(); ++j)
+      {
+         const auto k = this->train_order[j];
+         this->optimize(this->train_in[k], this->train_out[k], learning_rate);
+      }
+   }
+
+   return;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk fr angiven
+*          kombination av indata och returnerar en referens till utdatan.
+*
+*          - input: Den kombination av indata som prediktion skall ske utefter.
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T>
+const std::array<T, NumOutputs>& static_ann<NumInputs, NumHidden, NumOutputs, T>::predict(const std::array<T, NumInputs>& input)
+{
+   this->feedforward(input, this->hidden_output, this->output_output);
+   return this->output_output;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk fr angiven
+*          kombination av indata och skriver utdatan till angiven array.
+*          Ntverket modifieras inte, vilket medfr att flera trdar kan
+*          anvnda samma ntverk samtidigt.
+*
+*          - input : Den kombination av indata som prediktion skall ske utefter.
+*          - output: Array dr predikterad utdata lagras.
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T>
+void static_ann<NumInputs, NumHidden, NumOutputs, T>::predict(const std::array<T, NumInputs>& input,
+                                                              std::array<T, NumOutputs>& output) const
+{
+   std::array<T, NumHidden> hidden;
+   this->feedforward(input, hidden, output);
+   return;
+}
+
+/********************************************************************************
+* predict: Genomfr prediktion med angivet neuralt ntverk via indata frn
+*          samtliga befintliga trningsuppsttningar och skriver varje
+*          kombination av indata samt motsvarande predikterad utdata via
+*          angiven utstrm p samma format som fr strukten ann.
+*
+*          - ostream  : Angiven utstrm (default = std::cout).
+*          - threshold: Trskelvrde nra noll, dr samtliga predikterade
+*                       vrden inom intervallet [-threshold, threshold]
+*                       avrundas till noll (default = 0.001).
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T>
+void static_ann<NumInputs, NumHidden, NumOutputs, T>::predict(std::ostream& ostream,
+                                                              const double threshold)
+{
+   ostream << "--------------------------------------------------------------------------------\n";
+
+   for (std::size_t i = 0; i < this->train_in.size(); ++i)
+   {
+      const auto& prediction = this->predict(this->train_in[i]);
+      ostream << "Input: ";
+      dense_layer<T>::print_parameters(this->train_in[i].data(), NumInputs, ostream, threshold);
+
+      ostream << "Output: ";
+      dense_layer<T>::print_parameters(prediction.data(), NumOutputs, ostream, threshold);
+      if (i + 1 < this->train_in.size()) ostream << "\n";
+   }
+
+   ostream << "--------------------------------------------------------------------------------\n\n";
+   return;
+}
+
+/********************************************************************************
+* to_ann: Returnerar ett ntverk av typen ann med samma topologi och samma
+*         parametrar samt slumptalsgenerator som angivet ntverk. Trningsdata
+*         kopieras inte.
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T>
+ann<T> static_ann<NumInputs, NumHidden, NumOutputs, T>::to_ann(void) const
+{
+   ann<T> network;
+   auto& hidden = network.hidden_layer;
+   network.generator = this->generator;
+   auto& output = network.output_layer;
+
+   hidden.output.assign(NumHidden, 0);
+   hidden.error.assign(NumHidden, 0);
+   hidden.bias.assign(this->hidden_bias.begin(), this->hidden_bias.end());
+   hidden.weights.resize(NumHidden, NumInputs);
+
+   output.output.assign(NumOutputs, 0);
+   output.error.assign(NumOutputs, 0);
+   output.bias.assign(this->output_bias.begin(), this->output_bias.end());
+   output.weights.resize(NumOutputs, NumHidden);
+
+   for (std::size_t i = 0; i < NumHidden; ++i)
+   {
+      std::copy(this->hidden_weights[i].begin(), this->hidden_weights[i].end(), hidden.weights[i]);
+   }
+
+   for (std::size_t i = 0; i < NumOutputs; ++i)
+   {
+      std::copy(this->output_weights[i].begin(), this->output_weights[i].end(), output.weights[i]);
+   }
+
+   return network;
+}
+
+/********************************************************************************
+* shuffle: Randomiserar den inbrdes ordningen p trningsuppsttningarna p
+*          samma stt som fr strukten ann.
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T>
+void static_ann<NumInputs, NumHidden, NumOutputs, T>::shuffle(void)
+{
+   this->generator.shuffle(this->train_order.data(), this->train_order.size());
+   return;
+}
+
+/********************************************************************************
+* optimize: Genomfr feedforward och backpropagation fr angiven
+*           trningsuppsttning och justerar ntverkets parametrar drefter.
+*           Avvikelserna i det dolda lagret berknas innan vikterna i
+*           utgngslagret justeras, precis som fr strukten ann.
+*
+*           input        : Indata frn trningsuppsttningen.
+*           reference    : Referensdata frn trningsuppsttningen.
+*           learning_rate: Lrhastigheten, som avgr hur mycket ntverkets
+*                          parametrar justeras vid fel.
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T>
+void static_ann<NumInputs, NumHidden, NumOutputs, T>::optimize(const std::array<T, NumInputs>& input,
+                                                               const std::array<T, NumOutputs>& reference,
+                                                               const T learning_rate)
+{
+   this->feedforward(input, this->hidden_output, this->output_output);
+
+   unroll<NumOutputs>([&](const auto i)
+   {
+      const auto deviation = reference[i] - this->output_output[i];
+      this->output_error[i] = deviation * delta_relu(this->output_output[i]);
+   });
+
+   unroll<NumHidden>([&](const auto i)
+   {
+      T deviation = 0;
+      unroll<NumOutputs>([&](const auto j) { deviation += this->output_error[j] * this->output_weights[j][i]; });
+      this->hidden_error[i] = deviation * delta_relu(this->hidden_output[i]);
+   });
+
+   unroll<NumOutputs>([&](const auto i)
+   {
+      const auto change_rate = this->output_error[i] * learning_rate;
+      this->output_bias[i] += change_rate;
+      unroll<NumHidden>([&](const auto j) { this->output_weights[i][j] += change_rate * this->hidden_output[j]; });
+   });
+
+   unroll<NumHidden>([&](const auto i)
+   {
+      const auto change_rate = this->hidden_error[i] * learning_rate;
+      this->hidden_bias[i] += change_rate;
+      unroll<NumInputs>([&](const auto j) { this->hidden_weights[i][j] += change_rate * input[j]; });
+   });
+
+   return;
+}
+
+/********************************************************************************
+* feedforward: Berknar utdata fr det dolda lagret samt utgngslagret fr
+*              angiven indata, dr samtliga loopar vecklas ut vid kompilering.
+*
+*              - input : Indata till ntverket.
+*              - hidden: Array dr utdata frn det dolda lagret lagras.
+*              - output: Array dr utdata frn utgngslagret lagras.
+********************************************************************************/
+template <std::size_t NumInputs, std::size_t NumHidden, std::size_t NumOutputs, typename T>
+void static_ann<NumInputs, NumHidden, NumOutputs, T>::feedforward(const std::array<T, NumInputs>& input,
+                                                                  std::array<T, NumHidden>& hidden,
+                                                                  std::array<T, NumOutputs>& output) const
+{
+   unroll<NumHidden>([&](const auto i)
+   {
+      auto sum = this->hidden_bias[i];
+      unroll<NumInputs>([&](const auto j) { sum += input[j] * this->hidden_weights[i][j]; });
+      hidden[i] = relu(sum);
+   });
+
+   unroll<NumOutputs>([&](const auto i)
+   {
+      auto sum = this->output_bias[i];
+      unroll<NumHidden>([&](const auto j) { sum += hidden[j] * this->output_weights[i][j]; });
+      output[i] = relu(sum);
+   });
+
+   return;
+}
+
+#endif /* STATIC_ANN_HPP_ */
\ No newline at end of file